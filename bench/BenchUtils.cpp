@@ -0,0 +1,181 @@
+#include "BenchUtils.hpp"
+#include "rtc_base/random.h"
+#include "test/testsupport/file_utils.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+/* Allocation counting */
+
+namespace
+{
+	std::atomic<uint64_t> allocationCount{ 0 };
+	std::atomic<uint64_t> allocationBytes{ 0 };
+
+	inline void count(size_t size)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocationBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+} // namespace
+
+#ifdef __GLIBC__
+
+// libwebrtc frame buffers use posix_memalign() and libvpx uses malloc(), so
+// counting operator new alone would miss most of the per frame allocations.
+// Interpose the malloc family and forward to the glibc implementations.
+extern "C"
+{
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t count, size_t size);
+	void* __libc_realloc(void* ptr, size_t size);
+	void* __libc_memalign(size_t alignment, size_t size);
+
+	void* malloc(size_t size)
+	{
+		count(size);
+
+		return __libc_malloc(size);
+	}
+
+	void* calloc(size_t number, size_t size)
+	{
+		count(number * size);
+
+		return __libc_calloc(number, size);
+	}
+
+	void* realloc(void* ptr, size_t size)
+	{
+		count(size);
+
+		return __libc_realloc(ptr, size);
+	}
+
+	void* memalign(size_t alignment, size_t size)
+	{
+		count(size);
+
+		return __libc_memalign(alignment, size);
+	}
+
+	void* aligned_alloc(size_t alignment, size_t size)
+	{
+		count(size);
+
+		return __libc_memalign(alignment, size);
+	}
+
+	int posix_memalign(void** ptr, size_t alignment, size_t size)
+	{
+		count(size);
+
+		void* allocated = __libc_memalign(alignment, size);
+
+		if (!allocated)
+			return ENOMEM;
+
+		*ptr = allocated;
+
+		return 0;
+	}
+}
+
+#else
+
+void* operator new(size_t size)
+{
+	count(size);
+
+	void* ptr = std::malloc(size != 0 ? size : 1);
+
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+#endif
+
+uint64_t AllocationCounter::GetCount()
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::GetBytes()
+{
+	return allocationBytes.load(std::memory_order_relaxed);
+}
+
+AllocationScope::AllocationScope()
+  : count(AllocationCounter::GetCount()), bytes(AllocationCounter::GetBytes())
+{
+}
+
+void AllocationScope::Report(benchmark::State& state) const
+{
+	state.counters["allocs/frame"] = benchmark::Counter(
+	  static_cast<double>(AllocationCounter::GetCount() - this->count),
+	  benchmark::Counter::kAvgIterations);
+	state.counters["allocBytes/frame"] = benchmark::Counter(
+	  static_cast<double>(AllocationCounter::GetBytes() - this->bytes),
+	  benchmark::Counter::kAvgIterations);
+}
+
+/* Helpers */
+
+void resolutions(benchmark::internal::Benchmark* benchmark)
+{
+	benchmark->ArgNames({ "width", "height" });
+	benchmark->Args({ 320, 180 });
+	benchmark->Args({ 640, 360 });
+	benchmark->Args({ 1280, 720 });
+	benchmark->Args({ 1920, 1080 });
+	benchmark->Args({ 3840, 2160 });
+}
+
+void setFrameRate(benchmark::State& state, int width, int height)
+{
+	const int64_t frameSize = width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2);
+
+	state.SetItemsProcessed(state.iterations());
+	state.SetBytesProcessed(state.iterations() * frameSize);
+}
+
+std::string writeYuvFile(int width, int height, int frames)
+{
+	const size_t frameSize = width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2);
+	std::string path       = webrtc::test::TempFilename(webrtc::test::OutputPath(), "bench");
+	FILE* file             = std::fopen(path.c_str(), "wb");
+
+	if (!file)
+	{
+		std::fprintf(stderr, "cannot open %s\n", path.c_str());
+		std::abort();
+	}
+
+	webrtc::Random random(0x12345678);
+	std::vector<uint8_t> frame(frameSize);
+
+	for (int i = 0; i < frames; ++i)
+	{
+		for (auto& byte : frame)
+		{
+			byte = static_cast<uint8_t>(random.Rand<uint32_t>());
+		}
+
+		std::fwrite(frame.data(), 1, frame.size(), file);
+	}
+
+	std::fclose(file);
+
+	return path;
+}
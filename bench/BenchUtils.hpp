@@ -0,0 +1,43 @@
+#ifndef BENCH_UTILS_HPP
+#define BENCH_UTILS_HPP
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <string>
+
+/* Process wide count of heap allocations, including the malloc() based
+ * aligned allocations of libwebrtc frame buffers (glibc only, elsewhere only
+ * operator new is counted).
+ */
+class AllocationCounter
+{
+public:
+	static uint64_t GetCount();
+	static uint64_t GetBytes();
+};
+
+/* Reports the allocations made between construction and Report() as per
+ * iteration (per frame) counters.
+ */
+class AllocationScope
+{
+public:
+	AllocationScope();
+
+	void Report(benchmark::State& state) const;
+
+private:
+	uint64_t count;
+	uint64_t bytes;
+};
+
+// Registers the usual video resolutions as (width, height) arguments.
+void resolutions(benchmark::internal::Benchmark* benchmark);
+
+// Reports frames/s and I420 bytes/s for frames of |width|x|height|.
+void setFrameRate(benchmark::State& state, int width, int height);
+
+// Writes |frames| I420 frames of pseudo random content to a temporary file.
+std::string writeYuvFile(int width, int height, int frames);
+
+#endif
@@ -0,0 +1,84 @@
+#include "BenchUtils.hpp"
+#include "api/test/create_frame_generator.h"
+#include "api/video/video_frame.h"
+#include "api/video/video_sink_interface.h"
+#include "test/test_video_capturer.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+
+namespace
+{
+	class Capturer : public webrtc::test::TestVideoCapturer
+	{
+	public:
+		using webrtc::test::TestVideoCapturer::OnFrame;
+	};
+
+	class Sink : public rtc::VideoSinkInterface<webrtc::VideoFrame>
+	{
+	public:
+		void OnFrame(const webrtc::VideoFrame& frame) override
+		{
+			++this->frames;
+			this->pixels += frame.width() * frame.height();
+		}
+
+	public:
+		int64_t frames{ 0 };
+		int64_t pixels{ 0 };
+	};
+} // namespace
+
+/* Benchmarks */
+
+// Capturer OnFrame(), adapting frames down to 1/scale of their width and height.
+static void capturerOnFrame(benchmark::State& state)
+{
+	int width  = state.range(0);
+	int height = state.range(1);
+	int scale  = state.range(2);
+	auto generator =
+	  webrtc::test::CreateSquareFrameGenerator(width, height, absl::nullopt, absl::nullopt);
+	auto buffer = generator->NextFrame().buffer;
+	Capturer capturer;
+	Sink sink;
+	rtc::VideoSinkWants wants;
+
+	if (scale > 1)
+		wants.max_pixel_count = width * height / (scale * scale);
+
+	capturer.AddOrUpdateSink(&sink, wants);
+
+	int64_t timestampUs = 0;
+	AllocationScope allocations;
+
+	for (auto _ : state)
+	{
+		// 30 fps timestamps, so that the adapter never drops frames.
+		timestampUs += 33333;
+
+		capturer.OnFrame(webrtc::VideoFrame::Builder()
+		                   .set_video_frame_buffer(buffer)
+		                   .set_timestamp_us(timestampUs)
+		                   .build());
+	}
+
+	allocations.Report(state);
+	setFrameRate(state, width, height);
+	state.counters["delivered"] = benchmark::Counter(
+	  static_cast<double>(sink.frames) / state.iterations());
+	state.counters["outPixels/frame"] = benchmark::Counter(
+	  sink.frames ? static_cast<double>(sink.pixels) / sink.frames : 0);
+
+	capturer.RemoveSink(&sink);
+}
+BENCHMARK(capturerOnFrame)->Apply([](benchmark::internal::Benchmark* benchmark) {
+	benchmark->ArgNames({ "width", "height", "scale" });
+
+	for (int scale : { 1, 2, 4 })
+	{
+		benchmark->Args({ 640, 360, scale });
+		benchmark->Args({ 1280, 720, scale });
+		benchmark->Args({ 1920, 1080, scale });
+	}
+});
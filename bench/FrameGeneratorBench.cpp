@@ -0,0 +1,242 @@
+#include "BenchUtils.hpp"
+#include "api/test/create_frame_generator.h"
+#include "api/video/video_frame.h"
+#include "api/video_codecs/video_encoder.h"
+#include "modules/video_coding/codecs/vp8/include/vp8.h"
+#include "modules/video_coding/utility/ivf_file_writer.h"
+#include "rtc_base/system/file_wrapper.h"
+#include "system_wrappers/include/clock.h"
+#include "test/testsupport/file_utils.h"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// Frames in the generated YUV and IVF files.
+	constexpr int kFileFrames = 30;
+
+	using FrameGenerator = webrtc::test::FrameGeneratorInterface;
+
+	// Consumes frames produced by |generator| and reports the per frame cost.
+	void run(benchmark::State& state, FrameGenerator& generator, int width, int height)
+	{
+		AllocationScope allocations;
+
+		for (auto _ : state)
+		{
+			auto frame = generator.NextFrame();
+
+			benchmark::DoNotOptimize(frame.buffer);
+		}
+
+		allocations.Report(state);
+		setFrameRate(state, width, height);
+	}
+
+	/* Temporary input files, shared by every run at the same resolution. */
+
+	class InputFile
+	{
+	public:
+		explicit InputFile(std::string path) : path(std::move(path))
+		{
+		}
+
+		~InputFile()
+		{
+			webrtc::test::RemoveFile(this->path);
+		}
+
+		const std::string& GetPath() const
+		{
+			return this->path;
+		}
+
+	private:
+		std::string path;
+	};
+
+	const std::string& yuvFile(int width, int height)
+	{
+		static std::map<std::pair<int, int>, std::unique_ptr<InputFile>> files;
+
+		auto& file = files[{ width, height }];
+
+		if (!file)
+			file.reset(new InputFile(writeYuvFile(width, height, kFileFrames)));
+
+		return file->GetPath();
+	}
+
+	class IvfWriter : public webrtc::EncodedImageCallback
+	{
+	public:
+		explicit IvfWriter(const std::string& path)
+		  : writer(webrtc::IvfFileWriter::Wrap(webrtc::FileWrapper::OpenWriteOnly(path), 0))
+		{
+		}
+
+		~IvfWriter() override
+		{
+			this->writer->Close();
+		}
+
+		Result OnEncodedImage(
+		  const webrtc::EncodedImage& encodedImage,
+		  const webrtc::CodecSpecificInfo* /*codecSpecificInfo*/,
+		  const webrtc::RTPFragmentationHeader* /*fragmentation*/) override
+		{
+			this->writer->WriteFrame(encodedImage, webrtc::kVideoCodecVP8);
+
+			return Result(Result::OK);
+		}
+
+	private:
+		std::unique_ptr<webrtc::IvfFileWriter> writer;
+	};
+
+	// VP8 encodes square generator frames, so that decoding is representative.
+	std::string writeIvfFile(int width, int height)
+	{
+		std::string path = webrtc::test::TempFilename(webrtc::test::OutputPath(), "bench");
+		auto source      = webrtc::test::CreateSquareFrameGenerator(
+		  width, height, FrameGenerator::OutputType::kI420, absl::nullopt);
+		auto encoder     = webrtc::VP8Encoder::Create();
+		IvfWriter writer(path);
+
+		webrtc::VideoCodec codec;
+
+		codec.codecType          = webrtc::kVideoCodecVP8;
+		codec.width              = width;
+		codec.height             = height;
+		codec.startBitrate       = 2000;
+		codec.minBitrate         = 100;
+		codec.maxBitrate         = 4000;
+		codec.maxFramerate       = 30;
+		codec.qpMax              = 56;
+		*codec.VP8()             = webrtc::VideoEncoder::GetDefaultVp8Settings();
+		codec.VP8()->denoisingOn = false;
+
+		webrtc::VideoEncoder::Settings settings(
+		  webrtc::VideoEncoder::Capabilities(/*loss_notification*/ false), 1, 1200);
+
+		encoder->InitEncode(&codec, settings);
+		encoder->RegisterEncodeCompleteCallback(&writer);
+
+		webrtc::VideoBitrateAllocation allocation;
+
+		allocation.SetBitrate(0, 0, codec.startBitrate * 1000);
+		encoder->SetRates(webrtc::VideoEncoder::RateControlParameters(allocation, 30.0));
+
+		for (int i = 0; i < kFileFrames; ++i)
+		{
+			auto frame = webrtc::VideoFrame::Builder()
+			               .set_video_frame_buffer(source->NextFrame().buffer)
+			               .set_timestamp_rtp(i * 3000)
+			               .set_timestamp_us(i * 33333)
+			               .build();
+			std::vector<webrtc::VideoFrameType> types{ i == 0
+			                                             ? webrtc::VideoFrameType::kVideoFrameKey
+			                                             : webrtc::VideoFrameType::kVideoFrameDelta };
+
+			encoder->Encode(frame, &types);
+		}
+
+		encoder->Release();
+
+		return path;
+	}
+
+	const std::string& ivfFile(int width, int height)
+	{
+		static std::map<std::pair<int, int>, std::unique_ptr<InputFile>> files;
+
+		auto& file = files[{ width, height }];
+
+		if (!file)
+			file.reset(new InputFile(writeIvfFile(width, height)));
+
+		return file->GetPath();
+	}
+} // namespace
+
+/* Benchmarks */
+
+static void squareGenerator(benchmark::State& state)
+{
+	int width  = state.range(0);
+	int height = state.range(1);
+	auto generator =
+	  webrtc::test::CreateSquareFrameGenerator(width, height, FrameGenerator::OutputType::kI420, 10);
+
+	run(state, *generator, width, height);
+}
+BENCHMARK(squareGenerator)->Apply(resolutions);
+
+static void slideGenerator(benchmark::State& state)
+{
+	int width      = state.range(0);
+	int height     = state.range(1);
+	auto generator = webrtc::test::CreateSlideFrameGenerator(width, height, 1);
+
+	run(state, *generator, width, height);
+}
+BENCHMARK(slideGenerator)->Apply(resolutions);
+
+static void yuvFileGenerator(benchmark::State& state)
+{
+	int width      = state.range(0);
+	int height     = state.range(1);
+	auto generator = webrtc::test::CreateFromYuvFileFrameGenerator(
+	  { yuvFile(width, height) }, width, height, 1);
+
+	run(state, *generator, width, height);
+}
+BENCHMARK(yuvFileGenerator)->Apply(resolutions);
+
+static void scrollingImageGenerator(benchmark::State& state)
+{
+	int width  = state.range(0);
+	int height = state.range(1);
+	// The source image is half as large again, scrolled over one second.
+	int sourceWidth  = (width * 3 / 2) & ~1;
+	int sourceHeight = (height * 3 / 2) & ~1;
+	webrtc::SimulatedClock clock(0);
+	auto generator = webrtc::test::CreateScrollingInputFromYuvFilesFrameGenerator(
+	  &clock,
+	  { yuvFile(sourceWidth, sourceHeight) },
+	  sourceWidth,
+	  sourceHeight,
+	  width,
+	  height,
+	  /*scroll_time_ms*/ 1000,
+	  /*pause_time_ms*/ 0);
+	AllocationScope allocations;
+
+	for (auto _ : state)
+	{
+		clock.AdvanceTimeMilliseconds(33);
+
+		auto frame = generator->NextFrame();
+
+		benchmark::DoNotOptimize(frame.buffer);
+	}
+
+	allocations.Report(state);
+	setFrameRate(state, width, height);
+}
+BENCHMARK(scrollingImageGenerator)->Apply(resolutions);
+
+static void ivfGenerator(benchmark::State& state)
+{
+	int width      = state.range(0);
+	int height     = state.range(1);
+	auto generator = webrtc::test::CreateFromIvfFileFrameGenerator(ivfFile(width, height));
+
+	run(state, *generator, width, height);
+}
+BENCHMARK(ivfGenerator)->Apply(resolutions);
@@ -0,0 +1,70 @@
+#include "BenchUtils.hpp"
+#include "rtc_base/random.h"
+#include "test/frame_utils.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	void fillRandom(webrtc::Random& random, std::vector<uint8_t>& bytes)
+	{
+		for (auto& byte : bytes)
+		{
+			byte = static_cast<uint8_t>(random.Rand<uint32_t>());
+		}
+	}
+
+	// Luma plane of |width|x|height| pixels.
+	std::vector<uint8_t> randomPlane(int width, int height)
+	{
+		webrtc::Random random(0x12345678);
+		std::vector<uint8_t> plane(width * height);
+
+		fillRandom(random, plane);
+
+		return plane;
+	}
+} // namespace
+
+/* Benchmarks */
+
+// HashPlane() of a luma plane, with or without SIMD.
+static void hashPlane(benchmark::State& state, bool simd)
+{
+	int width  = state.range(0);
+	int height = state.range(1);
+	auto plane = randomPlane(width, height);
+	auto hash  = simd ? webrtc::test::HashPlane : webrtc::test::HashPlaneScalarForTesting;
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(hash(plane.data(), width, width, height, 0));
+	}
+
+	state.SetBytesProcessed(state.iterations() * width * height);
+}
+BENCHMARK_CAPTURE(hashPlane, simd, true)->Apply(resolutions);
+BENCHMARK_CAPTURE(hashPlane, scalar, false)->Apply(resolutions);
+
+// DiffPlaneRect() of a luma plane changed in a small area, with or without SIMD.
+static void diffPlaneRect(benchmark::State& state, bool simd)
+{
+	int width   = state.range(0);
+	int height  = state.range(1);
+	auto plane1 = randomPlane(width, height);
+	auto plane2 = plane1;
+	auto diff   = simd ? webrtc::test::DiffPlaneRect : webrtc::test::DiffPlaneRectScalarForTesting;
+
+	plane2[(height / 2) * width + width / 2] ^= 0xFF;
+	plane2[(height / 2 + 16) * width + width / 2 + 16] ^= 0xFF;
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(diff(plane1.data(), plane2.data(), width, width, width, height));
+	}
+
+	state.SetBytesProcessed(state.iterations() * width * height * 2);
+}
+BENCHMARK_CAPTURE(diffPlaneRect, simd, true)->Apply(resolutions);
+BENCHMARK_CAPTURE(diffPlaneRect, scalar, false)->Apply(resolutions);
@@ -527,8 +527,15 @@ void FakeAudioCaptureModule::SendFrameP() {
   bool key_pressed = false;
   uint32_t current_mic_level = 0;
   MicrophoneVolume(&current_mic_level);
+  const void* send_buffer = send_buffer_;
+  SendFrameSource* source =
+      send_frame_source_.load(std::memory_order_acquire);
+  if (source) {
+    source->FillFrame(source_buffer_, kNumberSamples, kSamplesPerSecond);
+    send_buffer = source_buffer_;
+  }
   if (audio_callback_->RecordedDataIsAvailable(
-          send_buffer_, kNumberSamples, kNumberBytesPerSample,
+          send_buffer, kNumberSamples, kNumberBytesPerSample,
           kNumberOfChannels, kSamplesPerSecond, kTotalDelayMs, kClockDriftMs,
           current_mic_level, key_pressed, current_mic_level) != 0) {
     RTC_NOTREACHED();
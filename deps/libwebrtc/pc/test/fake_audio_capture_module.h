@@ -20,6 +20,7 @@
 #ifndef PC_TEST_FAKE_AUDIO_CAPTURE_MODULE_H_
 #define PC_TEST_FAKE_AUDIO_CAPTURE_MODULE_H_
 
+#include <atomic>
 #include <memory>
 
 #include "api/scoped_refptr.h"
@@ -49,6 +50,24 @@ class FakeAudioCaptureModule : public webrtc::AudioDeviceModule,
   // pulled frame was generated/pushed from a FakeAudioCaptureModule.
   int frames_received() const;
 
+  // Fills the frames pushed to the registered webrtc::AudioTransport instead
+  // of the constant send buffer, e.g. to embed markers in them.
+  class SendFrameSource {
+   public:
+    virtual ~SendFrameSource() = default;
+
+    // |samples| holds |number_of_samples| mono samples at |sample_rate|.
+    virtual void FillFrame(int16_t* samples,
+                           size_t number_of_samples,
+                           int sample_rate) = 0;
+  };
+
+  // |source| must outlive the instance. Pass nullptr to send the constant
+  // buffer again.
+  void SetSendFrameSource(SendFrameSource* source) {
+    send_frame_source_.store(source, std::memory_order_release);
+  }
+
   int32_t ActiveAudioLayer(AudioLayer* audio_layer) const override;
 
   // Note: Calling this method from a callback may result in deadlock.
@@ -211,6 +230,10 @@ class FakeAudioCaptureModule : public webrtc::AudioDeviceModule,
   char rec_buffer_[kNumberSamples * kNumberBytesPerSample];
   // Buffer for samples to send to the webrtc::AudioTransport.
   char send_buffer_[kNumberSamples * kNumberBytesPerSample];
+  // Buffer filled by |send_frame_source_|, if any.
+  int16_t source_buffer_[kNumberSamples];
+  // Not guarded by |crit_| so it can be set while processing.
+  std::atomic<SendFrameSource*> send_frame_source_{nullptr};
 
   // Counter of frames received that have samples of high enough amplitude to
   // indicate that the frames are not faked somewhere in the audio pipeline
@@ -70,6 +70,8 @@ class FrameGeneratorCapturerVideoTrackSource : public VideoTrackSource {
 
   bool is_screencast() const override { return is_screencast_; }
 
+  test::FrameGeneratorCapturer* capturer() { return video_capturer_.get(); }
+
  protected:
   rtc::VideoSourceInterface<VideoFrame>* source() override {
     return video_capturer_.get();
@@ -178,6 +178,10 @@ bool FrameGeneratorCapturer::Init() {
 void FrameGeneratorCapturer::InsertFrame() {
   rtc::CritScope cs(&lock_);
   if (sending_) {
+    // Taken before generating the frame so that tracing covers generation.
+    int64_t capture_time_us = clock_->TimeInMicroseconds();
+    Trace(FrameTraceObserver::Point::kCaptureStart, capture_time_us);
+
     FrameGeneratorInterface::VideoFrameData frame_data =
         frame_generator_->NextFrame();
     // TODO(srte): Use more advanced frame rate control to allow arbritrary
@@ -190,7 +194,7 @@ void FrameGeneratorCapturer::InsertFrame() {
     VideoFrame frame = VideoFrame::Builder()
                            .set_video_frame_buffer(frame_data.buffer)
                            .set_rotation(fake_rotation_)
-                           .set_timestamp_us(clock_->TimeInMicroseconds())
+                           .set_timestamp_us(capture_time_us)
                            .set_ntp_time_ms(clock_->CurrentNtpInMilliseconds())
                            .set_update_rect(frame_data.update_rect)
                            .set_color_space(fake_color_space_)
@@ -199,6 +203,7 @@ void FrameGeneratorCapturer::InsertFrame() {
       first_frame_capture_time_ = frame.ntp_time_ms();
     }
 
+    Trace(FrameTraceObserver::Point::kCaptureEnd, capture_time_us);
     TestVideoCapturer::OnFrame(frame);
   }
 }
@@ -13,11 +13,293 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include "api/video/i420_buffer.h"
 #include "api/video/video_frame.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FRAME_UTILS_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FRAME_UTILS_NEON
+#endif
+
 namespace webrtc {
 namespace test {
+namespace {
+
+constexpr int kStripeSize = 64;
+constexpr int kLanes = 8;
+constexpr int kStripesPerBlock = 16;
+// Each stripe of a block reads the secret 8 bytes further, as in XXH3.
+constexpr int kSecretSize = kLanes * 8 + (kStripesPerBlock - 1) * 8 + 8;
+
+constexpr uint64_t kPrime32_1 = 0x9E3779B1u;
+constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4Full;
+
+uint64_t Read64(const uint8_t* data) {
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// Pseudo random secret, generated once with splitmix64.
+const uint8_t* Secret() {
+  static const auto* secret = [] {
+    auto* bytes = new uint8_t[kSecretSize];
+    uint64_t state = kPrime64_2;
+    for (int i = 0; i < kSecretSize; i += 8) {
+      uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      z ^= z >> 31;
+      memcpy(bytes + i, &z, sizeof(z));
+    }
+    return bytes;
+  }();
+  return secret;
+}
+
+uint64_t Mul128Fold64(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+  return static_cast<uint64_t>(product) ^
+         static_cast<uint64_t>(product >> 64);
+#else
+  uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+  uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+  uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+  uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+  uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+  return lower ^ upper;
+#endif
+}
+
+uint64_t Avalanche(uint64_t hash) {
+  hash ^= hash >> 37;
+  hash *= 0x165667919E3779F9ull;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+// Adds a 64-byte stripe to the accumulators: each lane gets the product of
+// the low and high halves of its keyed input, and its neighbour the input
+// itself, so that no input bit is lost in a zero product. The kernels run
+// their portable version for |simd| false, which must give the same result.
+template <bool simd>
+void AccumulateStripe(uint64_t* acc, const uint8_t* data, const uint8_t* key) {
+#if defined(FRAME_UTILS_SSE2)
+  if (simd) {
+    for (int i = 0; i < kLanes / 2; ++i) {
+      __m128i* acc_lanes = reinterpret_cast<__m128i*>(acc) + i;
+      __m128i value =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(data) + i);
+      __m128i keyed = _mm_xor_si128(
+          value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key) + i));
+      __m128i product = _mm_mul_epu32(
+          keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+      __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+      _mm_storeu_si128(
+          acc_lanes,
+          _mm_add_epi64(_mm_loadu_si128(acc_lanes),
+                        _mm_add_epi64(product, swapped)));
+    }
+    return;
+  }
+#elif defined(FRAME_UTILS_NEON)
+  if (simd) {
+    for (int i = 0; i < kLanes / 2; ++i) {
+      uint64x2_t value = vreinterpretq_u64_u8(vld1q_u8(data + 16 * i));
+      uint64x2_t keyed =
+          veorq_u64(value, vreinterpretq_u64_u8(vld1q_u8(key + 16 * i)));
+      uint64x2_t sum =
+          vaddq_u64(vld1q_u64(acc + 2 * i), vextq_u64(value, value, 1));
+      sum = vmlal_u32(sum, vmovn_u64(keyed), vshrn_n_u64(keyed, 32));
+      vst1q_u64(acc + 2 * i, sum);
+    }
+    return;
+  }
+#endif
+  for (int i = 0; i < kLanes; ++i) {
+    uint64_t value = Read64(data + 8 * i);
+    uint64_t keyed = value ^ Read64(key + 8 * i);
+    acc[i ^ 1] += value;
+    acc[i] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+  }
+}
+
+void Scramble(uint64_t* acc, const uint8_t* key) {
+  for (int i = 0; i < kLanes; ++i) {
+    uint64_t lane = acc[i];
+    lane ^= lane >> 47;
+    lane ^= Read64(key + 8 * i);
+    acc[i] = lane * kPrime32_1;
+  }
+}
+
+// Index of the first byte differing in [begin, end), or |end|.
+template <bool simd>
+int FirstDifference(const uint8_t* data1,
+                    const uint8_t* data2,
+                    int begin,
+                    int end) {
+  int x = begin;
+#if defined(FRAME_UTILS_SSE2)
+  for (; simd && x + 16 <= end; x += 16) {
+    int equal = _mm_movemask_epi8(_mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data1 + x)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data2 + x))));
+    if (equal != 0xFFFF)
+      return x + __builtin_ctz(~equal);
+  }
+#elif defined(FRAME_UTILS_NEON)
+  for (; simd && x + 16 <= end; x += 16) {
+    uint8x16_t differ =
+        vmvnq_u8(vceqq_u8(vld1q_u8(data1 + x), vld1q_u8(data2 + x)));
+    // 4 bits per byte.
+    uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(differ), 4)), 0);
+    if (mask)
+      return x + __builtin_ctzll(mask) / 4;
+  }
+#endif
+  for (; x < end; ++x) {
+    if (data1[x] != data2[x])
+      return x;
+  }
+  return end;
+}
+
+// Index of the last byte differing in [begin, end), or |begin| - 1.
+template <bool simd>
+int LastDifference(const uint8_t* data1,
+                   const uint8_t* data2,
+                   int begin,
+                   int end) {
+  int x = end;
+#if defined(FRAME_UTILS_SSE2)
+  for (; simd && x - 16 >= begin; x -= 16) {
+    int equal = _mm_movemask_epi8(_mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data1 + x - 16)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data2 + x - 16))));
+    if (equal != 0xFFFF)
+      return x - 16 + 31 - __builtin_clz(~equal & 0xFFFF);
+  }
+#elif defined(FRAME_UTILS_NEON)
+  for (; simd && x - 16 >= begin; x -= 16) {
+    uint8x16_t differ = vmvnq_u8(
+        vceqq_u8(vld1q_u8(data1 + x - 16), vld1q_u8(data2 + x - 16)));
+    uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(differ), 4)), 0);
+    if (mask)
+      return x - 16 + (63 - __builtin_clzll(mask)) / 4;
+  }
+#endif
+  for (--x; x >= begin; --x) {
+    if (data1[x] != data2[x])
+      return x;
+  }
+  return begin - 1;
+}
+
+VideoFrame::UpdateRect FullRect(int width, int height) {
+  return VideoFrame::UpdateRect{0, 0, width, height};
+}
+
+// Maps a chroma plane rectangle to luma pixels, clipped to the frame.
+VideoFrame::UpdateRect ChromaToLuma(const VideoFrame::UpdateRect& rect,
+                                    int width,
+                                    int height) {
+  if (rect.IsEmpty())
+    return rect;
+  int x = rect.offset_x * 2;
+  int y = rect.offset_y * 2;
+  return VideoFrame::UpdateRect{x, y,
+                                std::min(rect.width * 2, width - x),
+                                std::min(rect.height * 2, height - y)};
+}
+
+template <bool simd>
+uint64_t HashPlaneImpl(const uint8_t* data,
+                       int stride,
+                       int width,
+                       int height,
+                       uint64_t seed) {
+  const uint8_t* secret = Secret();
+  uint64_t acc[kLanes] = {kPrime32_1, kPrime64_1, kPrime64_2, seed,
+                          ~seed,      kPrime64_2, kPrime64_1, kPrime32_1};
+  uint8_t tail[kStripeSize];
+  int stripe = 0;
+
+  auto accumulate = [&](const uint8_t* input) {
+    AccumulateStripe<simd>(acc, input, secret + 8 * stripe);
+    if (++stripe == kStripesPerBlock) {
+      Scramble(acc, secret + kSecretSize - kLanes * 8);
+      stripe = 0;
+    }
+  };
+
+  // Rows are hashed as stripes followed by a zero padded partial stripe, so
+  // that the stride does not matter.
+  for (int y = 0; y < height; ++y) {
+    const uint8_t* row = data + static_cast<ptrdiff_t>(y) * stride;
+    int x = 0;
+    for (; x + kStripeSize <= width; x += kStripeSize)
+      accumulate(row + x);
+    if (x < width) {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, row + x, width - x);
+      accumulate(tail);
+    }
+  }
+
+  uint64_t hash = seed ^ (static_cast<uint64_t>(width) << 32 | height) *
+                             kPrime64_1;
+  for (int i = 0; i < kLanes; i += 2) {
+    hash += Mul128Fold64(acc[i] ^ Read64(secret + 11 + 8 * i),
+                         acc[i + 1] ^ Read64(secret + 19 + 8 * i));
+  }
+  return Avalanche(hash);
+}
+
+template <bool simd>
+VideoFrame::UpdateRect DiffPlaneRectImpl(const uint8_t* data1,
+                                         const uint8_t* data2,
+                                         int stride1,
+                                         int stride2,
+                                         int width,
+                                         int height) {
+  int left = width;
+  int right = -1;
+  int top = -1;
+  int bottom = -1;
+
+  for (int y = 0; y < height; ++y) {
+    const uint8_t* row1 = data1 + static_cast<ptrdiff_t>(y) * stride1;
+    const uint8_t* row2 = data2 + static_cast<ptrdiff_t>(y) * stride2;
+    int first = FirstDifference<simd>(row1, row2, 0, width);
+    if (first == width)
+      continue;
+    if (top < 0)
+      top = y;
+    bottom = y;
+    left = std::min(left, first);
+    // Only what lies beyond the current right edge matters.
+    right = std::max(right, LastDifference<simd>(
+                                row1, row2, std::max(first, right + 1), width));
+  }
+
+  if (top < 0)
+    return VideoFrame::UpdateRect{0, 0, 0, 0};
+  return VideoFrame::UpdateRect{left, top, right - left + 1, bottom - top + 1};
+}
+
+}  // namespace
 
 bool EqualPlane(const uint8_t* data1,
                 const uint8_t* data2,
@@ -25,6 +307,9 @@ bool EqualPlane(const uint8_t* data1,
                 int stride2,
                 int width,
                 int height) {
+  // Contiguous planes are compared at once.
+  if (stride1 == width && stride2 == width)
+    return memcmp(data1, data2, static_cast<size_t>(width) * height) == 0;
   for (int y = 0; y < height; ++y) {
     if (memcmp(data1, data2, width) != 0)
       return false;
@@ -87,5 +372,84 @@ rtc::scoped_refptr<I420Buffer> ReadI420Buffer(int width, int height, FILE* f) {
   return buffer;
 }
 
+uint64_t HashPlane(const uint8_t* data,
+                   int stride,
+                   int width,
+                   int height,
+                   uint64_t seed) {
+  return HashPlaneImpl<true>(data, stride, width, height, seed);
+}
+
+uint64_t HashPlaneScalarForTesting(const uint8_t* data,
+                                   int stride,
+                                   int width,
+                                   int height,
+                                   uint64_t seed) {
+  return HashPlaneImpl<false>(data, stride, width, height, seed);
+}
+
+uint64_t HashFrameBuffer(const rtc::scoped_refptr<VideoFrameBuffer>& buffer) {
+  if (!buffer)
+    return 0;
+  rtc::scoped_refptr<const I420BufferInterface> i420 =
+      buffer->GetI420() ? buffer->GetI420() : buffer->ToI420().get();
+  uint64_t hash = HashPlane(i420->DataY(), i420->StrideY(), i420->width(),
+                            i420->height());
+  hash = HashPlane(i420->DataU(), i420->StrideU(), i420->ChromaWidth(),
+                   i420->ChromaHeight(), hash);
+  return HashPlane(i420->DataV(), i420->StrideV(), i420->ChromaWidth(),
+                   i420->ChromaHeight(), hash);
+}
+
+VideoFrame::UpdateRect DiffPlaneRect(const uint8_t* data1,
+                                     const uint8_t* data2,
+                                     int stride1,
+                                     int stride2,
+                                     int width,
+                                     int height) {
+  return DiffPlaneRectImpl<true>(data1, data2, stride1, stride2, width,
+                                 height);
+}
+
+VideoFrame::UpdateRect DiffPlaneRectScalarForTesting(const uint8_t* data1,
+                                                     const uint8_t* data2,
+                                                     int stride1,
+                                                     int stride2,
+                                                     int width,
+                                                     int height) {
+  return DiffPlaneRectImpl<false>(data1, data2, stride1, stride2, width,
+                                  height);
+}
+
+VideoFrame::UpdateRect DiffFrameRect(
+    const rtc::scoped_refptr<VideoFrameBuffer>& f1,
+    const rtc::scoped_refptr<VideoFrameBuffer>& f2) {
+  if (!f1 || !f2)
+    return FullRect(f1 ? f1->width() : f2 ? f2->width() : 0,
+                    f1 ? f1->height() : f2 ? f2->height() : 0);
+  if (f1->width() != f2->width() || f1->height() != f2->height())
+    return FullRect(f2->width(), f2->height());
+
+  rtc::scoped_refptr<const I420BufferInterface> i1 =
+      f1->GetI420() ? f1->GetI420() : f1->ToI420().get();
+  rtc::scoped_refptr<const I420BufferInterface> i2 =
+      f2->GetI420() ? f2->GetI420() : f2->ToI420().get();
+  int width = i1->width();
+  int height = i1->height();
+
+  VideoFrame::UpdateRect rect =
+      DiffPlaneRect(i1->DataY(), i2->DataY(), i1->StrideY(), i2->StrideY(),
+                    width, height);
+  rect.Union(ChromaToLuma(
+      DiffPlaneRect(i1->DataU(), i2->DataU(), i1->StrideU(), i2->StrideU(),
+                    i1->ChromaWidth(), i1->ChromaHeight()),
+      width, height));
+  rect.Union(ChromaToLuma(
+      DiffPlaneRect(i1->DataV(), i2->DataV(), i1->StrideV(), i2->StrideV(),
+                    i1->ChromaWidth(), i1->ChromaHeight()),
+      width, height));
+  return rect;
+}
+
 }  // namespace test
 }  // namespace webrtc
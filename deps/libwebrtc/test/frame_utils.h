@@ -13,10 +13,10 @@
 #include <stdint.h>
 
 #include "api/scoped_refptr.h"
+#include "api/video/video_frame.h"
 
 namespace webrtc {
 class I420Buffer;
-class VideoFrame;
 class VideoFrameBuffer;
 namespace test {
 
@@ -42,6 +42,50 @@ bool FrameBufsEqual(const rtc::scoped_refptr<webrtc::VideoFrameBuffer>& f1,
 
 rtc::scoped_refptr<I420Buffer> ReadI420Buffer(int width, int height, FILE*);
 
+// 64-bit hash of the |width| x |height| pixels of a plane, regardless of its
+// stride. XXH3-like: 64-byte stripes are accumulated with SSE2 or NEON when
+// available, so that hashing a 4K frame costs little more than reading it.
+// Not compatible with XXH3 itself, nor meant to resist attacks.
+uint64_t HashPlane(const uint8_t* data,
+                   int stride,
+                   int width,
+                   int height,
+                   uint64_t seed = 0);
+
+// HashPlane() without SIMD, to check that both give the same hashes.
+uint64_t HashPlaneScalarForTesting(const uint8_t* data,
+                                   int stride,
+                                   int width,
+                                   int height,
+                                   uint64_t seed = 0);
+
+// Hash of the I420 planes of |buffer|, converting it only if not I420.
+uint64_t HashFrameBuffer(const rtc::scoped_refptr<VideoFrameBuffer>& buffer);
+
+// Bounding box of the pixels that differ between two planes, empty if they
+// are equal.
+VideoFrame::UpdateRect DiffPlaneRect(const uint8_t* data1,
+                                     const uint8_t* data2,
+                                     int stride1,
+                                     int stride2,
+                                     int width,
+                                     int height);
+
+// DiffPlaneRect() without SIMD.
+VideoFrame::UpdateRect DiffPlaneRectScalarForTesting(const uint8_t* data1,
+                                                     const uint8_t* data2,
+                                                     int stride1,
+                                                     int stride2,
+                                                     int width,
+                                                     int height);
+
+// Bounding box, in luma pixels, of the pixels that differ between two frame
+// buffers of the same size, in any plane. The whole frame if the sizes
+// differ or a buffer is null.
+VideoFrame::UpdateRect DiffFrameRect(
+    const rtc::scoped_refptr<VideoFrameBuffer>& f1,
+    const rtc::scoped_refptr<VideoFrameBuffer>& f2);
+
 }  // namespace test
 }  // namespace webrtc
 
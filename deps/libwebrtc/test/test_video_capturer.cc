@@ -29,10 +29,13 @@ void TestVideoCapturer::OnFrame(const VideoFrame& original_frame) {
 
   VideoFrame frame = MaybePreprocess(original_frame);
 
+  Trace(FrameTraceObserver::Point::kAdaptStart, frame.timestamp_us());
+
   if (!video_adapter_.AdaptFrameResolution(
           frame.width(), frame.height(), frame.timestamp_us() * 1000,
           &cropped_width, &cropped_height, &out_width, &out_height)) {
     // Drop frame in order to respect frame rate constraint.
+    Trace(FrameTraceObserver::Point::kDropped, frame.timestamp_us());
     return;
   }
 
@@ -55,14 +58,24 @@ void TestVideoCapturer::OnFrame(const VideoFrame& original_frame) {
           out_width, out_height);
       new_frame_builder.set_update_rect(new_rect);
     }
+    Trace(FrameTraceObserver::Point::kAdaptEnd, frame.timestamp_us());
     broadcaster_.OnFrame(new_frame_builder.build());
 
   } else {
     // No adaptations needed, just return the frame as is.
+    Trace(FrameTraceObserver::Point::kAdaptEnd, frame.timestamp_us());
     broadcaster_.OnFrame(frame);
   }
 }
 
+void TestVideoCapturer::Trace(FrameTraceObserver::Point point,
+                              int64_t capture_time_us) {
+  FrameTraceObserver* observer =
+      trace_observer_.load(std::memory_order_acquire);
+  if (observer)
+    observer->OnTracePoint(point, capture_time_us);
+}
+
 rtc::VideoSinkWants TestVideoCapturer::GetSinkWants() {
   return broadcaster_.wants();
 }
@@ -11,7 +11,9 @@
 #define TEST_TEST_VIDEO_CAPTURER_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include <atomic>
 #include <memory>
 
 #include "api/video/video_frame.h"
@@ -32,6 +34,24 @@ class TestVideoCapturer : public rtc::VideoSourceInterface<VideoFrame> {
     virtual VideoFrame Preprocess(const VideoFrame& frame) = 0;
   };
 
+  // Observes the progress of each frame through the capturer, e.g. for
+  // latency tracing. Called on the capture thread.
+  class FrameTraceObserver {
+   public:
+    enum class Point {
+      kCaptureStart,
+      kCaptureEnd,
+      kAdaptStart,
+      kAdaptEnd,
+      kDropped,
+    };
+
+    virtual ~FrameTraceObserver() = default;
+
+    // |capture_time_us| is the timestamp_us() of the frame.
+    virtual void OnTracePoint(Point point, int64_t capture_time_us) = 0;
+  };
+
   ~TestVideoCapturer() override;
 
   void AddOrUpdateSink(rtc::VideoSinkInterface<VideoFrame>* sink,
@@ -41,10 +61,15 @@ class TestVideoCapturer : public rtc::VideoSourceInterface<VideoFrame> {
     rtc::CritScope crit(&lock_);
     preprocessor_ = std::move(preprocessor);
   }
+  // |observer| must outlive the capturer. Pass nullptr to stop tracing.
+  void SetFrameTraceObserver(FrameTraceObserver* observer) {
+    trace_observer_.store(observer, std::memory_order_release);
+  }
 
  protected:
   void OnFrame(const VideoFrame& frame);
   rtc::VideoSinkWants GetSinkWants();
+  void Trace(FrameTraceObserver::Point point, int64_t capture_time_us);
 
  private:
   void UpdateVideoAdapter();
@@ -52,6 +77,8 @@ class TestVideoCapturer : public rtc::VideoSourceInterface<VideoFrame> {
 
   rtc::CriticalSection lock_;
   std::unique_ptr<FramePreprocessor> preprocessor_ RTC_GUARDED_BY(lock_);
+  // Not guarded by |lock_| so tracing never contends with the capturer.
+  std::atomic<FrameTraceObserver*> trace_observer_{nullptr};
   rtc::VideoBroadcaster broadcaster_;
   cricket::VideoAdapter video_adapter_;
 };
@@ -0,0 +1,126 @@
+#ifndef ASYNC_LOGGER_HPP
+#define ASYNC_LOGGER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/* Asynchronous process wide logger.
+ *
+ * Messages are formatted on the calling thread and queued into a bounded
+ * lock-free ring, a background thread writes them in batches and flushes once
+ * per batch. Logging never blocks: if the ring is full the message is dropped
+ * and counted. Messages logged while the logger is not running are written
+ * synchronously.
+ *
+ * Every BCST_* call site is rate limited on its own, the number of suppressed
+ * messages is reported with the next message that gets through.
+ *
+ *   BCST_INFO << "producer created [id:" << producer->GetId() << "]";
+ */
+class AsyncLogger
+{
+public:
+	enum class Level : uint8_t
+	{
+		kDebug = 0,
+		kInfo,
+		kWarn,
+		kError
+	};
+
+	enum class Format : uint8_t
+	{
+		kText = 0,
+		kJson
+	};
+
+	struct Options
+	{
+		Level level{ Level::kInfo };
+		Format format{ Format::kText };
+		// Written to stdout (stderr for warnings and errors) if empty.
+		std::string file;
+		// Messages per second and call site, 0 for no limit.
+		uint32_t rateLimit{ 100 };
+	};
+
+	static constexpr size_t kQueueSize      = 4096;
+	static constexpr size_t kMaxMessageSize = 1024;
+
+	class RateLimiter
+	{
+	public:
+		// Returns the number of messages suppressed so far in |suppressed|.
+		bool Allow(uint32_t& suppressed);
+
+	private:
+		std::atomic<int64_t> second{ 0 };
+		std::atomic<uint32_t> count{ 0 };
+		std::atomic<uint32_t> suppressedCount{ 0 };
+	};
+
+	// Collects a message and queues it on destruction.
+	class Message
+	{
+	public:
+		Message(Level level, uint32_t suppressed);
+		~Message();
+
+		std::ostream& Stream();
+
+	private:
+		struct Buffer;
+
+		Level level;
+		uint32_t suppressed;
+		Buffer* buffer;
+		bool ownBuffer;
+	};
+
+	static bool ParseLevel(const std::string& name, Level& level);
+	static bool ParseFormat(const std::string& name, Format& format);
+
+	static void Start(const Options& options);
+	// Writes the queued messages and stops the writer thread.
+	static void Stop();
+
+	static bool IsEnabled(Level level)
+	{
+		return static_cast<uint8_t>(level) >= minLevel.load(std::memory_order_relaxed);
+	}
+
+	static void Write(Level level, const char* data, size_t size, uint32_t suppressed = 0);
+
+	// Routes mediasoupclient logs, at the level matching ours, through the logger.
+	static void RouteMediasoupclientLogs();
+	// Routes libwebrtc logs of |severity| ("info", "warn" or "error") and above.
+	// Does nothing for other values.
+	static void RouteWebrtcLogs(const std::string& severity);
+
+private:
+	static std::atomic<uint8_t> minLevel;
+};
+
+// Per call site limiter, each lambda has its own static.
+#define BCST_RATE_LIMITER()                                                                        \
+	([]() -> AsyncLogger::RateLimiter& {                                                             \
+		static AsyncLogger::RateLimiter limiter;                                                       \
+		return limiter;                                                                                \
+	}())
+
+// A single iteration loop rather than an if/else, so that it can be the body
+// of an unbraced if.
+#define BCST_LOG(level)                                                                            \
+	for (uint32_t bcstSuppressed = 0, bcstOnce = 1;                                                  \
+	     bcstOnce && AsyncLogger::IsEnabled(level) && BCST_RATE_LIMITER().Allow(bcstSuppressed);     \
+	     bcstOnce = 0)                                                                               \
+	AsyncLogger::Message(level, bcstSuppressed).Stream()
+
+#define BCST_DEBUG BCST_LOG(AsyncLogger::Level::kDebug)
+#define BCST_INFO BCST_LOG(AsyncLogger::Level::kInfo)
+#define BCST_WARN BCST_LOG(AsyncLogger::Level::kWarn)
+#define BCST_ERROR BCST_LOG(AsyncLogger::Level::kError)
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef BATCHING_SOCKET_SERVER_HPP
+#define BATCHING_SOCKET_SERVER_HPP
+
+#include "rtc_base/physical_socket_server.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/* Socket server of the network thread batching the UDP system calls.
+ *
+ * Every RTP, RTCP and STUN packet goes through the UDP sockets the packet
+ * socket factory creates from the socket server of the network thread, one
+ * system call per packet. These sockets are wrapped here so that:
+ *
+ * - Datagrams sent are queued and sent with a single sendmmsg() per socket
+ *   when the network thread is done with its messages and about to wait,
+ *   after each read event, or when batchSize of them are queued.
+ * - Readable sockets are read with recvmmsg(), the datagrams read ahead being
+ *   handed to libwebrtc one by one as it reads a single one per read event.
+ *
+ * With segmentationOffload, runs of queued datagrams of the same size to the
+ * same destination are sent as a single UDP GSO (UDP_SEGMENT) message, the
+ * kernel or the NIC splitting it, and the sockets let the kernel coalesce the
+ * datagrams received (UDP_GRO), split here again. Either is left off if the
+ * kernel does not support it, and GSO is turned off for good on the first send
+ * it makes fail (e.g. EIO without checksum offload).
+ *
+ * Datagrams dropped by a failing sendmmsg() are counted, as PhysicalSocket
+ * drops them on EWOULDBLOCK anyway. Linux only, elsewhere the sockets are left
+ * as they are.
+ */
+class BatchingSocketServer : public rtc::PhysicalSocketServer
+{
+public:
+	// The kernel caps sendmmsg() and recvmmsg() to UIO_MAXIOV messages.
+	static constexpr uint32_t kMaxBatchSize = 1024;
+
+	struct Options
+	{
+		// Datagrams per system call at most, up to kMaxBatchSize.
+		uint32_t batchSize{ 32 };
+		// UDP GSO and GRO, where supported.
+		bool segmentationOffload{ false };
+		// Seconds between reports of the counters, 0 for none.
+		uint32_t reportIntervalSeconds{ 10 };
+	};
+
+	struct Stats
+	{
+		std::atomic<uint64_t> sentPackets{ 0 };
+		std::atomic<uint64_t> sendCalls{ 0 };
+		std::atomic<uint64_t> sendErrors{ 0 };
+		std::atomic<uint64_t> receivedPackets{ 0 };
+		std::atomic<uint64_t> receiveCalls{ 0 };
+		// GSO messages sent, and the datagrams they carried.
+		std::atomic<uint64_t> gsoSends{ 0 };
+		std::atomic<uint64_t> gsoSegments{ 0 };
+		// GRO datagrams received, and the datagrams they coalesced.
+		std::atomic<uint64_t> groReceives{ 0 };
+		std::atomic<uint64_t> groSegments{ 0 };
+	};
+
+public:
+	explicit BatchingSocketServer(const Options& options);
+	~BatchingSocketServer() override;
+
+	const Stats& GetStats() const
+	{
+		return this->stats;
+	}
+
+	/* Virtual methods inherited from rtc::PhysicalSocketServer. */
+public:
+	rtc::AsyncSocket* CreateAsyncSocket(int family, int type) override;
+	bool Wait(int cms, bool processIo) override;
+
+private:
+	class UdpSocket;
+
+	// Plain copy of the Stats.
+	struct Counters
+	{
+		uint64_t sentPackets{ 0 };
+		uint64_t sendCalls{ 0 };
+		uint64_t receivedPackets{ 0 };
+		uint64_t receiveCalls{ 0 };
+		uint64_t gsoSends{ 0 };
+		uint64_t gsoSegments{ 0 };
+		uint64_t groReceives{ 0 };
+		uint64_t groSegments{ 0 };
+	};
+
+	// Sends what the sockets have queued.
+	void Flush();
+	void DisableGso(int error);
+	void Report();
+
+private:
+	Options options;
+	Stats stats;
+
+	// Network thread only.
+	// Whether the kernel supports them, and GSO did not fail.
+	bool gso{ false };
+	bool gro{ false };
+	// Sockets with datagrams queued.
+	std::vector<UdpSocket*> pendingSockets;
+	int64_t reportedAtMs{ 0 };
+	Counters reported;
+};
+
+#endif
@@ -1,20 +1,36 @@
 #ifndef BROADCASTER_H
 #define BROADCASTER_H
 
+#include "ConsumerMonitor.hpp"
+#include "ControlServer.hpp"
+#include "DataChannelBenchmark.hpp"
+#include "DataMessageDispatcher.hpp"
+#include "DataSender.hpp"
+#include "FileTransfer.hpp"
+#include "FrameTracer.hpp"
+#include "JoinTimer.hpp"
+#include "LatencyProbe.hpp"
+#include "StatsCollector.hpp"
+#include "StreamRecorder.hpp"
+#include "TransportRecovery.hpp"
 #include "mediasoupclient.hpp"
 #include "json.hpp"
+#include "test/frame_generator_capturer.h"
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <future>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 class Broadcaster : public
                     mediasoupclient::SendTransport::Listener,
                     mediasoupclient::RecvTransport::Listener,
                     mediasoupclient::Producer::Listener,
-                    mediasoupclient::DataProducer::Listener,
-                    mediasoupclient::DataConsumer::Listener
+                    mediasoupclient::Consumer::Listener,
+                    mediasoupclient::DataProducer::Listener
 {
 public:
 	struct TimerKiller
@@ -32,6 +48,11 @@ public:
 			terminate = true; // Should be modified inside mutex lock.
 			cv.notify_all();  // It is safe, and *sometimes* optimal, to do this outside the lock.
 		}
+		void Reset()
+		{
+			std::unique_lock<std::mutex> lock(m);
+			terminate = false;
+		}
 
 	private:
 		mutable std::condition_variable cv;
@@ -62,24 +83,9 @@ public:
 public:
 	void OnTransportClose(mediasoupclient::Producer* producer) override;
 
-	/* Virtual methods inherited from DataConsumer::Listener */
+	/* Virtual methods inherited from Consumer::Listener. */
 public:
-	void OnMessage(mediasoupclient::DataConsumer* dataConsumer, const webrtc::DataBuffer& buffer) override;
-	void OnConnecting(mediasoupclient::DataConsumer* dataConsumer) override
-	{
-	}
-	void OnClosing(mediasoupclient::DataConsumer* dataConsumer) override
-	{
-	}
-	void OnClose(mediasoupclient::DataConsumer* dataConsumer) override
-	{
-	}
-	void OnOpen(mediasoupclient::DataConsumer* dataConsumer) override
-	{
-	}
-	void OnTransportClose(mediasoupclient::DataConsumer* dataConsumer) override
-	{
-	}
+	void OnTransportClose(mediasoupclient::Consumer* consumer) override;
 
 	/* Virtual methods inherited from DataProducer::Listener */
 public:
@@ -89,7 +95,8 @@ public:
 	void OnTransportClose(mediasoupclient::DataProducer* dataProducer) override;
 
 public:
-	void Start(
+	// Returns false if joining the room failed.
+	bool Start(
 	  const std::string& baseUrl,
 	  bool enableAudio,
 	  bool useSimulcast,
@@ -97,28 +104,128 @@ public:
 	  bool verifySsl = true);
 	void Stop();
 
+	/* Must be called before Start(). */
+	void SetDataSenderOptions(const DataSender::Options& options);
+	void SetRecoveryOptions(const TransportRecovery::Options& options);
+	// Deadline of the request deleting the broadcaster when leaving.
+	void SetLeaveTimeout(uint32_t timeoutMs);
+	// Video codec name ("VP8", "VP9", "H264" or "AV1"), the first one negotiated if empty.
+	void SetVideoCodec(const std::string& name);
+	void EnableDataBenchmark(const DataChannelBenchmark::Options& options);
+	void EnableLatencyProbe(const LatencyProbe::Options& options);
+	void EnableFileTransfer(const FileTransfer::Options& options);
+	void EnableStats(const StatsCollector::Options& options);
+	void EnableFrameTrace(const FrameTracer::Options& options);
+	// Stamps the capture time into the video frames, see FrameStamp.
+	void EnableTimestampOverlay();
+	// Consumes the Producers of the other peers in the room.
+	void EnableConsumers(const ConsumerMonitor::Options& options);
+	// Serves the runtime control API, see HandleControl().
+	void EnableControl(const ControlServer::Options& options);
+	// Records the encoded audio and video sent, see StreamRecorder.
+	void EnableRecording(const StreamRecorder::Options& options);
+	// |joinTimer| must outlive the Broadcaster.
+	void SetJoinTimer(JoinTimer* joinTimer);
+
+	// Waits for the first RTP packet sent and for the chat DataProducer to open,
+	// recording them into the join timer. Returns false on timeout.
+	bool WaitForMedia(std::chrono::milliseconds timeout);
+
+	Broadcaster();
 	~Broadcaster();
 
 private:
 	mediasoupclient::Device device;
 	mediasoupclient::SendTransport* sendTransport{ nullptr };
 	mediasoupclient::RecvTransport* recvTransport{ nullptr };
+	mediasoupclient::Producer* audioProducer{ nullptr };
+	mediasoupclient::Producer* videoProducer{ nullptr };
+	std::vector<mediasoupclient::Consumer*> consumers;
 	mediasoupclient::DataProducer* dataProducer{ nullptr };
 	mediasoupclient::DataConsumer* dataConsumer{ nullptr };
+	mediasoupclient::DataProducer* benchmarkDataProducer{ nullptr };
+	mediasoupclient::DataConsumer* benchmarkDataConsumer{ nullptr };
+	mediasoupclient::DataProducer* probeDataProducer{ nullptr };
+	mediasoupclient::DataConsumer* probeDataConsumer{ nullptr };
+	mediasoupclient::DataProducer* fileDataProducer{ nullptr };
+	mediasoupclient::DataConsumer* fileDataConsumer{ nullptr };
 
 	std::string id = std::to_string(rtc::CreateRandomId());
 	std::string baseUrl;
+	bool enableAudio{ true };
+	bool useSimulcast{ true };
+	std::string videoCodec;
+	bool timestampOverlay{ false };
 	std::thread sendDataThread;
 
 	struct TimerKiller timerKiller;
 	bool verifySsl = true;
+	// Whether the broadcaster exists in the server.
+	bool joined{ false };
+	uint32_t leaveTimeoutMs{ 1000 };
+
+	DataMessageDispatcher dataMessageDispatcher;
+	DataSender::Options dataSenderOptions;
+	std::unique_ptr<DataSender> chatSender;
+	size_t sctpMaxMessageSize{ 256 * 1024 };
+	std::unique_ptr<DataChannelBenchmark> dataBenchmark;
+	std::unique_ptr<LatencyProbe> latencyProbe;
+	std::unique_ptr<FileTransfer> fileTransfer;
+	std::unique_ptr<StatsCollector> statsCollector;
+	std::unique_ptr<FrameTracer> frameTracer;
+	std::unique_ptr<StreamRecorder> streamRecorder;
+	JoinTimer* joinTimer{ nullptr };
+	// When the connect request of each transport was made, 0 once connected.
+	std::atomic<int64_t> sendConnectStartUs{ 0 };
+	std::atomic<int64_t> recvConnectStartUs{ 0 };
+	// Ids of the current transports, which Rejoin() replaces while their
+	// connection state changes are reported from the signaling thread.
+	std::mutex transportIdsMutex;
+	std::string sendTransportId;
+	std::string recvTransportId;
+	// Time taken by the connect requests made from the produce or consume
+	// being timed, left out of it.
+	int64_t connectRequestUs{ 0 };
+	TransportRecovery::Options recoveryOptions;
+	// Cleared once the server answers it has no restart-ice route. Recovery
+	// thread only.
+	bool iceRestartSupported{ true };
+	std::unique_ptr<TransportRecovery> recovery;
+	std::atomic<bool> sctpOpen{ false };
+	std::unique_ptr<ConsumerMonitor> consumerMonitor;
+	// Other peers in the room when joining, with their Producers.
+	nlohmann::json peers;
+	std::unique_ptr<ControlServer> controlServer;
+	// Feeds the video producer track, null when there is none.
+	webrtc::test::FrameGeneratorCapturer* videoCapturer{ nullptr };
+	// Held by the control requests and by Rejoin(), which replaces the producers.
+	std::mutex mediaMutex;
 
 	std::future<void> OnConnectSendTransport(const nlohmann::json& dtlsParameters);
 	std::future<void> OnConnectRecvTransport(const nlohmann::json& dtlsParameters);
 
+	// Creates the broadcaster in the room, its transports and producers.
+	bool Join();
+	// Closes everything created by Join() and deletes the broadcaster.
+	void Leave();
+	// Leaves and joins again with new transports, producers and data components.
+	bool Rejoin();
+	bool RestartIce(const std::string& transportId);
+	int64_t TakeConnectRequestUs();
 	void CreateSendTransport(bool enableAudio, bool useSimulcast);
 	void CreateRecvTransport();
-	void CreateDataConsumer();
+	void OnChatMessage(const rtc::CopyOnWriteBuffer& data, bool binary);
+	void CreateConsumers();
+	// |peerId| is kept in the Consumer appData, to pair its audio and video.
+	mediasoupclient::Consumer* CreateConsumer(
+	  const std::string& producerId, const std::string& peerId);
+	mediasoupclient::DataConsumer* CreateDataConsumer(
+	  mediasoupclient::DataProducer* dataProducer, const std::string& label);
+	// Returns the codec capability matching |videoCodec|, null if there is none.
+	nlohmann::json FindVideoCodec();
+	nlohmann::json HandleControl(const nlohmann::json& request);
+	nlohmann::json GetEncodings(mediasoupclient::Producer* producer);
+	void SetEncodings(mediasoupclient::Producer* producer, const nlohmann::json& encodings);
 };
 
 #endif // STOKER_HPP
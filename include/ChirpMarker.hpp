@@ -0,0 +1,99 @@
+#ifndef CHIRP_MARKER_HPP
+#define CHIRP_MARKER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Audio counterpart of FrameStamp: markers injected into the captured audio,
+ * to measure the mouth-to-ear latency on the receiver.
+ *
+ * A marker starts every kPeriodMs of wall clock, aligned to it, so that its
+ * start time is known from its sequence number (the period index modulo 256).
+ * It is a 20 ms sync chirp followed by 12 slots of 5 ms carrying the 8 bit
+ * sequence and a CRC-4, an up chirp for a 1 and a down chirp for a 0. Chirps
+ * survive lossy codecs far better than tones, and their cross-correlation
+ * peak is sharp enough to time them to the sample.
+ */
+class ChirpMarker
+{
+public:
+	static constexpr uint64_t kPeriodMs = 1000;
+
+	// The start time of the marker with |sequence| received at |nowMs|, minus
+	// that. Negative if the clocks are off.
+	static int64_t LatencyMs(uint8_t sequence, double nowMs);
+
+	// Writes the markers into the (otherwise silent) captured audio.
+	class Generator
+	{
+	public:
+		explicit Generator(int sampleRate);
+
+		// |samples| are mono and start at |nowMs|, the wall clock (see
+		// FrameStamp::NowMs()).
+		void Fill(int16_t* samples, size_t count, uint64_t nowMs);
+
+	private:
+		int sampleRate;
+		std::vector<int16_t> sync;
+		std::vector<int16_t> up;
+		std::vector<int16_t> down;
+		// The one being written.
+		std::vector<int16_t> marker;
+		// Start time of the next marker, 0 until the first frame.
+		uint64_t nextMarkerMs{ 0 };
+		// Samples of the current marker written so far, -1 if none is being written.
+		int64_t position{ -1 };
+	};
+
+	// Finds the markers in the received audio by cross-correlation.
+	class Detector
+	{
+	public:
+		struct Detection
+		{
+			uint8_t sequence{ 0 };
+			// Wall clock at which the marker started playing out.
+			double arrivalMs{ 0 };
+		};
+
+	public:
+		explicit Detector(int sampleRate);
+
+		int GetSampleRate() const
+		{
+			return this->sampleRate;
+		}
+
+		// |samples| are interleaved, only the first of the |channels| is read.
+		// They are the ones received at |nowMs|.
+		std::vector<Detection> Process(
+		  const int16_t* samples, size_t count, size_t channels, uint64_t nowMs);
+
+	private:
+		// Normalized cross-correlation of |pattern| with the buffer at |offset|.
+		double Correlate(const std::vector<float>& pattern, size_t offset) const;
+		bool Decode(size_t offset, uint8_t& sequence) const;
+
+	private:
+		int sampleRate;
+		std::vector<float> sync;
+		std::vector<float> up;
+		std::vector<float> down;
+		size_t markerSize{ 0 };
+		// Received samples, and the running sum of their squares (one more
+		// element) to normalize the correlations in constant time.
+		std::vector<float> buffer;
+		std::vector<double> energy;
+		// Absolute index of the first buffered sample.
+		uint64_t bufferStart{ 0 };
+		// Absolute index of the first sample not searched yet.
+		uint64_t searchStart{ 0 };
+		// Absolute index and wall clock of the latest samples.
+		uint64_t lastStart{ 0 };
+		uint64_t lastMs{ 0 };
+	};
+};
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef CONSUMER_MONITOR_HPP
+#define CONSUMER_MONITOR_HPP
+
+#include "ChirpMarker.hpp"
+#include "EncodedFrameCounter.hpp"
+#include "FrameCounter.hpp"
+#include "Histogram.hpp"
+#include "MpscRing.hpp"
+#include "QualityScorer.hpp"
+#include "mediasoupclient.hpp"
+#include "api/media_stream_interface.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame.h"
+#include "api/video/video_sink_interface.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* Subscriber side load: the video Consumers are decoded into sinks that only
+ * count frames, so that many viewers can be emulated at a fraction of the
+ * cost of rendering them. Audio is decoded by the fake audio device playout.
+ *
+ * Without decoding, the encoded frames are counted by an EncodedFrameCounter
+ * instead, the decoders being null ones (see NullVideoDecoderFactory), so
+ * that a viewer costs little more than the network and SRTP.
+ *
+ * Every report interval the frame rate, freezes, resolution and decode time
+ * (or key frames and bitrate without decoding) of each Consumer are printed.
+ * Decoded frames carrying a FrameStamp also give the glass-to-glass latency
+ * and, optionally, their PSNR and SSIM against the regenerated source frame
+ * (see QualityScorer), per received resolution, scored on a thread of each
+ * Sink so as not to delay the decoding. Browsers stamp nothing: with
+ * the stock mediasoup-demo only our own Producers, consumed in loopback,
+ * carry stamps.
+ *
+ * Optionally the decoded audio is searched for ChirpMarkers, giving the
+ * mouth-to-ear latency, and the A/V offset of the peers whose video latency
+ * is known too: the Consumers are paired by the "peerId" of their appData.
+ */
+class ConsumerMonitor
+{
+public:
+	struct Options
+	{
+		// Producers of the other peers in the room to consume, 0 for all of them.
+		uint32_t maxProducers{ 0 };
+		// Consume our own audio and video Producers too, whose frames and audio
+		// we stamp, in addition to those of the other peers.
+		bool loopback{ false };
+		// Consumers created per Producer, each one being a viewer.
+		uint32_t copies{ 1 };
+		uint32_t reportIntervalSeconds{ 10 };
+		// If false the peerconnection factory must have been given a
+		// NullVideoDecoderFactory.
+		bool decode{ true };
+		// Score the stamped frames against their reference.
+		bool quality{ false };
+		// Look for ChirpMarkers in the audio, sent by peers capturing them (see
+		// enableAudioChirps()).
+		bool chirps{ false };
+	};
+
+public:
+	explicit ConsumerMonitor(const Options& options);
+	~ConsumerMonitor();
+
+	const Options& GetOptions() const
+	{
+		return this->options;
+	}
+
+	void Start(const std::vector<mediasoupclient::Consumer*>& consumers);
+	// Detaches the sinks, to be called before the Consumers are closed.
+	void Stop();
+
+private:
+	class Sink : public rtc::VideoSinkInterface<webrtc::VideoFrame>
+	{
+	public:
+		// Frames waiting to be scored, newer ones are left unscored.
+		static constexpr size_t kScoreQueueSize = 8;
+
+	public:
+		explicit Sink(bool scoreQuality);
+		~Sink() override;
+
+		/* Virtual methods inherited from rtc::VideoSinkInterface. */
+	public:
+		void OnFrame(const webrtc::VideoFrame& frame) override;
+
+	public:
+		struct Quality
+		{
+			uint64_t frames{ 0 };
+			double psnrSum{ 0 };
+			double psnrMin{ 0 };
+			double ssimSum{ 0 };
+			double ssimMin{ 0 };
+		};
+
+		// Of the frames carrying a FrameStamp, since the previous call.
+		struct StampStats
+		{
+			uint64_t frames{ 0 };
+			// Gaps in the stamped frame numbers.
+			uint64_t skipped{ 0 };
+			// Not scored as the scoring thread was behind.
+			uint64_t unscored{ 0 };
+			Histogram latencyMs;
+			Histogram frameGapMs;
+			// Keyed by width and height, i.e. by simulcast or spatial layer.
+			std::map<std::pair<int, int>, Quality> quality;
+		};
+
+		StampStats TakeStampStats();
+
+	public:
+		FrameCounter counter;
+
+	private:
+		struct ScoreJob
+		{
+			rtc::scoped_refptr<webrtc::I420BufferInterface> buffer;
+			FrameStamp::Stamp stamp;
+		};
+
+		void RunScorer();
+
+	private:
+		// Used from the scoring thread only, null if not scoring.
+		std::unique_ptr<QualityScorer> scorer;
+		std::unique_ptr<MpscRing<ScoreJob>> scoreQueue;
+		std::thread scoreThread;
+		std::condition_variable scoreCv;
+
+		std::mutex mutex;
+		// Protected by |mutex|.
+		bool stopping{ false };
+		StampStats stampStats;
+		bool stampSeen{ false };
+		uint32_t lastFrameNumber{ 0 };
+		std::chrono::steady_clock::time_point lastStampedFrame;
+	};
+
+	class AudioSink : public webrtc::AudioTrackSinkInterface
+	{
+		/* Virtual methods inherited from webrtc::AudioTrackSinkInterface. */
+	public:
+		void OnData(
+		  const void* audioData,
+		  int bitsPerSample,
+		  int sampleRate,
+		  size_t numberOfChannels,
+		  size_t numberOfFrames) override;
+
+	public:
+		// Since the previous call.
+		struct ChirpStats
+		{
+			uint64_t markers{ 0 };
+			// Gaps in the marker sequence numbers.
+			uint64_t missed{ 0 };
+			Histogram latencyMs;
+		};
+
+		ChirpStats TakeChirpStats();
+
+	private:
+		// Used from the audio playout thread only, created on the first data.
+		std::unique_ptr<ChirpMarker::Detector> detector;
+
+		std::mutex mutex;
+		// Protected by |mutex|.
+		ChirpStats chirpStats;
+		bool markerSeen{ false };
+		uint8_t lastSequence{ 0 };
+	};
+
+	struct Entry
+	{
+		mediasoupclient::Consumer* consumer{ nullptr };
+		std::string peerId;
+		// Audio only, if looking for ChirpMarkers.
+		std::unique_ptr<AudioSink> audioSink;
+		// Video only, one or the other depending on whether it is decoded.
+		std::unique_ptr<Sink> sink;
+		rtc::scoped_refptr<EncodedFrameCounter> encodedFrameCounter;
+		FrameCounter::Stats previousVideo;
+		uint64_t previousFramesDecoded{ 0 };
+		double previousTotalDecodeTime{ 0 };
+		uint64_t previousPacketsReceived{ 0 };
+	};
+
+	void Run();
+	void Report(std::chrono::steady_clock::duration elapsed);
+
+private:
+	Options options;
+	std::vector<Entry> entries;
+	std::thread thread;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stopping{ false };
+};
+
+#endif
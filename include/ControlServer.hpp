@@ -0,0 +1,55 @@
+#ifndef CONTROL_SERVER_HPP
+#define CONTROL_SERVER_HPP
+
+#include "json.hpp"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+/* Local control API over a UNIX domain socket.
+ *
+ * Requests and responses are JSON objects, one per line, so that any line
+ * oriented tool can drive it:
+ *
+ *   echo '{"method":"setFramerate","framerate":15}' | socat - UNIX-CONNECT:broadcaster.sock
+ *
+ * A single thread serves one connection at a time, a connection may carry any
+ * number of requests.
+ */
+class ControlServer
+{
+public:
+	struct Options
+	{
+		std::string path;
+		// Idle connections are closed after this time, so that they don't block others.
+		uint32_t idleTimeoutMs{ 30000 };
+	};
+
+	// Returns the response to |request|, exceptions are turned into errors.
+	using Handler = std::function<nlohmann::json(const nlohmann::json& request)>;
+
+	static constexpr size_t kMaxRequestSize = 64 * 1024;
+
+public:
+	ControlServer(const Options& options, Handler handler);
+	~ControlServer();
+
+	bool Start();
+	void Stop();
+
+private:
+	void Run();
+	void Serve(int fd);
+	nlohmann::json Handle(const std::string& line);
+
+private:
+	Options options;
+	Handler handler;
+	int listenFd{ -1 };
+	std::atomic<bool> stopping{ false };
+	std::thread thread;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef DATA_CHANNEL_BENCHMARK_HPP
+#define DATA_CHANNEL_BENCHMARK_HPP
+
+#include "Histogram.hpp"
+#include "mediasoupclient.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/* Sends binary messages through a DataProducer as fast as the SCTP stack
+ * accepts them.
+ *
+ * Sending pauses when the DataChannel buffered amount reaches the high-water
+ * mark and resumes once OnBufferedAmountChange() reports it has drained below
+ * the low-water mark. Messages looped back by the SFU are accounted through
+ * OnMessage(). Throughput and a buffered-amount histogram are reported every
+ * report interval.
+ */
+class DataChannelBenchmark
+{
+public:
+	struct Options
+	{
+		size_t messageSize{ 16 * 1024 };
+		uint64_t highWaterMark{ 1024 * 1024 };
+		uint64_t lowWaterMark{ 256 * 1024 };
+		uint32_t reportIntervalSeconds{ 5 };
+	};
+
+public:
+	explicit DataChannelBenchmark(const Options& options);
+	~DataChannelBenchmark();
+
+	const Options& GetOptions() const
+	{
+		return this->options;
+	}
+
+	// Messages are capped to |maxMessageSize|, the SCTP one of the transport.
+	void Start(mediasoupclient::DataProducer* dataProducer, size_t maxMessageSize);
+	void Stop();
+
+	/* To be called from the DataProducer/DataConsumer listeners. */
+	void OnOpen();
+	void OnBufferedAmountChange();
+	void OnMessage(const rtc::CopyOnWriteBuffer& data);
+
+private:
+	void Run();
+	void Report(std::chrono::steady_clock::time_point now);
+
+private:
+	Options options;
+	mediasoupclient::DataProducer* dataProducer{ nullptr };
+	std::thread thread;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool open{ false };
+	bool paused{ false };
+	bool stopping{ false };
+
+	// Protected by |mutex|.
+	Histogram bufferedAmount;
+	uint64_t sentMessages{ 0 };
+	uint64_t sentBytes{ 0 };
+	uint64_t receivedMessages{ 0 };
+	uint64_t receivedBytes{ 0 };
+	uint64_t pauses{ 0 };
+	uint64_t sendFailures{ 0 };
+	std::chrono::steady_clock::time_point lastReport;
+};
+
+#endif
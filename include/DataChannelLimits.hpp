@@ -0,0 +1,30 @@
+#ifndef DATA_CHANNEL_LIMITS_HPP
+#define DATA_CHANNEL_LIMITS_HPP
+
+#include "mediasoupclient.hpp"
+#include <cstdint>
+
+/* What can be sent through a DataProducer.
+ *
+ * DataProducer::Send() does not tell whether the message was queued, so
+ * senders check beforehand what would make it fail: the DataChannel not being
+ * open, or the buffered amount going over kMaxBufferedAmount, in which case
+ * libwebrtc closes the DataChannel rather than queue the message.
+ *
+ * DataProducer calls are proxied to the signaling thread, which also delivers
+ * the DataProducer events: don't make them while holding a lock that the
+ * listener takes.
+ */
+class DataChannelLimits
+{
+public:
+	static constexpr uint64_t kMaxBufferedAmount = 16 * 1024 * 1024;
+
+public:
+	static bool IsOpen(mediasoupclient::DataProducer* dataProducer)
+	{
+		return dataProducer->GetReadyState() == webrtc::DataChannelInterface::kOpen;
+	}
+};
+
+#endif
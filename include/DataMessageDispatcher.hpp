@@ -0,0 +1,75 @@
+#ifndef DATA_MESSAGE_DISPATCHER_HPP
+#define DATA_MESSAGE_DISPATCHER_HPP
+
+#include "mediasoupclient.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Routes DataConsumer messages to handlers registered per DataConsumer label.
+ *
+ * Handlers get a reference to the received rtc::CopyOnWriteBuffer, so the
+ * payload is never copied (a handler that needs to keep it can copy the
+ * buffer, which just takes a reference). Messages and bytes are counted per
+ * label with relaxed atomics.
+ *
+ * Handlers must be registered before any DataConsumer is added. Each
+ * DataConsumer is resolved to its handler once, when added, and created with
+ * a listener bound to it, so dispatching a message takes no lock or lookup.
+ */
+class DataMessageDispatcher
+{
+public:
+	using Handler = std::function<void(const rtc::CopyOnWriteBuffer& data, bool binary)>;
+
+	struct Counters
+	{
+		std::string label;
+		uint64_t messages;
+		uint64_t bytes;
+	};
+
+public:
+	void RegisterHandler(const std::string& label, Handler handler);
+	// Returns the listener to create the DataConsumer of |label| with, which
+	// lasts as long as the dispatcher.
+	mediasoupclient::DataConsumer::Listener* AddDataConsumer(const std::string& label);
+
+	// Includes messages for labels with no handler, under an empty label.
+	std::vector<Counters> GetCounters() const;
+
+private:
+	struct Entry : public mediasoupclient::DataConsumer::Listener
+	{
+		Handler handler;
+		std::atomic<uint64_t> messages{ 0 };
+		std::atomic<uint64_t> bytes{ 0 };
+
+		void OnMessage(
+		  mediasoupclient::DataConsumer* dataConsumer, const webrtc::DataBuffer& buffer) override;
+		void OnConnecting(mediasoupclient::DataConsumer* dataConsumer) override
+		{
+		}
+		void OnClosing(mediasoupclient::DataConsumer* dataConsumer) override
+		{
+		}
+		void OnClose(mediasoupclient::DataConsumer* dataConsumer) override
+		{
+		}
+		void OnOpen(mediasoupclient::DataConsumer* dataConsumer) override
+		{
+		}
+		void OnTransportClose(mediasoupclient::DataConsumer* dataConsumer) override
+		{
+		}
+	};
+
+	std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+	Entry unhandled;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef DATA_SENDER_HPP
+#define DATA_SENDER_HPP
+
+#include "MpscQueue.hpp"
+#include "mediasoupclient.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/* Sends messages pushed from any thread through a DataProducer from a single
+ * managed thread.
+ *
+ * Application threads push into a lock-free MPSC queue. If coalescing is
+ * enabled, queued messages are framed (4 byte little-endian length followed by
+ * the payload) and packed into binary batches of up to |maxBatchSize| bytes,
+ * flushed every |flushIntervalMs| or as soon as a full batch is pending.
+ * Receivers split them with Unbatch(). Stop() sends whatever is still queued
+ * and joins the thread.
+ */
+class DataSender
+{
+public:
+	struct Options
+	{
+		bool coalesce{ false };
+		// Should match the SCTP max message size of the transport.
+		size_t maxBatchSize{ 256 * 1024 };
+		uint32_t flushIntervalMs{ 20 };
+		// Push() fails once this many bytes are waiting to be sent.
+		size_t maxQueuedBytes{ 4 * 1024 * 1024 };
+	};
+
+	static constexpr size_t kFrameHeaderSize = 4;
+
+public:
+	explicit DataSender(const Options& options);
+	~DataSender();
+
+	void Start(mediasoupclient::DataProducer* dataProducer);
+	void Stop();
+
+	// Thread safe. Returns false if the message was dropped.
+	bool Push(rtc::CopyOnWriteBuffer data, bool binary);
+
+	// Calls |onMessage| for each message framed in |batch|, without copying.
+	// Returns false if the batch is malformed.
+	static bool Unbatch(
+	  const rtc::CopyOnWriteBuffer& batch,
+	  const std::function<void(const uint8_t* data, size_t size)>& onMessage);
+
+private:
+	struct Message
+	{
+		rtc::CopyOnWriteBuffer data;
+		bool binary{ false };
+	};
+
+	void Run();
+	void Flush();
+	void Send(const rtc::CopyOnWriteBuffer& data, bool binary);
+
+private:
+	Options options;
+	mediasoupclient::DataProducer* dataProducer{ nullptr };
+	std::thread thread;
+
+	MpscQueue<Message> queue;
+	std::atomic<size_t> queuedBytes{ 0 };
+	std::atomic<bool> stopping{ false };
+
+	// Only used to wake up the sender thread early.
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	// Sender thread only.
+	rtc::CopyOnWriteBuffer batch;
+	uint64_t sentMessages{ 0 };
+	uint64_t sentBatches{ 0 };
+	uint64_t failedSends{ 0 };
+	std::atomic<uint64_t> droppedMessages{ 0 };
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef ENCODED_FRAME_COUNTER_HPP
+#define ENCODED_FRAME_COUNTER_HPP
+
+#include "FrameCounter.hpp"
+#include "api/frame_transformer_interface.h"
+#include "api/scoped_refptr.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+/* Frame transformer counting the encoded frames of an RtpReceiver between
+ * the depacketizer and the decoder. Frames are passed on untouched, dropping
+ * them would make the receiver request key frames over and over: pair it
+ * with NullVideoDecoderFactory to not decode them.
+ *
+ *   receiver->SetDepacketizerToDecoderFrameTransformer(
+ *     new rtc::RefCountedObject<EncodedFrameCounter>());
+ */
+class EncodedFrameCounter : public webrtc::FrameTransformerInterface
+{
+public:
+	// See FrameCounter::GetStats().
+	FrameCounter::Stats GetStats()
+	{
+		return this->counter.GetStats();
+	}
+
+	/* Virtual methods inherited from webrtc::FrameTransformerInterface. */
+public:
+	void Transform(std::unique_ptr<webrtc::TransformableFrameInterface> frame) override;
+	void RegisterTransformedFrameCallback(
+	  rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback) override;
+	void RegisterTransformedFrameSinkCallback(
+	  rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback, uint32_t ssrc) override;
+	void UnregisterTransformedFrameCallback() override;
+	void UnregisterTransformedFrameSinkCallback(uint32_t ssrc) override;
+
+private:
+	FrameCounter counter;
+
+	std::mutex mutex;
+	// Protected by |mutex|.
+	rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback;
+	std::map<uint32_t, rtc::scoped_refptr<webrtc::TransformedFrameCallback>> sinkCallbacks;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef FILE_TRANSFER_HPP
+#define FILE_TRANSFER_HPP
+
+#include "MpscQueue.hpp"
+#include "mediasoupclient.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* Bulk file transfer over a DataProducer.
+ *
+ * The sending side maps the file in memory and sends it in chunks no larger
+ * than the SCTP max message size, keeping at most |windowSize| bytes buffered
+ * in the DataChannel: the window slides as OnBufferedAmountChange() reports
+ * the buffered amount draining.
+ *
+ * The receiving side reassembles transfers into |outputDir| from a dedicated
+ * writer thread, so disk I/O never runs on libwebrtc threads, and verifies
+ * the CRC-32 of the whole file sent in the final message. Transfers are
+ * written to a ".part" file renamed once verified, with a ".received" suffix
+ * if they would overwrite the file being sent.
+ *
+ * Every message starts with a 1 byte type and the 4 byte transfer id:
+ *   kBegin: file size (8), chunk size (4), name length (2), name.
+ *   kChunk: offset (8), payload.
+ *   kEnd:   CRC-32 (4).
+ * Integers are little-endian. The DataChannel must be ordered and reliable.
+ */
+class FileTransfer
+{
+public:
+	struct Options
+	{
+		// File to send once the DataProducer is open. Nothing is sent if empty.
+		std::string sendPath;
+		std::string outputDir{ "." };
+		size_t chunkSize{ 64 * 1024 };
+		uint64_t windowSize{ 4 * 1024 * 1024 };
+	};
+
+	enum MessageType : uint8_t
+	{
+		kBegin = 1,
+		kChunk = 2,
+		kEnd   = 3
+	};
+
+	static uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size);
+
+public:
+	explicit FileTransfer(const Options& options);
+	~FileTransfer();
+
+	const Options& GetOptions() const
+	{
+		return this->options;
+	}
+
+	void Start(mediasoupclient::DataProducer* dataProducer, size_t maxMessageSize);
+	void Stop();
+
+	/* To be called from the DataProducer/DataConsumer listeners. */
+	void OnOpen();
+	void OnBufferedAmountChange();
+	void OnMessage(const rtc::CopyOnWriteBuffer& data);
+
+private:
+	struct Incoming
+	{
+		uint32_t id{ 0 };
+		int fd{ -1 };
+		std::string path;
+		// Written until complete, then renamed to |path|.
+		std::string partPath;
+		uint64_t size{ 0 };
+		uint64_t received{ 0 };
+		uint32_t crc{ 0 };
+		std::chrono::steady_clock::time_point startedAt;
+	};
+
+	void RunSender();
+	bool SendFile();
+	bool SendMessage(const rtc::CopyOnWriteBuffer& message);
+	bool WaitForWindow(size_t size);
+	void RunReceiver();
+	void Receive(const rtc::CopyOnWriteBuffer& data);
+	void CloseIncoming();
+
+private:
+	Options options;
+	mediasoupclient::DataProducer* dataProducer{ nullptr };
+	size_t chunkSize{ 0 };
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool open{ false };
+	bool stopping{ false };
+	// Last known DataChannel buffered amount, plus what was sent since.
+	// Protected by |mutex|.
+	uint64_t bufferedAmount{ 0 };
+	std::thread senderThread;
+
+	MpscQueue<rtc::CopyOnWriteBuffer> incomingQueue;
+	std::condition_variable receiverCv;
+	std::thread receiverThread;
+	// Receiver thread only.
+	Incoming incoming;
+};
+
+#endif
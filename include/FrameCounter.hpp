@@ -0,0 +1,44 @@
+#ifndef FRAME_COUNTER_HPP
+#define FRAME_COUNTER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/* Thread safe counters of the frames received by a Consumer.
+ *
+ * A freeze is an inter-frame gap longer than max(3 * average gap, average
+ * gap + 150ms), as in the WebRTC stats spec. The average is that of the gaps
+ * since the previous GetStats() call, starting from the previous average.
+ */
+class FrameCounter
+{
+public:
+	struct Stats
+	{
+		uint64_t frames{ 0 };
+		uint64_t keyFrames{ 0 };
+		uint64_t bytes{ 0 };
+		uint64_t freezes{ 0 };
+		uint64_t totalFreezeMs{ 0 };
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+	};
+
+public:
+	// |width| and |height| are 0 if unknown, they are then left untouched.
+	void OnFrame(size_t bytes, bool keyFrame, uint32_t width = 0, uint32_t height = 0);
+	// To be called once per reporting interval, as it starts a new one.
+	Stats GetStats();
+
+private:
+	std::mutex mutex;
+	Stats stats;
+	std::chrono::steady_clock::time_point lastFrame;
+	// Inter-frame gaps of the current reporting interval.
+	std::chrono::steady_clock::duration totalGap{ 0 };
+	uint64_t gaps{ 0 };
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef FRAME_STAMP_HPP
+#define FRAME_STAMP_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/* Capture timestamp and frame number stamped into the pixels of a video
+ * frame, to measure glass-to-glass latency on the receiver.
+ *
+ * The 80 bits (sync byte, 40 bit wall clock milliseconds, 24 bit frame number
+ * and CRC-8) are drawn as black and white blocks in a 16x5 grid on the top
+ * left corner. Blocks are width / 32 pixels wide, so the stamp scales with
+ * the frame, and large enough to survive lossy encoding: they are read by
+ * averaging their center.
+ */
+class FrameStamp
+{
+public:
+	struct Stamp
+	{
+		uint64_t timestampMs{ 0 };
+		uint32_t frameNumber{ 0 };
+	};
+
+	static constexpr int kColumns = 16;
+	static constexpr int kRows    = 5;
+	// Blocks per frame width.
+	static constexpr int kGrid = 32;
+
+	// Wall clock, so that a sender and a receiver with synchronized clocks can
+	// compare their timestamps.
+	static uint64_t NowMs();
+	// Time elapsed since |stamp| was written, negative if the clocks are off.
+	static int64_t LatencyMs(const Stamp& stamp, uint64_t nowMs);
+
+	// Returns false if the frame is too small to hold the stamp.
+	static bool Write(
+	  const Stamp& stamp,
+	  uint8_t* dataY,
+	  int strideY,
+	  uint8_t* dataU,
+	  int strideU,
+	  uint8_t* dataV,
+	  int strideV,
+	  int width,
+	  int height);
+	// Returns false if no valid stamp is found.
+	static bool Read(const uint8_t* dataY, int strideY, int width, int height, Stamp& stamp);
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef FRAME_TRACER_HPP
+#define FRAME_TRACER_HPP
+
+#include "Histogram.hpp"
+#include "test/test_video_capturer.h"
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+/* Traces every video frame from capture to packetization.
+ *
+ * Trace points are recorded, from whatever thread hits them, into a lock-free
+ * ring owned by that thread, so recording never blocks the media pipeline.
+ * Frames are identified by their capture time in milliseconds, which the
+ * capturer stamps and the encoder carries along as the render/capture time.
+ *
+ * A background thread collects the rings every export interval, prints the
+ * latency of each stage (capture, adapt, encoder queue, encode, packetize and
+ * total) and, if a trace file is given, appends the frames to it in Chrome
+ * trace JSON format (chrome://tracing or https://ui.perfetto.dev).
+ */
+class FrameTracer
+{
+public:
+	struct Options
+	{
+		uint32_t exportIntervalSeconds{ 5 };
+		std::string traceFile;
+	};
+
+	enum Point : uint8_t
+	{
+		kCaptureStart = 0,
+		kCaptureEnd,
+		kAdaptStart,
+		kAdaptEnd,
+		kDropped,
+		kEncodeStart,
+		// Per simulcast layer.
+		kEncodeEnd,
+		kPacketized,
+		kPointCount
+	};
+
+	// Events kept per thread between two collections.
+	static constexpr size_t kRingSize  = 8192;
+	static constexpr size_t kMaxLayers = 4;
+
+	// Thread safe and lock-free. Does nothing unless a FrameTracer is running.
+	static void Record(Point point, int64_t captureTimeMs, uint8_t layer = 0);
+
+	// Forwards the trace points of a TestVideoCapturer to Record().
+	static webrtc::test::TestVideoCapturer::FrameTraceObserver* GetCapturerObserver();
+
+public:
+	explicit FrameTracer(const Options& options);
+	~FrameTracer();
+
+	// Only one FrameTracer may be running at a time.
+	void Start();
+	void Stop();
+
+private:
+	struct Frame
+	{
+		int64_t times[kPointCount]{};
+		uint32_t threads[kPointCount]{};
+		int64_t encodeEnd[kMaxLayers]{};
+		int64_t packetized[kMaxLayers]{};
+	};
+
+	void Run();
+	void Collect();
+	void Finalize(int64_t captureTimeMs, const Frame& frame);
+	void WriteSpan(
+	  const char* name,
+	  int64_t captureTimeMs,
+	  uint32_t thread,
+	  int64_t start,
+	  int64_t end,
+	  int layer);
+	void Export();
+
+private:
+	Options options;
+	std::thread thread;
+	std::ofstream traceStream;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stopping{ false };
+
+	// Exporter thread only.
+	std::map<int64_t, Frame> pending;
+	std::set<uint32_t> namedThreads;
+	uint64_t frames{ 0 };
+	uint64_t dropped{ 0 };
+	uint64_t lostEvents{ 0 };
+	Histogram capture;
+	Histogram adapt;
+	Histogram queue;
+	Histogram encode;
+	Histogram packetize;
+	Histogram total;
+};
+
+#endif
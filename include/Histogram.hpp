@@ -0,0 +1,63 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/* Log-linear histogram of unsigned values.
+ *
+ * Values are grouped into power-of-two ranges, each one split into
+ * kSubBuckets linear buckets, so that percentiles are reported with a
+ * relative error below 100 / kSubBuckets %. Memory usage is fixed and
+ * recording never allocates.
+ *
+ * Not thread safe, callers must serialize access.
+ */
+class Histogram
+{
+public:
+	static constexpr size_t kSubBucketBits = 4;
+	static constexpr size_t kSubBuckets    = 1u << kSubBucketBits;
+	static constexpr size_t kBuckets       = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+public:
+	void Record(uint64_t value);
+	void Merge(const Histogram& other);
+	void Reset();
+
+	uint64_t Count() const
+	{
+		return this->count;
+	}
+	uint64_t Min() const
+	{
+		return this->count ? this->min : 0;
+	}
+	uint64_t Max() const
+	{
+		return this->max;
+	}
+	double Mean() const
+	{
+		return this->count ? static_cast<double>(this->sum) / this->count : 0;
+	}
+	// |percentile| in the [0, 100] range.
+	uint64_t Percentile(double percentile) const;
+
+	// "count:N min:X p50:X p90:X p99:X p999:X max:X" with values divided by |divisor|.
+	std::string ToString(double divisor = 1) const;
+
+private:
+	static size_t BucketIndex(uint64_t value);
+	static uint64_t BucketUpperBound(size_t index);
+
+private:
+	std::array<uint64_t, kBuckets> buckets{};
+	uint64_t count{ 0 };
+	uint64_t sum{ 0 };
+	uint64_t min{ UINT64_MAX };
+	uint64_t max{ 0 };
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef HTTP_SERVER_HPP
+#define HTTP_SERVER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+/* Minimal blocking HTTP/1.1 server for local endpoints.
+ *
+ * Connections are accepted and served one at a time by a single thread and
+ * closed after each response, which is plenty for scrapers and local tooling.
+ * Request bodies are only read if a Content-Length is given.
+ */
+class HttpServer
+{
+public:
+	struct Request
+	{
+		std::string method;
+		// Without the query string.
+		std::string path;
+		std::string query;
+		std::string body;
+	};
+
+	struct Response
+	{
+		int status{ 200 };
+		std::string contentType{ "text/plain" };
+		std::string body;
+	};
+
+	using Handler = std::function<Response(const Request& request)>;
+
+	static constexpr size_t kMaxHeaderSize = 16 * 1024;
+	static constexpr size_t kMaxBodySize   = 1024 * 1024;
+
+public:
+	explicit HttpServer(Handler handler);
+	~HttpServer();
+
+	// Port 0 binds an ephemeral port, see GetPort().
+	bool Start(const std::string& host, uint16_t port);
+	void Stop();
+
+	uint16_t GetPort() const
+	{
+		return this->port;
+	}
+
+private:
+	void Run();
+	void Serve(int fd);
+
+private:
+	Handler handler;
+	int listenFd{ -1 };
+	uint16_t port{ 0 };
+	std::atomic<bool> stopping{ false };
+	std::thread thread;
+};
+
+#endif
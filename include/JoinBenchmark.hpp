@@ -0,0 +1,39 @@
+#ifndef JOIN_BENCHMARK_HPP
+#define JOIN_BENCHMARK_HPP
+
+#include "JoinTimer.hpp"
+#include <cstdint>
+#include <string>
+
+/* Joins the room repeatedly, each time with a new Broadcaster, and prints the
+ * percentiles of every signaling phase (see JoinTimer).
+ *
+ * Meant to be run against the mock server with an injected RTT, as a
+ * regression gate: Run() fails if any join fails or if the p95 join time
+ * exceeds the configured maximum.
+ */
+class JoinBenchmark
+{
+public:
+	struct Options
+	{
+		uint32_t runs{ 20 };
+		// Time to wait for the first RTP packet and SCTP message after each join,
+		// 0 not to wait. They never come with the mock server, as ICE never
+		// completes.
+		uint32_t mediaTimeoutMs{ 0 };
+		// Maximum p95 join time, 0 for no limit.
+		uint32_t maxJoinP95Ms{ 0 };
+	};
+
+public:
+	explicit JoinBenchmark(const Options& options);
+
+	bool Run(const std::string& baseUrl, bool enableAudio, bool useSimulcast, bool verifySsl);
+
+private:
+	Options options;
+	JoinTimer timer;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef JOIN_TIMER_HPP
+#define JOIN_TIMER_HPP
+
+#include "Histogram.hpp"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/* Timings of each signaling phase of joining a room, aggregated over runs.
+ *
+ * Phases are recorded as durations, except the join itself and the first RTP
+ * and SCTP messages, which are recorded as the time since the run began.
+ * Phases that happen several times per run (e.g. one per DataProducer) add a
+ * sample each. Thread safe.
+ *
+ * A transport connects from within the first produce or consume on it, and
+ * until it gets "connected" (ICE and DTLS done) in the background: the connect
+ * phases are recorded then, never with the mock server, and the time the
+ * connect request took is excluded from the produce or consume that made it.
+ */
+class JoinTimer
+{
+public:
+	enum Phase : uint8_t
+	{
+		kRoomGet = 0,
+		kBroadcasterCreate,
+		kSendTransportCreate,
+		kSendTransportConnect,
+		kAudioProduce,
+		kVideoProduce,
+		kDataProduce,
+		kRecvTransportCreate,
+		kRecvTransportConnect,
+		kDataConsume,
+		kJoin,
+		kFirstRtp,
+		kFirstSctp,
+		kPhaseCount
+	};
+
+	// Records the duration of |phase| on destruction. Does nothing if |timer| is null.
+	class Scope
+	{
+	public:
+		Scope(JoinTimer* timer, Phase phase);
+		~Scope();
+
+		// Leaves |durationUs| out of the phase, e.g. a nested one recorded apart.
+		void Exclude(int64_t durationUs);
+
+	private:
+		JoinTimer* timer;
+		Phase phase;
+		int64_t startUs;
+	};
+
+public:
+	static const char* GetPhaseName(Phase phase);
+
+	void BeginRun();
+	void Record(Phase phase, int64_t durationUs);
+	// Records the time elapsed since BeginRun().
+	void RecordSinceBegin(Phase phase);
+	// Counts a phase that was not reached in this run.
+	void RecordMissed(Phase phase);
+
+	// Microseconds.
+	uint64_t Percentile(Phase phase, double percentile);
+
+	// One line per phase with its count, p50, p90, p99 and max in milliseconds.
+	std::string ToTable();
+
+private:
+	std::mutex mutex;
+	int64_t runBeginUs{ 0 };
+	std::array<Histogram, kPhaseCount> histograms;
+	std::array<uint64_t, kPhaseCount> missed{};
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef LATENCY_PROBE_HPP
+#define LATENCY_PROBE_HPP
+
+#include "Histogram.hpp"
+#include "mediasoupclient.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* Measures the round trip through the SFU by sending timestamped,
+ * sequence-numbered binary probes through a DataProducer and matching them
+ * when they come back through the DataConsumer that consumes it.
+ *
+ * Every export interval RTT percentiles, loss and reordering are printed and,
+ * if an export file is given, appended to it as a JSON line.
+ */
+class LatencyProbe
+{
+public:
+	struct Options
+	{
+		uint32_t intervalMs{ 100 };
+		// Probes not received after this time are considered lost. Also used as
+		// the DataChannel max packet lifetime, as later probes are useless.
+		uint32_t timeoutMs{ 2000 };
+		uint32_t exportIntervalSeconds{ 10 };
+		std::string exportFile;
+	};
+
+	static constexpr uint32_t kMagic   = 0x50524f42; // "PROB".
+	static constexpr size_t kProbeSize = 4 + 8 + 8;  // Magic, sequence number, send time.
+
+public:
+	explicit LatencyProbe(const Options& options);
+	~LatencyProbe();
+
+	const Options& GetOptions() const
+	{
+		return this->options;
+	}
+
+	void Start(mediasoupclient::DataProducer* dataProducer);
+	void Stop();
+
+	// To be called from the DataConsumer listener.
+	void OnMessage(const rtc::CopyOnWriteBuffer& data);
+
+private:
+	void Run();
+	void Export(std::chrono::steady_clock::time_point now);
+
+private:
+	Options options;
+	mediasoupclient::DataProducer* dataProducer{ nullptr };
+	std::thread thread;
+	std::ofstream exportStream;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stopping{ false };
+
+	// Protected by |mutex|.
+	uint64_t nextSeq{ 0 };
+	// Sequence number => send time (us) of the probes not received yet.
+	std::map<uint64_t, int64_t> outstanding;
+	uint64_t highestReceivedSeq{ 0 };
+	bool receivedAny{ false };
+	Histogram rtt;
+	uint64_t sent{ 0 };
+	uint64_t received{ 0 };
+	uint64_t lost{ 0 };
+	uint64_t reordered{ 0 };
+	uint64_t late{ 0 };
+	std::chrono::steady_clock::time_point lastExport;
+};
+
+#endif
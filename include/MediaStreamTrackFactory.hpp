@@ -1,12 +1,54 @@
 #ifndef MSC_TEST_MEDIA_STREAM_TRACK_FACTORY_HPP
 #define MSC_TEST_MEDIA_STREAM_TRACK_FACTORY_HPP
 
+#include "BatchingSocketServer.hpp"
+#include "RtcEventLogWriter.hpp"
 #include "api/media_stream_interface.h"
+#include "api/peer_connection_interface.h"
+#include "api/video_codecs/video_decoder_factory.h"
+#include "api/video_codecs/video_encoder_factory.h"
+#include "test/frame_generator_capturer.h"
+#include <memory>
+
+// Factory of the tracks, to be used for the transports too.
+webrtc::PeerConnectionFactoryInterface* getPeerConnectionFactory();
+
+// Replaces the builtin video encoder factory.
+// To be called before the factory is created, i.e. before any track or transport.
+void setVideoEncoderFactory(std::unique_ptr<webrtc::VideoEncoderFactory> encoderFactory);
+
+// Replaces the builtin video decoder factory. Same constraints as above.
+void setVideoDecoderFactory(std::unique_ptr<webrtc::VideoDecoderFactory> decoderFactory);
+
+// Makes the fake audio device capture ChirpMarkers, and disables the audio
+// processing that would distort them. Same constraints as above.
+void enableAudioChirps();
+
+// Starts the RTC event log of every PeerConnection, written by |writer|, which
+// must outlive the factory. Same constraints as above.
+void enableRtcEventLog(RtcEventLogWriter* writer);
+
+// Batches the UDP system calls of the network thread, see BatchingSocketServer.
+// Same constraints as above.
+void enableUdpBatching(const BatchingSocketServer::Options& options);
+
+// Wraps the video encoders to record their FrameTracer points, see
+// TracingVideoEncoderFactory. Same constraints as above.
+void enableEncoderTracing();
+
+// Releases the factory and stops its threads. To be called once every track
+// and transport is gone.
+void releasePeerConnectionFactory();
 
 rtc::scoped_refptr<webrtc::AudioTrackInterface> createAudioTrack(const std::string& label);
 
 rtc::scoped_refptr<webrtc::VideoTrackInterface> createVideoTrack(const std::string& label);
 
-rtc::scoped_refptr<webrtc::VideoTrackInterface> createSquaresVideoTrack(const std::string& label);
+// If given, |capturer| is set to the capturer feeding the track, valid as long
+// as the track is. With |timestampOverlay| every frame carries a FrameStamp.
+rtc::scoped_refptr<webrtc::VideoTrackInterface> createSquaresVideoTrack(
+  const std::string& label,
+  webrtc::test::FrameGeneratorCapturer** capturer = nullptr,
+  bool timestampOverlay                           = false);
 
 #endif
@@ -0,0 +1,107 @@
+#ifndef MOCK_SERVER_HPP
+#define MOCK_SERVER_HPP
+
+#include "HttpServer.hpp"
+#include "json.hpp"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+
+/* In-process stand-in for the mediasoup-demo HTTP API, so that the signaling
+ * path can be exercised and benchmarked without network access:
+ *
+ *   GET    /rooms/:roomId
+ *   POST   /rooms/:roomId/broadcasters
+ *   DELETE /rooms/:roomId/broadcasters/:broadcasterId
+ *   POST   /rooms/:roomId/broadcasters/:broadcasterId/transports
+ *   POST   .../transports/:transportId/connect
+ *   POST   .../transports/:transportId/producers
+ *   POST   .../transports/:transportId/produce/data
+ *   POST   .../transports/:transportId/consume?producerId=:producerId
+ *   POST   .../transports/:transportId/consume/data
+ *   POST   .../transports/:transportId/restart-ice
+ *
+ * Requests are validated like the real server does and answered with well
+ * formed router capabilities and transport parameters. There is no media
+ * endpoint behind the transports: the signaling protocol never carries the
+ * client ICE credentials (mediasoup is ICE Lite and learns them from the STUN
+ * requests), so ICE never completes and no RTP or SCTP flows.
+ */
+class MockServer
+{
+public:
+	struct Options
+	{
+		std::string host{ "127.0.0.1" };
+		// 0 binds an ephemeral port.
+		uint16_t port{ 0 };
+		// Delay added to every request, to emulate the network round trip. Requests
+		// are served one at a time, so concurrent ones queue behind each other.
+		uint32_t rttMs{ 0 };
+	};
+
+public:
+	explicit MockServer(const Options& options);
+	~MockServer();
+
+	bool Start();
+	void Stop();
+
+	// "http://host:port", valid once started.
+	std::string GetUrl() const;
+
+private:
+	struct Producer
+	{
+		std::string kind;
+		nlohmann::json rtpParameters;
+	};
+
+	struct Transport
+	{
+		bool connected{ false };
+		uint16_t nextStreamId{ 0 };
+		std::map<std::string, Producer> producers;
+		std::set<std::string> consumers;
+		std::set<std::string> dataProducers;
+		std::set<std::string> dataConsumers;
+	};
+
+	struct Broadcaster
+	{
+		std::string displayName;
+		nlohmann::json device;
+		std::map<std::string, Transport> transports;
+	};
+
+	HttpServer::Response Handle(const HttpServer::Request& request);
+	HttpServer::Response CreateBroadcaster(const std::string& roomId, const nlohmann::json& body);
+	HttpServer::Response HandleTransport(
+	  Broadcaster& broadcaster,
+	  const std::string& transportId,
+	  const std::string& action,
+	  const nlohmann::json& body);
+	// Producers of any broadcaster in the room can be consumed.
+	HttpServer::Response Consume(
+	  std::map<std::string, Broadcaster>& broadcasters,
+	  Transport& transport,
+	  const std::string& producerId);
+	nlohmann::json CreateIceParameters();
+	nlohmann::json CreateTransport(Broadcaster& broadcaster);
+	std::string RandomString(size_t length, const char* alphabet);
+	std::string RandomId();
+
+private:
+	Options options;
+	HttpServer server;
+	std::mutex mutex;
+	std::mt19937_64 random;
+	uint16_t nextPort{ 40000 };
+	// Keyed by room id, then by broadcaster id.
+	std::map<std::string, std::map<std::string, Broadcaster>> rooms;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef MPSC_QUEUE_HPP
+#define MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <utility>
+
+/* Unbounded lock-free multi-producer single-consumer FIFO queue (Dmitry
+ * Vyukov's algorithm).
+ *
+ * Push() is wait-free and may be called from any thread. Pop() must only be
+ * called from a single consumer thread and may transiently return false while
+ * a concurrent Push() is half way, in which case the element shows up in a
+ * later Pop().
+ */
+template<typename T>
+class MpscQueue
+{
+public:
+	MpscQueue() : head(&stub), tail(&stub)
+	{
+	}
+
+	~MpscQueue()
+	{
+		T value;
+
+		while (this->Pop(value))
+		{
+		}
+
+		if (this->tail != &this->stub)
+			delete this->tail;
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	void Push(T value)
+	{
+		auto* node  = new Node();
+		node->value = std::move(value);
+
+		Node* prev = this->head.exchange(node, std::memory_order_acq_rel);
+
+		prev->next.store(node, std::memory_order_release);
+	}
+
+	bool Pop(T& value)
+	{
+		Node* tail = this->tail;
+		Node* next = tail->next.load(std::memory_order_acquire);
+
+		if (!next)
+			return false;
+
+		// |next| becomes the new dummy node.
+		value      = std::move(next->value);
+		this->tail = next;
+
+		if (tail != &this->stub)
+			delete tail;
+
+		return true;
+	}
+
+private:
+	struct Node
+	{
+		std::atomic<Node*> next{ nullptr };
+		T value;
+	};
+
+	// Producers side.
+	std::atomic<Node*> head;
+	// Consumer side.
+	Node* tail;
+	Node stub;
+};
+
+#endif
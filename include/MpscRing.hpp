@@ -0,0 +1,113 @@
+#ifndef MPSC_RING_HPP
+#define MPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/* Bounded lock-free multi-producer single-consumer ring (Dmitry Vyukov's
+ * bounded queue).
+ *
+ * Elements are written and read in place, so that producers never allocate
+ * nor copy them twice. TryPush() never blocks and fails if the ring is full.
+ * TryPop() must only be called from a single consumer thread.
+ */
+template<typename T>
+class MpscRing
+{
+public:
+	// |capacity| is rounded up to a power of two.
+	explicit MpscRing(size_t capacity)
+	{
+		size_t size = 2;
+
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+
+		this->mask  = size - 1;
+		this->cells = std::unique_ptr<Cell[]>(new Cell[size]);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			this->cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MpscRing(const MpscRing&) = delete;
+	MpscRing& operator=(const MpscRing&) = delete;
+
+	// Calls |fill(T&)| on a free element and publishes it.
+	template<typename F>
+	bool TryPush(F&& fill)
+	{
+		size_t pos = this->enqueuePos.load(std::memory_order_relaxed);
+		Cell* cell;
+
+		while (true)
+		{
+			cell            = &this->cells[pos & this->mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			auto diff       = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+			if (diff == 0)
+			{
+				if (this->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			// Full.
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = this->enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		fill(cell->value);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Calls |consume(T&)| on the oldest element and releases it.
+	template<typename F>
+	bool TryPop(F&& consume)
+	{
+		Cell* cell      = &this->cells[this->dequeuePos & this->mask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+
+		// Empty, or the oldest element is still being written.
+		if (sequence != this->dequeuePos + 1)
+			return false;
+
+		consume(cell->value);
+		cell->sequence.store(this->dequeuePos + this->mask + 1, std::memory_order_release);
+		++this->dequeuePos;
+
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence{ 0 };
+		T value;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	size_t mask{ 0 };
+	// Producers side, kept off the consumer cache line. Padding rather than
+	// alignas() since C++14 new ignores extended alignment.
+	char padding1[64];
+	std::atomic<size_t> enqueuePos{ 0 };
+	char padding2[64];
+	// Consumer side.
+	size_t dequeuePos{ 0 };
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef NULL_VIDEO_DECODER_FACTORY_HPP
+#define NULL_VIDEO_DECODER_FACTORY_HPP
+
+#include "api/video_codecs/sdp_video_format.h"
+#include "api/video_codecs/video_decoder.h"
+#include "api/video_codecs/video_decoder_factory.h"
+#include <memory>
+#include <vector>
+
+/* Creates decoders that accept every frame and never output any, so that
+ * received video costs no decoding. The formats of the wrapped factory are
+ * announced, to negotiate the same codecs as when decoding.
+ */
+class NullVideoDecoderFactory : public webrtc::VideoDecoderFactory
+{
+public:
+	explicit NullVideoDecoderFactory(std::unique_ptr<webrtc::VideoDecoderFactory> factory);
+
+	/* Virtual methods inherited from webrtc::VideoDecoderFactory. */
+public:
+	std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override;
+	std::unique_ptr<webrtc::VideoDecoder> CreateVideoDecoder(
+	  const webrtc::SdpVideoFormat& format) override;
+
+private:
+	std::unique_ptr<webrtc::VideoDecoderFactory> factory;
+};
+
+#endif
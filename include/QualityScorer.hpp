@@ -0,0 +1,61 @@
+#ifndef QUALITY_SCORER_HPP
+#define QUALITY_SCORER_HPP
+
+#include "FrameStamp.hpp"
+#include "api/scoped_refptr.h"
+#include "api/test/frame_generator_interface.h"
+#include "api/video/video_frame_buffer.h"
+#include <cstdint>
+#include <memory>
+
+/* Full reference quality of the received video.
+ *
+ * The squares video is deterministic: its generator is seeded, so the frame
+ * with a given FrameStamp frame number is regenerated by stepping a
+ * generator of the same configuration as the sender's. The reference is
+ * stamped like the sent frame was, scaled to the received resolution, and
+ * compared to it with the libyuv PSNR and SSIM SIMD kernels.
+ *
+ * Catching up costs a frame generation per frame sent in between, so frames
+ * more than kMaxCatchUpFrames ahead of the reference (e.g. of a sender started
+ * long before the consumer) are not scored, until the sender restarts.
+ *
+ * Scores are meaningless once the sender resolution is changed at runtime
+ * (see the control socket setResolution method), as the generator of the
+ * reference never is.
+ */
+class QualityScorer
+{
+public:
+	struct Score
+	{
+		// In dB, capped to 48 for identical frames.
+		double psnr{ 0 };
+		// In the [0, 1] range.
+		double ssim{ 0 };
+	};
+
+	// About 30 seconds of the squares video.
+	static constexpr uint32_t kMaxCatchUpFrames{ 900 };
+
+public:
+	QualityScorer();
+
+	// |stamp| is the one read from |frame|. Returns false if the reference can
+	// not be regenerated, or is too far behind.
+	bool Compute(
+	  const webrtc::I420BufferInterface& frame, const FrameStamp::Stamp& stamp, Score& score);
+
+private:
+	void ResetReference();
+
+private:
+	std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator;
+	// Number of the frame the generator produces next.
+	uint32_t nextFrameNumber{ 0 };
+	rtc::scoped_refptr<webrtc::VideoFrameBuffer> reference;
+	// Whether frames too far ahead were reported.
+	bool catchUpWarned{ false };
+};
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef RTC_EVENT_LOG_WRITER_HPP
+#define RTC_EVENT_LOG_WRITER_HPP
+
+#include "api/peer_connection_interface.h"
+#include "api/rtc_event_log_output.h"
+#include "api/scoped_refptr.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* Captures the RTC event log (bandwidth estimation, packets, ICE and audio
+ * network adaptation events) of every PeerConnection into local files, for
+ * the rtc_event_log_visualizer or any other parser of the format.
+ *
+ * The peerconnection factory is wrapped so that logging starts as soon as a
+ * PeerConnection is created. libwebrtc encodes the events on a task queue of
+ * its own, every outputPeriodMs, and hands them to an output that only queues
+ * them: a background thread writes them, rotating the files by size and age.
+ * Output beyond maxQueuedBytes is dropped and counted.
+ *
+ *   <directory>/rtc-event-log-<start time>-pc<index>-<part>.rtclog
+ *
+ * Only the first part of a PeerConnection carries the stream configurations,
+ * concatenate the parts to parse them as a whole. Rotation never removes it.
+ *
+ * The overhead is reported every reportIntervalSeconds: the CPU time of the
+ * libwebrtc encoding threads (sampled when they output) and of the writer
+ * thread, as a percentage of one core, along with the data rate.
+ */
+class RtcEventLogWriter
+{
+public:
+	struct Options
+	{
+		std::string directory{ "." };
+		// How often libwebrtc encodes and outputs the events.
+		uint32_t outputPeriodMs{ 5000 };
+		// A new file is started beyond either, 0 for no limit.
+		uint64_t maxFileSize{ 16 * 1024 * 1024 };
+		uint32_t maxFileSeconds{ 600 };
+		// Files kept per PeerConnection, at least 2: the first one and the newest
+		// ones, those in between are removed. 0 keeps all.
+		uint32_t maxFiles{ 0 };
+		uint64_t maxQueuedBytes{ 8 * 1024 * 1024 };
+		uint32_t reportIntervalSeconds{ 10 };
+	};
+
+public:
+	explicit RtcEventLogWriter(const Options& options);
+	~RtcEventLogWriter();
+
+	const Options& GetOptions() const
+	{
+		return this->options;
+	}
+
+	void Start();
+	// Writes what is queued and closes the files. Events output afterwards are
+	// dropped.
+	void Stop();
+
+	// Returns a factory creating the PeerConnections of |factory| with their
+	// event log started.
+	rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> WrapFactory(
+	  rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> factory);
+
+private:
+	struct Chunk
+	{
+		uint32_t peerConnection{ 0 };
+		std::string data;
+	};
+
+	// Shared with the outputs, owned by the event logs of the PeerConnections.
+	struct Queue
+	{
+		std::mutex mutex;
+		std::condition_variable cv;
+		// Protected by |mutex|.
+		bool accepting{ false };
+		bool stopping{ false };
+		std::deque<Chunk> chunks;
+		uint64_t queuedBytes{ 0 };
+		uint64_t dropped{ 0 };
+		uint32_t peerConnections{ 0 };
+		// CPU time of the encoding thread of each event log, in nanoseconds.
+		std::map<uint32_t, int64_t> encodingCpuNs;
+	};
+
+	class Output : public webrtc::RtcEventLogOutput
+	{
+	public:
+		Output(std::shared_ptr<Queue> queue, uint32_t peerConnection, uint64_t maxQueuedBytes);
+
+		/* Virtual methods inherited from webrtc::RtcEventLogOutput. */
+	public:
+		bool IsActive() const override;
+		bool Write(const std::string& output) override;
+
+	private:
+		std::shared_ptr<Queue> queue;
+		uint32_t peerConnection;
+		uint64_t maxQueuedBytes;
+	};
+
+	class Factory : public webrtc::PeerConnectionFactoryInterface
+	{
+	public:
+		Factory(
+		  rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> factory,
+		  std::shared_ptr<Queue> queue,
+		  const RtcEventLogWriter::Options& options);
+
+		/* Virtual methods inherited from webrtc::PeerConnectionFactoryInterface. */
+	public:
+		void SetOptions(const webrtc::PeerConnectionFactoryInterface::Options& options) override;
+		rtc::scoped_refptr<webrtc::PeerConnectionInterface> CreatePeerConnection(
+		  const webrtc::PeerConnectionInterface::RTCConfiguration& configuration,
+		  webrtc::PeerConnectionDependencies dependencies) override;
+		rtc::scoped_refptr<webrtc::PeerConnectionInterface> CreatePeerConnection(
+		  const webrtc::PeerConnectionInterface::RTCConfiguration& configuration,
+		  std::unique_ptr<cricket::PortAllocator> allocator,
+		  std::unique_ptr<rtc::RTCCertificateGeneratorInterface> certGenerator,
+		  webrtc::PeerConnectionObserver* observer) override;
+		webrtc::RtpCapabilities GetRtpSenderCapabilities(cricket::MediaType kind) const override;
+		webrtc::RtpCapabilities GetRtpReceiverCapabilities(cricket::MediaType kind) const override;
+		rtc::scoped_refptr<webrtc::MediaStreamInterface> CreateLocalMediaStream(
+		  const std::string& streamId) override;
+		rtc::scoped_refptr<webrtc::AudioSourceInterface> CreateAudioSource(
+		  const cricket::AudioOptions& options) override;
+		rtc::scoped_refptr<webrtc::VideoTrackInterface> CreateVideoTrack(
+		  const std::string& label, webrtc::VideoTrackSourceInterface* source) override;
+		rtc::scoped_refptr<webrtc::AudioTrackInterface> CreateAudioTrack(
+		  const std::string& label, webrtc::AudioSourceInterface* source) override;
+		bool StartAecDump(FILE* file, int64_t maxSizeBytes) override;
+		void StopAecDump() override;
+
+	private:
+		rtc::scoped_refptr<webrtc::PeerConnectionInterface> StartEventLog(
+		  rtc::scoped_refptr<webrtc::PeerConnectionInterface> peerConnection);
+
+	private:
+		rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> factory;
+		std::shared_ptr<Queue> queue;
+		// Not to be confused with webrtc::PeerConnectionFactoryInterface::Options.
+		RtcEventLogWriter::Options options;
+	};
+
+	struct File
+	{
+		FILE* file{ nullptr };
+		uint32_t part{ 0 };
+		uint64_t size{ 0 };
+		std::chrono::steady_clock::time_point openedAt;
+		// Oldest first, the current one included.
+		std::deque<std::string> paths;
+	};
+
+	void Run();
+	void Drain();
+	void Write(const Chunk& chunk);
+	bool Open(uint32_t peerConnection, File& file);
+	void Report(std::chrono::steady_clock::time_point now);
+
+private:
+	Options options;
+	std::shared_ptr<Queue> queue;
+	std::thread thread;
+	std::string prefix;
+
+	// Writer thread only.
+	std::map<uint32_t, File> files;
+	uint64_t bytes{ 0 };
+	uint64_t filesOpened{ 0 };
+	std::chrono::steady_clock::time_point reportedAt;
+	uint64_t reportedBytes{ 0 };
+	int64_t reportedEncodingCpuNs{ 0 };
+	int64_t reportedWritingCpuNs{ 0 };
+};
+
+#endif
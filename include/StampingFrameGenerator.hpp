@@ -0,0 +1,28 @@
+#ifndef STAMPING_FRAME_GENERATOR_HPP
+#define STAMPING_FRAME_GENERATOR_HPP
+
+#include "api/test/frame_generator_interface.h"
+#include <cstdint>
+#include <memory>
+
+/* Wraps a frame generator to write a FrameStamp, with the generation time and
+ * a frame counter, into every frame. Frames are copied before being stamped,
+ * as generators may hand out shared buffers.
+ */
+class StampingFrameGenerator : public webrtc::test::FrameGeneratorInterface
+{
+public:
+	explicit StampingFrameGenerator(std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator);
+
+	/* Virtual methods inherited from webrtc::test::FrameGeneratorInterface. */
+public:
+	VideoFrameData NextFrame() override;
+	void ChangeResolution(size_t width, size_t height) override;
+
+private:
+	std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator;
+	// Generator thread only.
+	uint32_t frameNumber{ 0 };
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef STATS_COLLECTOR_HPP
+#define STATS_COLLECTOR_HPP
+
+#include "DataMessageDispatcher.hpp"
+#include "HttpServer.hpp"
+#include "mediasoupclient.hpp"
+#include "json.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Periodically polls the WebRTC stats of the send transport, which include
+ * those of its Producers, keeping only the fields needed to spot encoder CPU
+ * limits and congestion, and serves the latest snapshot in Prometheus text
+ * format on a local HTTP /metrics endpoint, along with the messages received
+ * per DataConsumer label.
+ */
+class StatsCollector
+{
+public:
+	struct Options
+	{
+		uint32_t intervalMs{ 1000 };
+		std::string host{ "127.0.0.1" };
+		uint16_t port{ 9100 };
+	};
+
+	/* One per outbound RTP stream (one per simulcast layer). */
+	struct OutboundRtpStats
+	{
+		std::string id;
+		std::string kind;
+		std::string rid;
+		uint32_t ssrc{ 0 };
+		uint64_t bytesSent{ 0 };
+		uint64_t packetsSent{ 0 };
+		uint64_t retransmittedBytesSent{ 0 };
+		uint64_t nackCount{ 0 };
+		uint64_t pliCount{ 0 };
+		// Video only.
+		uint64_t framesEncoded{ 0 };
+		double totalEncodeTime{ 0 };
+		double framesPerSecond{ 0 };
+		uint32_t frameWidth{ 0 };
+		uint32_t frameHeight{ 0 };
+		std::string qualityLimitationReason;
+		// From the matching remote-inbound-rtp, if any.
+		double roundTripTime{ 0 };
+		int64_t packetsLost{ 0 };
+		double fractionLost{ 0 };
+		// Computed over the last interval.
+		double bitrate{ 0 };
+		double encodeTimeMs{ 0 };
+	};
+
+	/* Selected candidate pair of the send transport. */
+	struct TransportStats
+	{
+		double currentRoundTripTime{ 0 };
+		double availableOutgoingBitrate{ 0 };
+		uint64_t bytesSent{ 0 };
+		uint64_t bytesReceived{ 0 };
+	};
+
+	struct Snapshot
+	{
+		std::vector<OutboundRtpStats> outboundRtp;
+		TransportStats transport;
+		std::vector<DataMessageDispatcher::Counters> dataMessages;
+		uint64_t polls{ 0 };
+		uint64_t failedPolls{ 0 };
+	};
+
+	// Parses the stats returned by a Producer or Transport GetStats() into
+	// |snapshot|, skipping the outbound RTP streams it already has. Rates are
+	// left untouched.
+	static void ParseStats(const nlohmann::json& stats, Snapshot& snapshot);
+
+public:
+	explicit StatsCollector(const Options& options);
+	~StatsCollector();
+
+	const Options& GetOptions() const
+	{
+		return this->options;
+	}
+
+	// |dataMessageDispatcher| may be null, it must outlive Stop() otherwise.
+	void Start(
+	  mediasoupclient::SendTransport* sendTransport,
+	  const DataMessageDispatcher* dataMessageDispatcher);
+	void Stop();
+
+	Snapshot GetSnapshot() const;
+	std::string ToPrometheus() const;
+
+private:
+	struct Previous
+	{
+		std::chrono::steady_clock::time_point time;
+		uint64_t bytesSent{ 0 };
+		uint64_t framesEncoded{ 0 };
+		double totalEncodeTime{ 0 };
+	};
+
+	void Run();
+	void Poll();
+
+private:
+	Options options;
+	mediasoupclient::SendTransport* sendTransport{ nullptr };
+	const DataMessageDispatcher* dataMessageDispatcher{ nullptr };
+	std::unique_ptr<HttpServer> httpServer;
+	std::thread thread;
+
+	mutable std::mutex mutex;
+	std::condition_variable cv;
+	bool stopping{ false };
+	// Protected by |mutex|.
+	Snapshot snapshot;
+
+	// Poller thread only. Outbound RTP stats id => previous counters.
+	std::map<std::string, Previous> previous;
+};
+
+#endif
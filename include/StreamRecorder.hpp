@@ -0,0 +1,171 @@
+#ifndef STREAM_RECORDER_HPP
+#define STREAM_RECORDER_HPP
+
+#include "MpscRing.hpp"
+#include "mediasoupclient.hpp"
+#include "api/frame_transformer_interface.h"
+#include "api/scoped_refptr.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* Records what the Producers actually send, as encoded by libwebrtc: a frame
+ * transformer between the encoder and the packetizer of each RtpSender copies
+ * the frames out, and passes them on untouched.
+ *
+ * Every video layer (SSRC) is written to its own IVF file, audio (Opus only)
+ * to an Ogg file, named after the Producer id and the layer rid (its SSRC if
+ * the rid is unknown):
+ *
+ *   <directory>/video-<producerId>-<rid>.ivf
+ *   <directory>/audio-<producerId>.ogg
+ *
+ * IVF files can be played back by ffmpeg or replayed through the decoding
+ * IvfVideoFrameGenerator.
+ *
+ * The encoder threads never wait: frames are copied into a bounded lock-free
+ * ring of buffers allocated upfront, and written by a background thread
+ * through fixed size stdio buffers. Frames not fitting in the ring are left
+ * out of the recording, and counted.
+ */
+class StreamRecorder
+{
+public:
+	struct Options
+	{
+		std::string directory{ "." };
+		// Frames queued for writing, rounded up to a power of two.
+		uint32_t queueSize{ 256 };
+		// Allocated upfront for every queued frame. Larger frames grow it.
+		size_t frameBufferSize{ 64 * 1024 };
+	};
+
+public:
+	explicit StreamRecorder(const Options& options);
+	~StreamRecorder();
+
+	const Options& GetOptions() const
+	{
+		return this->options;
+	}
+
+	void Start();
+	// Records the frames sent by |producer| from now on. Returns false if its
+	// codec can not be recorded.
+	bool Record(mediasoupclient::Producer* producer);
+	// Writes the queued frames and closes the files. Frames sent afterwards are
+	// just passed on.
+	void Stop();
+
+private:
+	struct Frame
+	{
+		// Index in |sources|.
+		uint32_t source{ 0 };
+		uint32_t ssrc{ 0 };
+		uint32_t timestamp{ 0 };
+		bool keyFrame{ false };
+		std::vector<uint8_t> data;
+	};
+
+	// Shared with the transformers, which may outlive the recorder.
+	struct Queue
+	{
+		explicit Queue(size_t size) : ring(size)
+		{
+		}
+
+		MpscRing<Frame> ring;
+		std::atomic<bool> accepting{ false };
+		std::atomic<uint64_t> dropped{ 0 };
+	};
+
+	// A recorded Producer.
+	struct Source
+	{
+		// Directory, kind and Producer id.
+		std::string prefix;
+		bool audio{ false };
+		// IVF fourcc.
+		char fourcc[4]{};
+		// Encoding rids by SSRC, when both are known. Files are named after the
+		// SSRC otherwise.
+		std::map<uint32_t, std::string> rids;
+	};
+
+	struct Stream
+	{
+		std::string path;
+		FILE* file{ nullptr };
+		// Not opened again once it failed.
+		bool failed{ false };
+		std::unique_ptr<char[]> writeBuffer;
+		uint64_t frames{ 0 };
+		uint64_t bytes{ 0 };
+		uint32_t previousTimestamp{ 0 };
+		// RTP timestamp of the last frame, unwrapped and relative to the first one.
+		int64_t timestamp{ 0 };
+		// From the key frames, VP8 and VP9 only.
+		uint16_t width{ 0 };
+		uint16_t height{ 0 };
+		// Ogg page sequence number and granule position.
+		uint32_t pages{ 0 };
+		int64_t granule{ 0 };
+	};
+
+	class Tap : public webrtc::FrameTransformerInterface
+	{
+	public:
+		Tap(std::shared_ptr<Queue> queue, uint32_t source, bool audio);
+
+		/* Virtual methods inherited from webrtc::FrameTransformerInterface. */
+	public:
+		void Transform(std::unique_ptr<webrtc::TransformableFrameInterface> frame) override;
+		void RegisterTransformedFrameCallback(
+		  rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback) override;
+		void RegisterTransformedFrameSinkCallback(
+		  rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback, uint32_t ssrc) override;
+		void UnregisterTransformedFrameCallback() override;
+		void UnregisterTransformedFrameSinkCallback(uint32_t ssrc) override;
+
+	private:
+		std::shared_ptr<Queue> queue;
+		uint32_t source;
+		bool audio;
+
+		std::mutex mutex;
+		// Protected by |mutex|.
+		rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback;
+		std::map<uint32_t, rtc::scoped_refptr<webrtc::TransformedFrameCallback>> sinkCallbacks;
+	};
+
+	void Run();
+	void Drain();
+	void Write(const Frame& frame);
+	bool Open(Stream& stream, const Source& source);
+	void WriteOggPage(Stream& stream, uint8_t flags, const uint8_t* data, size_t size);
+	void Close(Stream& stream, const Source& source);
+
+private:
+	Options options;
+	std::shared_ptr<Queue> queue;
+	std::thread thread;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stopping{ false };
+	// Also protected by |mutex|, appended to by Record().
+	std::vector<Source> sources;
+	// Writer thread only, keyed by source and SSRC.
+	std::map<std::pair<uint32_t, uint32_t>, Stream> streams;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef TRACING_VIDEO_ENCODER_FACTORY_HPP
+#define TRACING_VIDEO_ENCODER_FACTORY_HPP
+
+#include "api/video_codecs/video_encoder.h"
+#include "api/video_codecs/video_encoder_factory.h"
+#include <memory>
+#include <vector>
+
+/* Wraps the encoders of another factory to record the encode start, encode
+ * end and packetization FrameTracer points of every frame.
+ *
+ * Encoded images are handed synchronously to the RTP packetizer, so the time
+ * it takes for the downstream callback to return is the packetization time.
+ */
+class TracingVideoEncoderFactory : public webrtc::VideoEncoderFactory
+{
+public:
+	explicit TracingVideoEncoderFactory(std::unique_ptr<webrtc::VideoEncoderFactory> factory);
+
+	/* Virtual methods inherited from webrtc::VideoEncoderFactory. */
+public:
+	std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override;
+	std::vector<webrtc::SdpVideoFormat> GetImplementations() const override;
+	CodecInfo QueryVideoEncoder(const webrtc::SdpVideoFormat& format) const override;
+	std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(
+	  const webrtc::SdpVideoFormat& format) override;
+
+private:
+	std::unique_ptr<webrtc::VideoEncoderFactory> factory;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef TRANSPORT_RECOVERY_HPP
+#define TRANSPORT_RECOVERY_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+/* Recovers from transport connection failures without leaving the room.
+ *
+ * Once a transport gets "disconnected" or "failed" the ICE of every unhealthy
+ * transport is restarted, waiting a jittered exponential backoff before each
+ * attempt (a disconnection often heals by itself meanwhile). If the transports
+ * are not connected again after |maxIceRestarts| attempts, or if ICE can't be
+ * restarted at all, the transports and their producers are recreated until
+ * that succeeds.
+ *
+ * Recovery runs on its own thread, since restarting ICE blocks on the
+ * signaling thread that reports the connection state changes.
+ */
+class TransportRecovery
+{
+public:
+	struct Options
+	{
+		uint32_t initialBackoffMs{ 500 };
+		uint32_t maxBackoffMs{ 10000 };
+		// Time given to each attempt to get the transports connected.
+		uint32_t connectTimeoutMs{ 5000 };
+		uint32_t maxIceRestarts{ 3 };
+	};
+
+	// Returns false if ICE could not be restarted.
+	using RestartIceHandler = std::function<bool(const std::string& transportId)>;
+	// Returns false if the transports could not be recreated.
+	using RecreateHandler = std::function<bool()>;
+
+public:
+	TransportRecovery(const Options& options, RestartIceHandler restartIce, RecreateHandler recreate);
+	~TransportRecovery();
+
+	void Start();
+	void Stop();
+
+	// To be called from Transport::Listener::OnConnectionStateChange().
+	void OnConnectionStateChange(const std::string& transportId, const std::string& state);
+
+private:
+	void Run();
+	void Recover(std::unique_lock<std::mutex>& lock);
+	bool IsFailing() const;
+	bool IsConnected() const;
+	uint32_t GetBackoffMs(uint32_t attempt);
+
+private:
+	Options options;
+	RestartIceHandler restartIce;
+	RecreateHandler recreate;
+	std::thread thread;
+	std::mt19937 random{ std::random_device{}() };
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stopping{ false };
+	// Protected by |mutex|. Transport id => connection state.
+	std::map<std::string, std::string> states;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef TUNED_VIDEO_ENCODER_FACTORY_HPP
+#define TUNED_VIDEO_ENCODER_FACTORY_HPP
+
+#include "api/video_codecs/video_encoder.h"
+#include "api/video_codecs/video_encoder_factory.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Wraps the encoders of another factory to override the settings libwebrtc
+ * derives on its own: the encoder thread count, the speed preset and the
+ * content type.
+ *
+ * Defaults leave the setting as libwebrtc chose it.
+ */
+class TunedVideoEncoderFactory : public webrtc::VideoEncoderFactory
+{
+public:
+	// Speed preset, higher values trade CPU for quality. VP8 and VP9 only.
+	enum class Complexity : uint8_t
+	{
+		kDefault = 0,
+		kNormal,
+		kHigh,
+		kHigher,
+		kMax
+	};
+
+	enum class ContentType : uint8_t
+	{
+		kDefault = 0,
+		kRealtime,
+		// Favours sharpness over frame rate, for text and slides.
+		kScreenshare
+	};
+
+	struct Options
+	{
+		// 0 lets the encoder pick it from the available cores.
+		uint32_t threads{ 0 };
+		Complexity complexity{ Complexity::kDefault };
+		ContentType contentType{ ContentType::kDefault };
+	};
+
+	static bool ParseComplexity(const std::string& name, Complexity& complexity);
+	static bool ParseContentType(const std::string& name, ContentType& contentType);
+
+public:
+	TunedVideoEncoderFactory(
+	  const Options& options, std::unique_ptr<webrtc::VideoEncoderFactory> factory);
+
+	/* Virtual methods inherited from webrtc::VideoEncoderFactory. */
+public:
+	std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override;
+	std::vector<webrtc::SdpVideoFormat> GetImplementations() const override;
+	CodecInfo QueryVideoEncoder(const webrtc::SdpVideoFormat& format) const override;
+	std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(
+	  const webrtc::SdpVideoFormat& format) override;
+
+private:
+	Options options;
+	std::unique_ptr<webrtc::VideoEncoderFactory> factory;
+};
+
+#endif
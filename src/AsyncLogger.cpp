@@ -0,0 +1,632 @@
+#include "AsyncLogger.hpp"
+#include "MpscRing.hpp"
+#include "mediasoupclient.hpp"
+#include "rtc_base/logging.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <pthread.h>
+#include <streambuf>
+#include <thread>
+
+using namespace std::chrono;
+
+std::atomic<uint8_t> AsyncLogger::minLevel{ static_cast<uint8_t>(AsyncLogger::Level::kInfo) };
+
+namespace
+{
+	using Level  = AsyncLogger::Level;
+	using Format = AsyncLogger::Format;
+
+	// Queued messages are written at least this often. Errors are written at once.
+	constexpr auto kFlushInterval = milliseconds(50);
+
+	struct Entry
+	{
+		int64_t timeMs{ 0 };
+		Level level{ Level::kInfo };
+		uint32_t suppressed{ 0 };
+		size_t size{ 0 };
+		char thread[16]{};
+		char text[AsyncLogger::kMaxMessageSize];
+	};
+
+	struct State
+	{
+		AsyncLogger::Options options;
+		MpscRing<Entry> ring{ AsyncLogger::kQueueSize };
+		std::atomic<bool> running{ false };
+		// Also read by synchronous writes.
+		std::atomic<Format> format{ Format::kText };
+		std::atomic<uint64_t> dropped{ 0 };
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool stopping{ false };
+		FILE* file{ nullptr };
+	};
+
+	std::atomic<uint32_t> rateLimit{ AsyncLogger::Options().rateLimit };
+
+	// Never destroyed, threads may keep logging while the process exits.
+	State& state()
+	{
+		static auto* state = new State();
+
+		return *state;
+	}
+
+	const char* threadName()
+	{
+		static std::atomic<uint32_t> unnamed{ 0 };
+		thread_local char name[16] = "";
+
+		if (name[0] == '\0')
+		{
+			pthread_getname_np(pthread_self(), name, sizeof(name));
+
+			if (name[0] == '\0')
+				std::snprintf(name, sizeof(name), "thread-%u", ++unnamed);
+		}
+
+		return name;
+	}
+
+	const char* levelName(Level level, Format format)
+	{
+		static const char* textNames[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+		static const char* jsonNames[] = { "debug", "info", "warn", "error" };
+
+		auto index = static_cast<size_t>(level);
+
+		return format == Format::kJson ? jsonNames[index] : textNames[index];
+	}
+
+	void appendJsonString(std::string& out, const char* data, size_t size)
+	{
+		out += '"';
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			char c = data[i];
+
+			switch (c)
+			{
+				case '"':
+					out += "\\\"";
+					break;
+				case '\\':
+					out += "\\\\";
+					break;
+				case '\n':
+					out += "\\n";
+					break;
+				case '\r':
+					out += "\\r";
+					break;
+				case '\t':
+					out += "\\t";
+					break;
+				default:
+				{
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						char escaped[8];
+
+						std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+						out += escaped;
+					}
+					else
+					{
+						out += c;
+					}
+				}
+			}
+		}
+
+		out += '"';
+	}
+
+	void appendLine(std::string& out, Format format, const Entry& entry)
+	{
+		if (format == Format::kText)
+		{
+			out.append("[").append(levelName(entry.level, format)).append("] ");
+			out.append(entry.text, entry.size);
+
+			if (entry.suppressed)
+				out.append(" [suppressed:").append(std::to_string(entry.suppressed)).append("]");
+
+			out += '\n';
+
+			return;
+		}
+
+		time_t seconds = static_cast<time_t>(entry.timeMs / 1000);
+		struct tm tm;
+		char time[64];
+
+		gmtime_r(&seconds, &tm);
+		std::snprintf(
+		  time,
+		  sizeof(time),
+		  "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+		  tm.tm_year + 1900,
+		  tm.tm_mon + 1,
+		  tm.tm_mday,
+		  tm.tm_hour,
+		  tm.tm_min,
+		  tm.tm_sec,
+		  static_cast<int>(entry.timeMs % 1000));
+
+		out.append("{\"time\":\"").append(time);
+		out.append("\",\"level\":\"").append(levelName(entry.level, format));
+		out.append("\",\"thread\":");
+		appendJsonString(out, entry.thread, std::strlen(entry.thread));
+		out.append(",\"msg\":");
+		appendJsonString(out, entry.text, entry.size);
+
+		if (entry.suppressed)
+			out.append(",\"suppressed\":").append(std::to_string(entry.suppressed));
+
+		out.append("}\n");
+	}
+
+	void fillEntry(Entry& entry, Level level, const char* data, size_t size, uint32_t suppressed)
+	{
+		size_t maxSize = AsyncLogger::kMaxMessageSize;
+
+		entry.timeMs =
+		  duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+		entry.level      = level;
+		entry.suppressed = suppressed;
+		entry.size       = std::min(size, maxSize);
+
+		std::memcpy(entry.text, data, entry.size);
+		std::strncpy(entry.thread, threadName(), sizeof(entry.thread) - 1);
+	}
+
+	// Warnings and errors go to stderr unless writing to a file.
+	FILE* streamFor(const State& s, Level level)
+	{
+		if (s.file)
+			return s.file;
+
+		return level >= Level::kWarn ? stderr : stdout;
+	}
+
+	// Writes whatever is queued. Writer thread, or Stop() once it is joined.
+	void drain(State& s)
+	{
+		std::string out;
+		std::string err;
+
+		while (s.ring.TryPop([&s, &out, &err](Entry& entry) {
+			appendLine(streamFor(s, entry.level) == stderr ? err : out, s.format, entry);
+		}))
+		{
+		}
+
+		uint64_t dropped = s.dropped.exchange(0, std::memory_order_relaxed);
+
+		if (dropped)
+		{
+			Entry entry;
+			auto text = std::to_string(dropped) + " log messages dropped, queue full";
+
+			fillEntry(entry, Level::kWarn, text.data(), text.size(), 0);
+			appendLine(streamFor(s, Level::kWarn) == stderr ? err : out, s.format, entry);
+		}
+
+		if (!out.empty())
+		{
+			FILE* stream = s.file ? s.file : stdout;
+
+			std::fwrite(out.data(), 1, out.size(), stream);
+			std::fflush(stream);
+		}
+
+		if (!err.empty())
+		{
+			std::fwrite(err.data(), 1, err.size(), stderr);
+			std::fflush(stderr);
+		}
+	}
+
+	void run(State& s)
+	{
+		std::unique_lock<std::mutex> lock(s.mutex);
+
+		while (!s.stopping)
+		{
+			s.cv.wait_for(lock, kFlushInterval);
+
+			lock.unlock();
+			drain(s);
+			lock.lock();
+		}
+	}
+
+	// Fixed size stream buffer, longer messages are truncated.
+	class MessageBuffer : public std::streambuf
+	{
+	public:
+		MessageBuffer()
+		{
+			this->Reset();
+		}
+
+		void Reset()
+		{
+			this->setp(this->data, this->data + sizeof(this->data));
+			this->truncated = false;
+		}
+
+		const char* Data() const
+		{
+			return this->data;
+		}
+
+		size_t Size()
+		{
+			size_t size = this->pptr() - this->pbase();
+
+			if (this->truncated && size >= 3)
+				std::memcpy(this->data + size - 3, "...", 3);
+
+			return size;
+		}
+
+	protected:
+		int_type overflow(int_type /*c*/) override
+		{
+			this->truncated = true;
+
+			return traits_type::eof();
+		}
+
+	private:
+		char data[AsyncLogger::kMaxMessageSize];
+		bool truncated{ false };
+	};
+
+	// Strips the "[LEVEL] " prefix mediasoupclient puts in its messages.
+	void stripLevelPrefix(const char*& data, size_t& size)
+	{
+		if (size == 0 || data[0] != '[')
+			return;
+
+		const char* end = static_cast<const char*>(std::memchr(data, ']', std::min<size_t>(size, 8)));
+
+		if (!end)
+			return;
+
+		size -= end - data + 1;
+		data = end + 1;
+
+		if (size && *data == ' ')
+		{
+			++data;
+			--size;
+		}
+	}
+
+	class MediasoupclientLogHandler : public mediasoupclient::Logger::LogHandlerInterface
+	{
+	public:
+		void OnLog(mediasoupclient::Logger::LogLevel level, char* payload, size_t len) override
+		{
+			using MscLevel = mediasoupclient::Logger::LogLevel;
+
+			Level logLevel;
+
+			switch (level)
+			{
+				case MscLevel::LOG_ERROR:
+					logLevel = Level::kError;
+					break;
+				case MscLevel::LOG_WARN:
+					logLevel = Level::kWarn;
+					break;
+				default:
+					logLevel = Level::kDebug;
+			}
+
+			uint32_t suppressed = 0;
+
+			if (!AsyncLogger::IsEnabled(logLevel) || !this->limiter.Allow(suppressed))
+				return;
+
+			// |len| is what snprintf() wanted to write, not what it wrote.
+			const char* data = payload;
+			size_t size      = strnlen(payload, len);
+
+			stripLevelPrefix(data, size);
+
+			AsyncLogger::Write(logLevel, data, size, suppressed);
+		}
+
+	private:
+		AsyncLogger::RateLimiter limiter;
+	};
+
+	class WebrtcLogSink : public rtc::LogSink
+	{
+	public:
+		void OnLogMessage(const std::string& message, rtc::LoggingSeverity severity) override
+		{
+			Level level;
+
+			switch (severity)
+			{
+				case rtc::LS_ERROR:
+					level = Level::kError;
+					break;
+				case rtc::LS_WARNING:
+					level = Level::kWarn;
+					break;
+				case rtc::LS_INFO:
+					level = Level::kInfo;
+					break;
+				default:
+					level = Level::kDebug;
+			}
+
+			uint32_t suppressed = 0;
+
+			if (!AsyncLogger::IsEnabled(level) || !this->limiter.Allow(suppressed))
+				return;
+
+			size_t size = message.size();
+
+			if (size && message[size - 1] == '\n')
+				--size;
+
+			AsyncLogger::Write(level, message.data(), size, suppressed);
+		}
+
+		void OnLogMessage(const std::string& message) override
+		{
+			this->OnLogMessage(message, rtc::LS_INFO);
+		}
+
+	private:
+		AsyncLogger::RateLimiter limiter;
+	};
+} // namespace
+
+struct AsyncLogger::Message::Buffer
+{
+	Buffer() : stream(&buffer)
+	{
+	}
+
+	MessageBuffer buffer;
+	std::ostream stream;
+	bool inUse{ false };
+};
+
+bool AsyncLogger::RateLimiter::Allow(uint32_t& suppressed)
+{
+	uint32_t limit = rateLimit.load(std::memory_order_relaxed);
+
+	if (limit)
+	{
+		int64_t now     = duration_cast<seconds>(steady_clock::now().time_since_epoch()).count();
+		int64_t current = this->second.load(std::memory_order_relaxed);
+
+		if (now != current && this->second.compare_exchange_strong(current, now))
+			this->count.store(0, std::memory_order_relaxed);
+
+		if (this->count.fetch_add(1, std::memory_order_relaxed) >= limit)
+		{
+			this->suppressedCount.fetch_add(1, std::memory_order_relaxed);
+
+			return false;
+		}
+	}
+
+	suppressed = this->suppressedCount.exchange(0, std::memory_order_relaxed);
+
+	return true;
+}
+
+AsyncLogger::Message::Message(Level level, uint32_t suppressed)
+  : level(level), suppressed(suppressed)
+{
+	thread_local Buffer threadBuffer;
+
+	// Something logged while this thread was already building a message.
+	if (threadBuffer.inUse)
+	{
+		this->buffer    = new Buffer();
+		this->ownBuffer = true;
+	}
+	else
+	{
+		this->buffer    = &threadBuffer;
+		this->ownBuffer = false;
+	}
+
+	this->buffer->inUse = true;
+	this->buffer->buffer.Reset();
+	this->buffer->stream.clear();
+	this->buffer->stream.flags(std::ios_base::dec | std::ios_base::skipws);
+	this->buffer->stream.precision(6);
+	this->buffer->stream.fill(' ');
+}
+
+AsyncLogger::Message::~Message()
+{
+	AsyncLogger::Write(
+	  this->level, this->buffer->buffer.Data(), this->buffer->buffer.Size(), this->suppressed);
+
+	this->buffer->inUse = false;
+
+	if (this->ownBuffer)
+		delete this->buffer;
+}
+
+std::ostream& AsyncLogger::Message::Stream()
+{
+	return this->buffer->stream;
+}
+
+bool AsyncLogger::ParseLevel(const std::string& name, Level& level)
+{
+	if (name == "debug")
+		level = Level::kDebug;
+	else if (name == "info")
+		level = Level::kInfo;
+	else if (name == "warn")
+		level = Level::kWarn;
+	else if (name == "error")
+		level = Level::kError;
+	else
+		return false;
+
+	return true;
+}
+
+bool AsyncLogger::ParseFormat(const std::string& name, Format& format)
+{
+	if (name == "text")
+		format = Format::kText;
+	else if (name == "json")
+		format = Format::kJson;
+	else
+		return false;
+
+	return true;
+}
+
+void AsyncLogger::Start(const Options& options)
+{
+	State& s = state();
+
+	if (s.running)
+		return;
+
+	s.options  = options;
+	s.format   = options.format;
+	s.stopping = false;
+
+	if (!options.file.empty())
+	{
+		s.file = std::fopen(options.file.c_str(), "a");
+
+		if (!s.file)
+			BCST_ERROR << "unable to open log file '" << options.file << "'";
+	}
+
+	minLevel  = static_cast<uint8_t>(options.level);
+	rateLimit = options.rateLimit;
+
+	s.thread  = std::thread(run, std::ref(s));
+	s.running = true;
+
+	// The process may leave through std::exit().
+	static bool atExitRegistered = false;
+
+	if (!atExitRegistered)
+	{
+		std::atexit(AsyncLogger::Stop);
+		atExitRegistered = true;
+	}
+}
+
+void AsyncLogger::Stop()
+{
+	State& s = state();
+
+	if (!s.running.exchange(false))
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		s.stopping = true;
+	}
+
+	s.cv.notify_all();
+	s.thread.join();
+
+	drain(s);
+
+	if (s.file)
+	{
+		std::fclose(s.file);
+		s.file = nullptr;
+	}
+}
+
+void AsyncLogger::Write(Level level, const char* data, size_t size, uint32_t suppressed)
+{
+	State& s = state();
+
+	if (!s.running.load(std::memory_order_acquire))
+	{
+		Entry entry;
+		std::string line;
+
+		fillEntry(entry, level, data, size, suppressed);
+		appendLine(line, s.format, entry);
+
+		FILE* stream = level >= Level::kWarn ? stderr : stdout;
+
+		std::fwrite(line.data(), 1, line.size(), stream);
+		std::fflush(stream);
+
+		return;
+	}
+
+	bool queued =
+	  s.ring.TryPush([=](Entry& entry) { fillEntry(entry, level, data, size, suppressed); });
+
+	if (!queued)
+		s.dropped.fetch_add(1, std::memory_order_relaxed);
+	else if (level == Level::kError)
+		s.cv.notify_one();
+}
+
+void AsyncLogger::RouteMediasoupclientLogs()
+{
+	static MediasoupclientLogHandler handler;
+
+	auto level = static_cast<Level>(minLevel.load());
+
+	// mediasoupclient has no info level, and its trace level is too verbose.
+	if (level == Level::kDebug)
+		mediasoupclient::Logger::SetLogLevel(mediasoupclient::Logger::LogLevel::LOG_DEBUG);
+	else if (level == Level::kError)
+		mediasoupclient::Logger::SetLogLevel(mediasoupclient::Logger::LogLevel::LOG_ERROR);
+	else
+		mediasoupclient::Logger::SetLogLevel(mediasoupclient::Logger::LogLevel::LOG_WARN);
+
+	mediasoupclient::Logger::SetHandler(&handler);
+}
+
+void AsyncLogger::RouteWebrtcLogs(const std::string& severity)
+{
+	static WebrtcLogSink sink;
+
+	rtc::LoggingSeverity loggingSeverity;
+
+	if (severity == "info")
+		loggingSeverity = rtc::LS_INFO;
+	else if (severity == "warn")
+		loggingSeverity = rtc::LS_WARNING;
+	else if (severity == "error")
+		loggingSeverity = rtc::LS_ERROR;
+	else
+		return;
+
+	// Only through the sink, not synchronously to stderr.
+	rtc::LogMessage::LogToDebug(rtc::LS_NONE);
+	rtc::LogMessage::AddLogToStream(&sink, loggingSeverity);
+}
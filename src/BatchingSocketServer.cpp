@@ -0,0 +1,583 @@
+#include "BatchingSocketServer.hpp"
+#include "AsyncLogger.hpp"
+#include "rtc_base/async_socket.h"
+#include "rtc_base/socket_address.h"
+#include "rtc_base/time_utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+
+#ifdef __linux__
+
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Older headers lack them, the kernel tells whether it supports them.
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+namespace
+{
+	// Larger datagrams are sent on their own, and truncated ones dropped.
+	constexpr size_t kSlotSize = 2048;
+	// What GRO coalesces at most, and the messages read at once with it.
+	constexpr size_t kGroMessageSize = 65536;
+	constexpr size_t kGroMessages    = 4;
+	// Limits of a GSO message: UDP_MAX_SEGMENTS, and the UDP payload size.
+	constexpr size_t kMaxGsoSegments = 64;
+	constexpr size_t kMaxGsoSize     = 65000;
+	constexpr size_t kControlSize    = CMSG_SPACE(sizeof(int));
+
+	struct Slot
+	{
+		uint8_t data[kSlotSize];
+		size_t size{ 0 };
+		sockaddr_storage address;
+		socklen_t addressSize{ 0 };
+	};
+
+	// A datagram received, possibly one of those GRO coalesced.
+	struct Segment
+	{
+		const uint8_t* data{ nullptr };
+		size_t size{ 0 };
+		// Index of the message it was received in.
+		size_t message{ 0 };
+	};
+
+	bool sameDestination(const Slot& a, const Slot& b)
+	{
+		return a.addressSize == b.addressSize &&
+		       std::memcmp(&a.address, &b.address, a.addressSize) == 0;
+	}
+
+	bool setUdpOption(int fd, int option, int value)
+	{
+		return ::setsockopt(fd, SOL_UDP, option, &value, sizeof(value)) == 0;
+	}
+
+	bool kernelSupports(int option)
+	{
+		int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+		if (fd < 0)
+			return false;
+
+		bool supported = setUdpOption(fd, option, 0);
+
+		::close(fd);
+
+		return supported;
+	}
+
+	// PhysicalSocket disables the read events of a socket when signaling them,
+	// and enables them again once read from. Reads done here bypass it.
+	struct SocketEvents : public rtc::SocketDispatcher
+	{
+		using rtc::SocketDispatcher::EnableEvents;
+	};
+} // namespace
+
+class BatchingSocketServer::UdpSocket : public rtc::AsyncSocketAdapter
+{
+public:
+	UdpSocket(BatchingSocketServer* server, rtc::SocketDispatcher* socket)
+	  : rtc::AsyncSocketAdapter(socket), server(server), dispatcher(socket),
+	    fd(socket->GetDescriptor())
+	{
+		this->gro = server->gro && setUdpOption(this->fd, UDP_GRO, 1);
+	}
+
+	~UdpSocket() override
+	{
+		auto& pending = this->server->pendingSockets;
+
+		pending.erase(std::remove(pending.begin(), pending.end(), this), pending.end());
+	}
+
+	void Flush()
+	{
+		this->pending = false;
+
+		size_t sent = 0;
+
+		while (sent < this->queued)
+		{
+			size_t messages = this->PrepareSend(sent);
+
+			int result =
+			  ::sendmmsg(this->fd, this->headers.data(), static_cast<unsigned int>(messages), 0);
+
+			this->server->stats.sendCalls++;
+
+			if (result < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				// The datagrams of a GSO message failing are sent again without it.
+				if (this->messageSlots[0] > 1 && (errno == EIO || errno == EINVAL))
+				{
+					this->server->DisableGso(errno);
+
+					continue;
+				}
+
+				// As PhysicalSocket would do, the datagrams are lost.
+				this->server->stats.sendErrors += this->queued - sent;
+				this->SetError(errno);
+
+				break;
+			}
+
+			for (int i = 0; i < result; ++i)
+			{
+				size_t slots = this->messageSlots[i];
+
+				if (slots > 1)
+				{
+					this->server->stats.gsoSends++;
+					this->server->stats.gsoSegments += slots;
+				}
+
+				this->server->stats.sentPackets += slots;
+				sent += slots;
+			}
+		}
+
+		this->queued = 0;
+	}
+
+	/* Virtual methods inherited from rtc::AsyncSocketAdapter. */
+public:
+	int SendTo(const void* data, size_t size, const rtc::SocketAddress& address) override
+	{
+		if (size > kSlotSize)
+		{
+			this->Flush();
+
+			this->server->stats.sendCalls++;
+			this->server->stats.sentPackets++;
+
+			return rtc::AsyncSocketAdapter::SendTo(data, size, address);
+		}
+
+		if (this->sendSlots.empty())
+			this->sendSlots.resize(this->server->options.batchSize);
+
+		if (!this->pending)
+		{
+			this->pending = true;
+			this->server->pendingSockets.push_back(this);
+		}
+
+		auto& slot = this->sendSlots[this->queued++];
+
+		std::memcpy(slot.data, data, size);
+		slot.size        = size;
+		slot.addressSize = static_cast<socklen_t>(address.ToSockAddrStorage(&slot.address));
+
+		if (this->queued == this->sendSlots.size())
+			this->Flush();
+
+		return static_cast<int>(size);
+	}
+
+	int RecvFrom(void* data, size_t size, rtc::SocketAddress* address, int64_t* timestamp) override
+	{
+		if (this->delivered == this->segments.size() && !this->Receive())
+			return -1;
+
+		const auto& segment = this->segments[this->delivered++];
+
+		size = std::min(size, segment.size);
+
+		std::memcpy(data, segment.data, size);
+
+		if (address)
+			rtc::SocketAddressFromSockAddrStorage(this->receiveAddresses[segment.message], address);
+
+		if (timestamp)
+			*timestamp = this->receivedAtUs;
+
+		return static_cast<int>(size);
+	}
+
+	int SetOption(rtc::Socket::Option option, int value) override
+	{
+		// E.g. the DSCP, which applies to the datagrams queued so far.
+		this->Flush();
+
+		return rtc::AsyncSocketAdapter::SetOption(option, value);
+	}
+
+	int Close() override
+	{
+		this->Flush();
+
+		this->segments.clear();
+		this->delivered = 0;
+
+		return rtc::AsyncSocketAdapter::Close();
+	}
+
+protected:
+	void OnReadEvent(rtc::AsyncSocket* /*socket*/) override
+	{
+		// AsyncUDPSocket reads a single datagram per read event, those read ahead
+		// are delivered before the socket is polled again.
+		this->SignalReadEvent(this);
+
+		while (this->delivered < this->segments.size())
+		{
+			size_t delivered = this->delivered;
+
+			this->SignalReadEvent(this);
+
+			// Not read, e.g. closed.
+			if (this->delivered == delivered)
+				break;
+		}
+
+		// PhysicalSocketServer::Wait() goes on dispatching socket events until it
+		// times out or is woken up, so what was sent in response (e.g. STUN binding
+		// responses or DTLS flights) must not wait for it to return.
+		this->server->Flush();
+	}
+
+private:
+	// Reads the datagrams available. Returns false, with the socket error set,
+	// if there are none.
+	bool Receive()
+	{
+		size_t messages    = this->gro ? kGroMessages : this->server->options.batchSize;
+		size_t messageSize = this->gro ? kGroMessageSize : kSlotSize;
+
+		if (this->receiveBuffer.empty())
+		{
+			this->receiveBuffer.resize(messages * messageSize);
+			this->receiveAddresses.resize(messages);
+			this->receiveControls.resize(messages * kControlSize);
+			this->segments.reserve(this->gro ? messages * kMaxGsoSegments : messages);
+		}
+
+		this->headers.resize(std::max(this->headers.size(), messages));
+		this->iovecs.resize(std::max(this->iovecs.size(), messages));
+
+		for (size_t i = 0; i < messages; ++i)
+		{
+			auto& header = this->headers[i];
+			auto& iov    = this->iovecs[i];
+
+			iov.iov_base = this->receiveBuffer.data() + i * messageSize;
+			iov.iov_len  = messageSize;
+
+			std::memset(&header, 0, sizeof(header));
+			header.msg_hdr.msg_name       = &this->receiveAddresses[i];
+			header.msg_hdr.msg_namelen    = sizeof(sockaddr_storage);
+			header.msg_hdr.msg_iov        = &iov;
+			header.msg_hdr.msg_iovlen     = 1;
+			header.msg_hdr.msg_control    = this->receiveControls.data() + i * kControlSize;
+			header.msg_hdr.msg_controllen = kControlSize;
+		}
+
+		int result = ::recvmmsg(
+		  this->fd, this->headers.data(), static_cast<unsigned int>(messages), MSG_DONTWAIT, nullptr);
+		int error = errno;
+
+		this->server->stats.receiveCalls++;
+
+		(this->dispatcher->*(&SocketEvents::EnableEvents))(rtc::DE_READ);
+
+		this->segments.clear();
+		this->delivered    = 0;
+		this->receivedAtUs = rtc::TimeMicros();
+
+		for (int i = 0; i < result; ++i)
+		{
+			auto& header       = this->headers[i].msg_hdr;
+			const auto* data   = static_cast<const uint8_t*>(header.msg_iov->iov_base);
+			size_t size        = this->headers[i].msg_len;
+			size_t segmentSize = size;
+
+			if (header.msg_flags & MSG_TRUNC)
+				continue;
+
+			for (auto* cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg))
+			{
+				if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+				{
+					int groSize;
+
+					std::memcpy(&groSize, CMSG_DATA(cmsg), sizeof(groSize));
+
+					if (groSize > 0)
+						segmentSize = static_cast<size_t>(groSize);
+				}
+			}
+
+			if (segmentSize < size)
+			{
+				this->server->stats.groReceives++;
+				this->server->stats.groSegments += (size + segmentSize - 1) / segmentSize;
+			}
+
+			for (size_t offset = 0; offset < size; offset += segmentSize)
+			{
+				Segment segment;
+
+				segment.data    = data + offset;
+				segment.size    = std::min(segmentSize, size - offset);
+				segment.message = i;
+
+				this->segments.push_back(segment);
+			}
+		}
+
+		this->server->stats.receivedPackets += this->segments.size();
+
+		if (this->segments.empty())
+		{
+			this->SetError(result < 0 ? error : EWOULDBLOCK);
+
+			return false;
+		}
+
+		return true;
+	}
+
+	// Fills the headers with the messages sending the queued datagrams from
+	// |first| on, runs of them as GSO messages if enabled. Returns the number
+	// of messages, |messageSlots| holding the number of datagrams of each.
+	size_t PrepareSend(size_t first)
+	{
+		this->headers.resize(std::max(this->headers.size(), this->sendSlots.size()));
+		this->iovecs.resize(std::max(this->iovecs.size(), this->sendSlots.size()));
+		this->messageSlots.resize(this->sendSlots.size());
+		this->sendControls.resize(this->sendSlots.size() * kControlSize);
+
+		size_t messages = 0;
+
+		for (size_t index = first; index < this->queued; ++messages)
+		{
+			const auto& slot = this->sendSlots[index];
+			size_t slots     = 1;
+			size_t size      = slot.size;
+
+			// The last datagram of a GSO message may be shorter than the others.
+			while (this->server->gso && index + slots < this->queued && slots < kMaxGsoSegments)
+			{
+				const auto& next = this->sendSlots[index + slots];
+
+				if (
+				  next.size > slot.size || size + next.size > kMaxGsoSize ||
+				  !sameDestination(slot, next))
+				{
+					break;
+				}
+
+				size += next.size;
+				++slots;
+
+				if (next.size < slot.size)
+					break;
+			}
+
+			auto& header = this->headers[messages];
+
+			std::memset(&header, 0, sizeof(header));
+			header.msg_hdr.msg_name    = const_cast<sockaddr_storage*>(&slot.address);
+			header.msg_hdr.msg_namelen = slot.addressSize;
+			header.msg_hdr.msg_iov     = &this->iovecs[index];
+			header.msg_hdr.msg_iovlen  = slots;
+
+			for (size_t i = 0; i < slots; ++i)
+			{
+				auto& datagram = this->sendSlots[index + i];
+
+				this->iovecs[index + i].iov_base = datagram.data;
+				this->iovecs[index + i].iov_len  = datagram.size;
+			}
+
+			if (slots > 1)
+			{
+				auto* control = this->sendControls.data() + messages * kControlSize;
+
+				std::memset(control, 0, kControlSize);
+				header.msg_hdr.msg_control    = control;
+				header.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+
+				auto* cmsg       = CMSG_FIRSTHDR(&header.msg_hdr);
+				auto segmentSize = static_cast<uint16_t>(slot.size);
+
+				cmsg->cmsg_level = SOL_UDP;
+				cmsg->cmsg_type  = UDP_SEGMENT;
+				cmsg->cmsg_len   = CMSG_LEN(sizeof(segmentSize));
+				std::memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+			}
+
+			this->messageSlots[messages] = slots;
+			index += slots;
+		}
+
+		return messages;
+	}
+
+private:
+	BatchingSocketServer* server;
+	rtc::SocketDispatcher* dispatcher;
+	int fd;
+	// Whether UDP_GRO is enabled on the socket.
+	bool gro{ false };
+	// Whether in the pending sockets of the server.
+	bool pending{ false };
+	// Allocated on first use, batchSize of them.
+	std::vector<Slot> sendSlots;
+	size_t queued{ 0 };
+	std::vector<size_t> messageSlots;
+	std::vector<uint8_t> sendControls;
+	// Allocated on first use, batchSize messages (kGroMessages with GRO).
+	std::vector<uint8_t> receiveBuffer;
+	std::vector<sockaddr_storage> receiveAddresses;
+	std::vector<uint8_t> receiveControls;
+	std::vector<Segment> segments;
+	size_t delivered{ 0 };
+	int64_t receivedAtUs{ -1 };
+	std::vector<mmsghdr> headers;
+	std::vector<iovec> iovecs;
+};
+
+#endif
+
+BatchingSocketServer::BatchingSocketServer(const Options& options) : options(options)
+{
+#ifdef __linux__
+	if (this->options.segmentationOffload)
+	{
+		this->gso = kernelSupports(UDP_SEGMENT);
+		this->gro = kernelSupports(UDP_GRO);
+
+		BCST_INFO << "UDP segmentation offload [gso:" << (this->gso ? "on" : "unsupported")
+		          << ", gro:" << (this->gro ? "on" : "unsupported") << "]";
+	}
+#else
+	BCST_WARN << "UDP batching not supported on this platform, ignored";
+#endif
+}
+
+BatchingSocketServer::~BatchingSocketServer()
+{
+	this->Report();
+}
+
+rtc::AsyncSocket* BatchingSocketServer::CreateAsyncSocket(int family, int type)
+{
+	rtc::AsyncSocket* socket = rtc::PhysicalSocketServer::CreateAsyncSocket(family, type);
+
+#ifdef __linux__
+	if (socket && type == SOCK_DGRAM && this->options.batchSize > 1)
+	{
+		// PhysicalSocketServer creates its sockets as SocketDispatchers.
+		return new UdpSocket(this, static_cast<rtc::SocketDispatcher*>(socket));
+	}
+#endif
+
+	return socket;
+}
+
+bool BatchingSocketServer::Wait(int cms, bool processIo)
+{
+	this->Flush();
+
+	bool result = rtc::PhysicalSocketServer::Wait(cms, processIo);
+
+	// What was sent from the other socket events.
+	this->Flush();
+
+	if (
+	  this->options.reportIntervalSeconds &&
+	  rtc::TimeMillis() - this->reportedAtMs >= this->options.reportIntervalSeconds * 1000)
+	{
+		this->Report();
+	}
+
+	return result;
+}
+
+void BatchingSocketServer::Flush()
+{
+#ifdef __linux__
+	// Sockets leave the list as they are flushed.
+	while (!this->pendingSockets.empty())
+	{
+		UdpSocket* socket = this->pendingSockets.back();
+
+		this->pendingSockets.pop_back();
+		socket->Flush();
+	}
+#endif
+}
+
+void BatchingSocketServer::DisableGso(int error)
+{
+	this->gso = false;
+
+	BCST_WARN << "UDP GSO send failed, disabled [error:" << std::strerror(error) << "]";
+}
+
+void BatchingSocketServer::Report()
+{
+	Counters counters;
+
+	counters.sentPackets     = this->stats.sentPackets;
+	counters.sendCalls       = this->stats.sendCalls;
+	counters.receivedPackets = this->stats.receivedPackets;
+	counters.receiveCalls    = this->stats.receiveCalls;
+	counters.gsoSends        = this->stats.gsoSends;
+	counters.gsoSegments     = this->stats.gsoSegments;
+	counters.groReceives     = this->stats.groReceives;
+	counters.groSegments     = this->stats.groSegments;
+
+	this->reportedAtMs = rtc::TimeMillis();
+
+	if (
+	  counters.sendCalls == this->reported.sendCalls &&
+	  counters.receiveCalls == this->reported.receiveCalls)
+	{
+		return;
+	}
+
+	auto perCall = [](uint64_t packets, uint64_t calls) {
+		return calls ? static_cast<double>(packets) / calls : 0;
+	};
+
+	Counters delta;
+
+	delta.sentPackets     = counters.sentPackets - this->reported.sentPackets;
+	delta.sendCalls       = counters.sendCalls - this->reported.sendCalls;
+	delta.receivedPackets = counters.receivedPackets - this->reported.receivedPackets;
+	delta.receiveCalls    = counters.receiveCalls - this->reported.receiveCalls;
+	delta.gsoSends        = counters.gsoSends - this->reported.gsoSends;
+	delta.gsoSegments     = counters.gsoSegments - this->reported.gsoSegments;
+	delta.groReceives     = counters.groReceives - this->reported.groReceives;
+	delta.groSegments     = counters.groSegments - this->reported.groSegments;
+
+	BCST_INFO << "UDP batching [sentPackets:" << delta.sentPackets
+	          << ", sendCalls:" << delta.sendCalls << ", receivedPackets:" << delta.receivedPackets
+	          << ", receiveCalls:" << delta.receiveCalls
+	          << ", sendErrors:" << this->stats.sendErrors << ", packetsPerSendCall:" << std::fixed
+	          << std::setprecision(1) << perCall(delta.sentPackets, delta.sendCalls)
+	          << ", packetsPerReceiveCall:" << perCall(delta.receivedPackets, delta.receiveCalls)
+	          << ", gsoSends:" << delta.gsoSends << ", gsoSegments:" << delta.gsoSegments
+	          << ", groReceives:" << delta.groReceives << ", groSegments:" << delta.groSegments
+	          << "]";
+
+	this->reported = counters;
+}
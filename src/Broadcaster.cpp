@@ -1,18 +1,32 @@
 #include "Broadcaster.hpp"
+#include "AsyncLogger.hpp"
 #include "MediaStreamTrackFactory.hpp"
 #include "mediasoupclient.hpp"
 #include "json.hpp"
+#include "rtc_base/time_utils.h"
+#include <algorithm>
+#include <cctype>
 #include <chrono>
 #include <cpr/cpr.h>
 #include <cstdlib>
 #include <ctime>
 #include <functional>
-#include <iostream>
+#include <initializer_list>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
 
 using json = nlohmann::json;
 
+Broadcaster::Broadcaster()
+{
+	this->dataMessageDispatcher.RegisterHandler(
+	  "chat", [this](const rtc::CopyOnWriteBuffer& data, bool binary) {
+		  this->OnChatMessage(data, binary);
+	  });
+}
+
 Broadcaster::~Broadcaster()
 {
 	this->Stop();
@@ -20,12 +34,17 @@ Broadcaster::~Broadcaster()
 
 void Broadcaster::OnTransportClose(mediasoupclient::Producer* /*producer*/)
 {
-	std::cout << "[INFO] Broadcaster::OnTransportClose()" << std::endl;
+	BCST_INFO << "Broadcaster::OnTransportClose()";
+}
+
+void Broadcaster::OnTransportClose(mediasoupclient::Consumer* /*consumer*/)
+{
+	BCST_INFO << "Broadcaster::OnTransportClose()";
 }
 
 void Broadcaster::OnTransportClose(mediasoupclient::DataProducer* /*dataProducer*/)
 {
-	std::cout << "[INFO] Broadcaster::OnTransportClose()" << std::endl;
+	BCST_INFO << "Broadcaster::OnTransportClose()";
 }
 
 /* Transport::Listener::OnConnect
@@ -35,8 +54,8 @@ void Broadcaster::OnTransportClose(mediasoupclient::DataProducer* /*dataProducer
  */
 std::future<void> Broadcaster::OnConnect(mediasoupclient::Transport* transport, const json& dtlsParameters)
 {
-	std::cout << "[INFO] Broadcaster::OnConnect()" << std::endl;
-	// std::cout << "[INFO] dtlsParameters: " << dtlsParameters.dump(4) << std::endl;
+	BCST_INFO << "Broadcaster::OnConnect()";
+	// BCST_DEBUG << "dtlsParameters: " << dtlsParameters.dump(4);
 
 	if (transport->GetId() == this->sendTransport->GetId())
 	{
@@ -67,6 +86,10 @@ std::future<void> Broadcaster::OnConnectSendTransport(const json& dtlsParameters
 	};
 	/* clang-format on */
 
+	// Until the transport gets connected, see OnConnectionStateChange().
+	int64_t startUs          = rtc::TimeMicros();
+	this->sendConnectStartUs = startUs;
+
 	auto r = cpr::PostAsync(
 	           cpr::Url{ this->baseUrl + "/broadcasters/" + this->id + "/transports/" +
 	                     this->sendTransport->GetId() + "/connect" },
@@ -75,14 +98,16 @@ std::future<void> Broadcaster::OnConnectSendTransport(const json& dtlsParameters
 	           cpr::VerifySsl{ verifySsl })
 	           .get();
 
+	this->connectRequestUs += rtc::TimeMicros() - startUs;
+
 	if (r.status_code == 200)
 	{
 		promise.set_value();
 	}
 	else
 	{
-		std::cerr << "[ERROR] unable to connect transport"
-		          << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]" << std::endl;
+		BCST_ERROR << "unable to connect transport"
+		           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
 
 		promise.set_exception(std::make_exception_ptr(r.text));
 	}
@@ -101,6 +126,10 @@ std::future<void> Broadcaster::OnConnectRecvTransport(const json& dtlsParameters
 	};
 	/* clang-format on */
 
+	// Until the transport gets connected, see OnConnectionStateChange().
+	int64_t startUs          = rtc::TimeMicros();
+	this->recvConnectStartUs = startUs;
+
 	auto r = cpr::PostAsync(
 	           cpr::Url{ this->baseUrl + "/broadcasters/" + this->id + "/transports/" +
 	                     this->recvTransport->GetId() + "/connect" },
@@ -109,14 +138,16 @@ std::future<void> Broadcaster::OnConnectRecvTransport(const json& dtlsParameters
 	           cpr::VerifySsl{ verifySsl })
 	           .get();
 
+	this->connectRequestUs += rtc::TimeMicros() - startUs;
+
 	if (r.status_code == 200)
 	{
 		promise.set_value();
 	}
 	else
 	{
-		std::cerr << "[ERROR] unable to connect transport"
-		          << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]" << std::endl;
+		BCST_ERROR << "unable to connect transport"
+		           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
 
 		promise.set_exception(std::make_exception_ptr(r.text));
 	}
@@ -128,15 +159,38 @@ std::future<void> Broadcaster::OnConnectRecvTransport(const json& dtlsParameters
  * Transport::Listener::OnConnectionStateChange.
  */
 void Broadcaster::OnConnectionStateChange(
-  mediasoupclient::Transport* /*transport*/, const std::string& connectionState)
+  mediasoupclient::Transport* transport, const std::string& connectionState)
 {
-	std::cout << "[INFO] Broadcaster::OnConnectionStateChange() [connectionState:" << connectionState
-	          << "]" << std::endl;
+	BCST_INFO << "Broadcaster::OnConnectionStateChange() [connectionState:" << connectionState << "]";
 
-	if (connectionState == "failed")
+	if (connectionState == "connected" && this->joinTimer)
 	{
-		Stop();
-		std::exit(0);
+		bool send = false;
+		bool recv = false;
+
+		{
+			std::lock_guard<std::mutex> lock(this->transportIdsMutex);
+
+			send = transport->GetId() == this->sendTransportId;
+			recv = transport->GetId() == this->recvTransportId;
+		}
+
+		auto& connectStartUs = send ? this->sendConnectStartUs : this->recvConnectStartUs;
+		// Not if the transport was replaced meanwhile.
+		int64_t startUs = send || recv ? connectStartUs.exchange(0) : 0;
+
+		if (startUs != 0)
+		{
+			this->joinTimer->Record(
+			  send ? JoinTimer::kSendTransportConnect : JoinTimer::kRecvTransportConnect,
+			  rtc::TimeMicros() - startUs);
+		}
+	}
+
+	// Failures are recovered from in the background, see TransportRecovery.
+	if (this->recovery)
+	{
+		this->recovery->OnConnectionStateChange(transport->GetId(), connectionState);
 	}
 }
 
@@ -151,8 +205,8 @@ std::future<std::string> Broadcaster::OnProduce(
   json rtpParameters,
   const json& /*appData*/)
 {
-	std::cout << "[INFO] Broadcaster::OnProduce()" << std::endl;
-	// std::cout << "[INFO] rtpParameters: " << rtpParameters.dump(4) << std::endl;
+	BCST_INFO << "Broadcaster::OnProduce()";
+	// BCST_DEBUG << "rtpParameters: " << rtpParameters.dump(4);
 
 	std::promise<std::string> promise;
 
@@ -186,8 +240,8 @@ std::future<std::string> Broadcaster::OnProduce(
 	}
 	else
 	{
-		std::cerr << "[ERROR] unable to create producer"
-		          << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]" << std::endl;
+		BCST_ERROR << "unable to create producer"
+		           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
 
 		promise.set_exception(std::make_exception_ptr(r.text));
 	}
@@ -207,8 +261,8 @@ std::future<std::string> Broadcaster::OnProduceData(
   const std::string& protocol,
   const json& /*appData*/)
 {
-	std::cout << "[INFO] Broadcaster::OnProduceData()" << std::endl;
-	// std::cout << "[INFO] rtpParameters: " << rtpParameters.dump(4) << std::endl;
+	BCST_INFO << "Broadcaster::OnProduceData()";
+	// BCST_DEBUG << "rtpParameters: " << rtpParameters.dump(4);
 
 	std::promise<std::string> promise;
 
@@ -247,8 +301,8 @@ std::future<std::string> Broadcaster::OnProduceData(
 	}
 	else
 	{
-		std::cerr << "[ERROR] unable to create data producer"
-		          << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]" << std::endl;
+		BCST_ERROR << "unable to create data producer"
+		           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
 
 		promise.set_exception(std::make_exception_ptr(r.text));
 	}
@@ -256,22 +310,60 @@ std::future<std::string> Broadcaster::OnProduceData(
 	return promise.get_future();
 }
 
-void Broadcaster::Start(
+bool Broadcaster::Start(
   const std::string& baseUrl,
   bool enableAudio,
   bool useSimulcast,
   const json& routerRtpCapabilities,
   bool verifySsl)
 {
-	std::cout << "[INFO] Broadcaster::Start()" << std::endl;
+	BCST_INFO << "Broadcaster::Start()";
 
-	this->baseUrl   = baseUrl;
-	this->verifySsl = verifySsl;
+	this->baseUrl      = baseUrl;
+	this->verifySsl    = verifySsl;
+	this->enableAudio  = enableAudio;
+	this->useSimulcast = useSimulcast;
 
 	// Load the device.
 	this->device.Load(routerRtpCapabilities);
 
-	std::cout << "[INFO] creating Broadcaster..." << std::endl;
+	// Before the video track is created, to trace its first frames.
+	if (this->frameTracer)
+	{
+		this->frameTracer->Start();
+	}
+
+	if (this->recoveryOptions.maxIceRestarts > 0)
+	{
+		BCST_INFO << "transport failures are recovered by restarting ICE if the server implements "
+		             "POST .../transports/:transportId/restart-ice, which the stock mediasoup-demo "
+		             "does not, and by rejoining the room otherwise";
+	}
+
+	// Before joining, to get the state of the transports from the start.
+	this->recovery.reset(new TransportRecovery(
+	  this->recoveryOptions,
+	  [this](const std::string& transportId) { return this->RestartIce(transportId); },
+	  [this]() { return this->Rejoin(); }));
+
+	if (!this->Join())
+		return false;
+
+	this->recovery->Start();
+
+	if (this->controlServer && !this->controlServer->Start())
+	{
+		BCST_ERROR << "unable to start the control server";
+
+		return false;
+	}
+
+	return true;
+}
+
+bool Broadcaster::Join()
+{
+	BCST_INFO << "creating Broadcaster...";
 
 	/* clang-format off */
 	json body =
@@ -288,28 +380,427 @@ void Broadcaster::Start(
 	};
 	/* clang-format on */
 
+	cpr::Response r;
+
+	{
+		JoinTimer::Scope joinScope(this->joinTimer, JoinTimer::kBroadcasterCreate);
+
+		r = cpr::PostAsync(
+		      cpr::Url{ this->baseUrl + "/broadcasters" },
+		      cpr::Body{ body.dump() },
+		      cpr::Header{ { "Content-Type", "application/json" } },
+		      cpr::VerifySsl{ verifySsl })
+		      .get();
+	}
+
+	if (r.status_code != 200)
+	{
+		BCST_ERROR << "unable to create Broadcaster"
+		           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
+
+		return false;
+	}
+
+	this->joined = true;
+
+	auto response = json::parse(r.text, nullptr, false);
+
+	if (response.is_object() && response.count("peers") && response["peers"].is_array())
+		this->peers = response["peers"];
+	else
+		this->peers = json::array();
+
+	this->CreateSendTransport(this->enableAudio, this->useSimulcast);
+	this->CreateRecvTransport();
+
+	if (!this->sendTransport || !this->recvTransport)
+		return false;
+
+	if (this->consumerMonitor)
+	{
+		this->CreateConsumers();
+		this->consumerMonitor->Start(this->consumers);
+	}
+
+	if (this->statsCollector)
+		this->statsCollector->Start(this->sendTransport, &this->dataMessageDispatcher);
+
+	if (this->streamRecorder)
+	{
+		this->streamRecorder->Start();
+
+		if (this->audioProducer)
+			this->streamRecorder->Record(this->audioProducer);
+
+		if (this->videoProducer)
+			this->streamRecorder->Record(this->videoProducer);
+	}
+
+	return true;
+}
+
+bool Broadcaster::Rejoin()
+{
+	std::lock_guard<std::mutex> lock(this->mediaMutex);
+
+	this->Leave();
+
+	// The server still has the previous broadcaster if deleting it failed, which
+	// is likely after a network outage, and would refuse to create it again.
+	this->id = std::to_string(rtc::CreateRandomId());
+
+	BCST_INFO << "rejoining the room [id:" << this->id << "]";
+
+	// Stopped components can't be started again, create them anew.
+	if (this->dataBenchmark)
+		this->dataBenchmark.reset(new DataChannelBenchmark(this->dataBenchmark->GetOptions()));
+
+	if (this->latencyProbe)
+		this->latencyProbe.reset(new LatencyProbe(this->latencyProbe->GetOptions()));
+
+	if (this->fileTransfer)
+		this->fileTransfer.reset(new FileTransfer(this->fileTransfer->GetOptions()));
+
+	if (this->statsCollector)
+		this->statsCollector.reset(new StatsCollector(this->statsCollector->GetOptions()));
+
+	if (this->consumerMonitor)
+		this->consumerMonitor.reset(new ConsumerMonitor(this->consumerMonitor->GetOptions()));
+
+	if (this->streamRecorder)
+		this->streamRecorder.reset(new StreamRecorder(this->streamRecorder->GetOptions()));
+
+	return this->Join();
+}
+
+bool Broadcaster::RestartIce(const std::string& transportId)
+{
+	mediasoupclient::Transport* transport{ nullptr };
+
+	if (this->sendTransport && this->sendTransport->GetId() == transportId)
+		transport = this->sendTransport;
+	else if (this->recvTransport && this->recvTransport->GetId() == transportId)
+		transport = this->recvTransport;
+
+	if (!transport || !this->iceRestartSupported)
+		return false;
+
 	auto r = cpr::PostAsync(
-	           cpr::Url{ this->baseUrl + "/broadcasters" },
-	           cpr::Body{ body.dump() },
+	           cpr::Url{ this->baseUrl + "/broadcasters/" + this->id + "/transports/" + transportId +
+	                     "/restart-ice" },
+	           cpr::Body{ json::object().dump() },
 	           cpr::Header{ { "Content-Type", "application/json" } },
 	           cpr::VerifySsl{ verifySsl })
 	           .get();
 
+	// No such route, e.g. the stock mediasoup-demo: don't try again.
+	if (r.status_code == 404 || r.status_code == 405)
+	{
+		BCST_WARN << "the server can't restart ICE, recovering by rejoining the room from now on";
+
+		this->iceRestartSupported = false;
+
+		return false;
+	}
+
 	if (r.status_code != 200)
 	{
-		std::cerr << "[ERROR] unable to create Broadcaster"
-		          << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]" << std::endl;
+		BCST_ERROR << "unable to restart ICE"
+		           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
 
-		return;
+		return false;
 	}
 
-	this->CreateSendTransport(enableAudio, useSimulcast);
-	this->CreateRecvTransport();
+	auto response = json::parse(r.text, nullptr, false);
+
+	if (response.is_discarded() || response.find("iceParameters") == response.end())
+	{
+		BCST_ERROR << "'iceParameters' missing in response";
+
+		return false;
+	}
+
+	try
+	{
+		transport->RestartIce(response["iceParameters"]);
+	}
+	catch (const std::exception& error)
+	{
+		BCST_ERROR << "unable to restart ICE: " << error.what();
+
+		return false;
+	}
+
+	return true;
+}
+
+void Broadcaster::SetDataSenderOptions(const DataSender::Options& options)
+{
+	this->dataSenderOptions = options;
+}
+
+void Broadcaster::SetRecoveryOptions(const TransportRecovery::Options& options)
+{
+	this->recoveryOptions = options;
+}
+
+void Broadcaster::SetLeaveTimeout(uint32_t timeoutMs)
+{
+	this->leaveTimeoutMs = timeoutMs;
+}
+
+void Broadcaster::SetVideoCodec(const std::string& name)
+{
+	this->videoCodec = name;
+
+	std::transform(
+	  this->videoCodec.begin(), this->videoCodec.end(), this->videoCodec.begin(), [](char c) {
+		  return static_cast<char>(std::toupper(c));
+	  });
+}
+
+void Broadcaster::EnableDataBenchmark(const DataChannelBenchmark::Options& options)
+{
+	this->dataBenchmark.reset(new DataChannelBenchmark(options));
+
+	this->dataMessageDispatcher.RegisterHandler(
+	  "benchmark", [this](const rtc::CopyOnWriteBuffer& data, bool /*binary*/) {
+		  this->dataBenchmark->OnMessage(data);
+	  });
+}
+
+void Broadcaster::EnableLatencyProbe(const LatencyProbe::Options& options)
+{
+	this->latencyProbe.reset(new LatencyProbe(options));
+
+	this->dataMessageDispatcher.RegisterHandler(
+	  "probe", [this](const rtc::CopyOnWriteBuffer& data, bool /*binary*/) {
+		  this->latencyProbe->OnMessage(data);
+	  });
+}
+
+void Broadcaster::EnableFileTransfer(const FileTransfer::Options& options)
+{
+	this->fileTransfer.reset(new FileTransfer(options));
+
+	this->dataMessageDispatcher.RegisterHandler(
+	  "file", [this](const rtc::CopyOnWriteBuffer& data, bool /*binary*/) {
+		  this->fileTransfer->OnMessage(data);
+	  });
+}
+
+void Broadcaster::EnableStats(const StatsCollector::Options& options)
+{
+	this->statsCollector.reset(new StatsCollector(options));
+}
+
+void Broadcaster::EnableFrameTrace(const FrameTracer::Options& options)
+{
+	this->frameTracer.reset(new FrameTracer(options));
+}
+
+void Broadcaster::EnableTimestampOverlay()
+{
+	this->timestampOverlay = true;
+}
+
+void Broadcaster::EnableConsumers(const ConsumerMonitor::Options& options)
+{
+	this->consumerMonitor.reset(new ConsumerMonitor(options));
+}
+
+void Broadcaster::EnableControl(const ControlServer::Options& options)
+{
+	this->controlServer.reset(new ControlServer(
+	  options, [this](const json& request) { return this->HandleControl(request); }));
+}
+
+void Broadcaster::EnableRecording(const StreamRecorder::Options& options)
+{
+	this->streamRecorder.reset(new StreamRecorder(options));
+}
+
+void Broadcaster::SetJoinTimer(JoinTimer* joinTimer)
+{
+	this->joinTimer = joinTimer;
+}
+
+int64_t Broadcaster::TakeConnectRequestUs()
+{
+	int64_t connectRequestUs = this->connectRequestUs;
+
+	this->connectRequestUs = 0;
+
+	return connectRequestUs;
+}
+
+bool Broadcaster::WaitForMedia(std::chrono::milliseconds timeout)
+{
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	bool rtpSent  = false;
+
+	while (true)
+	{
+		// Polled, as nothing notifies the first packet sent.
+		if (!rtpSent && this->sendTransport)
+		{
+			StatsCollector::Snapshot snapshot;
+
+			StatsCollector::ParseStats(this->sendTransport->GetStats(), snapshot);
+
+			for (const auto& stream : snapshot.outboundRtp)
+			{
+				if (stream.packetsSent > 0)
+				{
+					rtpSent = true;
+
+					if (this->joinTimer)
+						this->joinTimer->RecordSinceBegin(JoinTimer::kFirstRtp);
+
+					break;
+				}
+			}
+		}
+
+		if (rtpSent && this->sctpOpen)
+			return true;
+
+		if (std::chrono::steady_clock::now() >= deadline)
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	if (this->joinTimer)
+	{
+		if (!rtpSent)
+			this->joinTimer->RecordMissed(JoinTimer::kFirstRtp);
+
+		if (!this->sctpOpen)
+			this->joinTimer->RecordMissed(JoinTimer::kFirstSctp);
+	}
+
+	return false;
 }
 
-void Broadcaster::CreateDataConsumer()
+void Broadcaster::CreateConsumers()
 {
-	const std::string& dataProducerId = this->dataProducer->GetId();
+	const auto& options = this->consumerMonitor->GetOptions();
+	uint32_t producers  = 0;
+
+	// Our own Producers, as the DataProducers are. The stock mediasoup-demo only
+	// lists browser peers, which stamp neither frames nor audio.
+	if (options.loopback)
+	{
+		for (auto* producer : { this->audioProducer, this->videoProducer })
+		{
+			if (!producer)
+				continue;
+
+			for (uint32_t copy = 0; copy < options.copies; ++copy)
+			{
+				auto* consumer = this->CreateConsumer(producer->GetId(), this->id);
+
+				if (consumer)
+					this->consumers.push_back(consumer);
+			}
+		}
+	}
+
+	for (const auto& peer : this->peers)
+	{
+		if (!peer.count("producers") || !peer["producers"].is_array())
+			continue;
+
+		auto peerId = peer.value("id", std::string());
+
+		for (const auto& producer : peer["producers"])
+		{
+			if (options.maxProducers > 0 && producers == options.maxProducers)
+				return;
+
+			auto producerId = producer.value("id", std::string());
+
+			if (producerId.empty())
+				continue;
+
+			++producers;
+
+			for (uint32_t copy = 0; copy < options.copies; ++copy)
+			{
+				auto* consumer = this->CreateConsumer(producerId, peerId);
+
+				if (consumer)
+					this->consumers.push_back(consumer);
+			}
+		}
+	}
+
+	if (producers == 0 && !options.loopback)
+		BCST_WARN << "no Producers to consume in the room";
+}
+
+mediasoupclient::Consumer* Broadcaster::CreateConsumer(
+  const std::string& producerId, const std::string& peerId)
+{
+	// Created unpaused, so that media flows as soon as the client one exists.
+	auto r = cpr::PostAsync(
+	           cpr::Url{ this->baseUrl + "/broadcasters/" + this->id + "/transports/" +
+	                     this->recvTransport->GetId() + "/consume" },
+	           cpr::Parameters{ { "producerId", producerId } },
+	           cpr::Body{ json::object().dump() },
+	           cpr::Header{ { "Content-Type", "application/json" } },
+	           cpr::VerifySsl{ verifySsl })
+	           .get();
+
+	if (r.status_code != 200)
+	{
+		BCST_ERROR << "server unable to consume Producer [producerId:" << producerId
+		           << ", status code:" << r.status_code << ", body:\"" << r.text << "\"]";
+
+		return nullptr;
+	}
+
+	auto response = json::parse(r.text, nullptr, false);
+
+	if (
+	  response.is_discarded() || !response.count("id") || !response.count("kind") ||
+	  !response.count("rtpParameters"))
+	{
+		BCST_ERROR << "'id', 'kind' or 'rtpParameters' missing in response";
+
+		return nullptr;
+	}
+
+	try
+	{
+		return this->recvTransport->Consume(
+		  this,
+		  response["id"].get<std::string>(),
+		  producerId,
+		  response["kind"].get<std::string>(),
+		  &response["rtpParameters"],
+		  { { "peerId", peerId } });
+	}
+	catch (const std::exception& error)
+	{
+		BCST_ERROR << "unable to consume Producer [producerId:" << producerId
+		           << "]: " << error.what();
+
+		return nullptr;
+	}
+}
+
+mediasoupclient::DataConsumer* Broadcaster::CreateDataConsumer(
+  mediasoupclient::DataProducer* dataProducer, const std::string& label)
+{
+	if (!dataProducer)
+		return nullptr;
+
+	// Both the server consumer and the client one.
+	JoinTimer::Scope joinScope(this->joinTimer, JoinTimer::kDataConsume);
+
+	const std::string& dataProducerId = dataProducer->GetId();
 
 	/* clang-format off */
 	json body =
@@ -327,34 +818,44 @@ void Broadcaster::CreateDataConsumer()
 	           .get();
 	if (r.status_code != 200)
 	{
-		std::cerr << "[ERROR] server unable to consume mediasoup recv WebRtcTransport"
-		          << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]" << std::endl;
-		return;
+		BCST_ERROR << "server unable to consume mediasoup recv WebRtcTransport"
+		           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
+		return nullptr;
 	}
 
 	auto response = json::parse(r.text);
 	if (response.find("id") == response.end())
 	{
-		std::cerr << "[ERROR] 'id' missing in response" << std::endl;
-		return;
+		BCST_ERROR << "'id' missing in response";
+		return nullptr;
 	}
 	auto dataConsumerId = response["id"].get<std::string>();
 
 	if (response.find("streamId") == response.end())
 	{
-		std::cerr << "[ERROR] 'streamId' missing in response" << std::endl;
-		return;
+		BCST_ERROR << "'streamId' missing in response";
+		return nullptr;
 	}
 	auto streamId = response["streamId"].get<uint16_t>();
 
 	// Create client consumer.
-	this->dataConsumer = this->recvTransport->ConsumeData(
-	  this, dataConsumerId, dataProducerId, streamId, "chat", "", nlohmann::json());
+	auto* dataConsumer = this->recvTransport->ConsumeData(
+	  this->dataMessageDispatcher.AddDataConsumer(label),
+	  dataConsumerId,
+	  dataProducerId,
+	  streamId,
+	  label,
+	  "",
+	  nlohmann::json());
+
+	joinScope.Exclude(this->TakeConnectRequestUs());
+
+	return dataConsumer;
 }
 
 void Broadcaster::CreateSendTransport(bool enableAudio, bool useSimulcast)
 {
-	std::cout << "[INFO] creating mediasoup send WebRtcTransport..." << std::endl;
+	BCST_INFO << "creating mediasoup send WebRtcTransport...";
 
 	json sctpCapabilities = this->device.GetSctpCapabilities();
 	/* clang-format off */
@@ -366,17 +867,23 @@ void Broadcaster::CreateSendTransport(bool enableAudio, bool useSimulcast)
 	};
 	/* clang-format on */
 
-	auto r = cpr::PostAsync(
-	           cpr::Url{ this->baseUrl + "/broadcasters/" + this->id + "/transports" },
-	           cpr::Body{ body.dump() },
-	           cpr::Header{ { "Content-Type", "application/json" } },
-	           cpr::VerifySsl{ verifySsl })
-	           .get();
+	cpr::Response r;
+
+	{
+		JoinTimer::Scope joinScope(this->joinTimer, JoinTimer::kSendTransportCreate);
+
+		r = cpr::PostAsync(
+		      cpr::Url{ this->baseUrl + "/broadcasters/" + this->id + "/transports" },
+		      cpr::Body{ body.dump() },
+		      cpr::Header{ { "Content-Type", "application/json" } },
+		      cpr::VerifySsl{ verifySsl })
+		      .get();
+	}
 
 	if (r.status_code != 200)
 	{
-		std::cerr << "[ERROR] unable to create send mediasoup WebRtcTransport"
-		          << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]" << std::endl;
+		BCST_ERROR << "unable to create send mediasoup WebRtcTransport"
+		           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
 
 		return;
 	}
@@ -385,46 +892,63 @@ void Broadcaster::CreateSendTransport(bool enableAudio, bool useSimulcast)
 
 	if (response.find("id") == response.end())
 	{
-		std::cerr << "[ERROR] 'id' missing in response" << std::endl;
+		BCST_ERROR << "'id' missing in response";
 
 		return;
 	}
 	else if (response.find("iceParameters") == response.end())
 	{
-		std::cerr << "[ERROR] 'iceParametersd' missing in response" << std::endl;
+		BCST_ERROR << "'iceParametersd' missing in response";
 
 		return;
 	}
 	else if (response.find("iceCandidates") == response.end())
 	{
-		std::cerr << "[ERROR] 'iceCandidates' missing in response" << std::endl;
+		BCST_ERROR << "'iceCandidates' missing in response";
 
 		return;
 	}
 	else if (response.find("dtlsParameters") == response.end())
 	{
-		std::cerr << "[ERROR] 'dtlsParameters' missing in response" << std::endl;
+		BCST_ERROR << "'dtlsParameters' missing in response";
 
 		return;
 	}
 	else if (response.find("sctpParameters") == response.end())
 	{
-		std::cerr << "[ERROR] 'sctpParameters' missing in response" << std::endl;
+		BCST_ERROR << "'sctpParameters' missing in response";
 
 		return;
 	}
 
-	std::cout << "[INFO] creating SendTransport..." << std::endl;
+	BCST_INFO << "creating SendTransport...";
 
 	auto sendTransportId = response["id"].get<std::string>();
 
+	auto maxMessageSize = response["sctpParameters"].find("maxMessageSize");
+	if (maxMessageSize != response["sctpParameters"].end() && maxMessageSize->is_number_unsigned())
+	{
+		this->sctpMaxMessageSize = maxMessageSize->get<size_t>();
+	}
+
+	// Use the factory of the tracks so that our encoders are used.
+	mediasoupclient::PeerConnection::Options peerConnectionOptions;
+	peerConnectionOptions.factory = getPeerConnectionFactory();
+
 	this->sendTransport = this->device.CreateSendTransport(
 	  this,
 	  sendTransportId,
 	  response["iceParameters"],
 	  response["iceCandidates"],
 	  response["dtlsParameters"],
-	  response["sctpParameters"]);
+	  response["sctpParameters"],
+	  &peerConnectionOptions);
+
+	{
+		std::lock_guard<std::mutex> lock(this->transportIdsMutex);
+
+		this->sendTransportId = sendTransportId;
+	}
 
 	///////////////////////// Create Audio Producer //////////////////////////
 
@@ -439,18 +963,36 @@ void Broadcaster::CreateSendTransport(bool enableAudio, bool useSimulcast)
 		};
 		/* clang-format on */
 
-		this->sendTransport->Produce(this, audioTrack, nullptr, &codecOptions);
+		JoinTimer::Scope joinScope(this->joinTimer, JoinTimer::kAudioProduce);
+
+		this->audioProducer = this->sendTransport->Produce(this, audioTrack, nullptr, &codecOptions);
+
+		joinScope.Exclude(this->TakeConnectRequestUs());
 	}
 	else
 	{
-		std::cerr << "[WARN] cannot produce audio" << std::endl;
+		BCST_WARN << "cannot produce audio";
 	}
 
 	///////////////////////// Create Video Producer //////////////////////////
 
 	if (this->device.CanProduce("video"))
 	{
-		auto videoTrack = createSquaresVideoTrack(std::to_string(rtc::CreateRandomId()));
+		auto videoTrack = createSquaresVideoTrack(
+		  std::to_string(rtc::CreateRandomId()), &this->videoCapturer, this->timestampOverlay);
+
+		json codec         = this->FindVideoCodec();
+		const json* pCodec = codec.is_null() ? nullptr : &codec;
+
+		// libwebrtc only does simulcast with VP8 and H264.
+		if (useSimulcast && (this->videoCodec == "VP9" || this->videoCodec == "AV1"))
+		{
+			BCST_WARN << "simulcast not supported with " << this->videoCodec << ", disabled";
+
+			useSimulcast = false;
+		}
+
+		JoinTimer::Scope joinScope(this->joinTimer, JoinTimer::kVideoProduce);
 
 		if (useSimulcast)
 		{
@@ -459,44 +1001,89 @@ void Broadcaster::CreateSendTransport(bool enableAudio, bool useSimulcast)
 			encodings.emplace_back(webrtc::RtpEncodingParameters());
 			encodings.emplace_back(webrtc::RtpEncodingParameters());
 
-			this->sendTransport->Produce(this, videoTrack, &encodings, nullptr);
+			this->videoProducer =
+			  this->sendTransport->Produce(this, videoTrack, &encodings, nullptr, pCodec);
 		}
 		else
 		{
-			this->sendTransport->Produce(this, videoTrack, nullptr, nullptr);
+			this->videoProducer =
+			  this->sendTransport->Produce(this, videoTrack, nullptr, nullptr, pCodec);
 		}
+
+		joinScope.Exclude(this->TakeConnectRequestUs());
 	}
 	else
 	{
-		std::cerr << "[WARN] cannot produce video" << std::endl;
+		BCST_WARN << "cannot produce video";
 
 		return;
 	}
 
 	///////////////////////// Create Data Producer //////////////////////////
 
-	this->dataProducer = sendTransport->ProduceData(this);
+	{
+		JoinTimer::Scope joinScope(this->joinTimer, JoinTimer::kDataProduce);
+
+		this->dataProducer = sendTransport->ProduceData(this);
+	}
+
+	if (this->dataBenchmark)
+	{
+		JoinTimer::Scope joinScope(this->joinTimer, JoinTimer::kDataProduce);
+
+		this->benchmarkDataProducer = sendTransport->ProduceData(this, "benchmark");
+		this->dataBenchmark->Start(this->benchmarkDataProducer, this->sctpMaxMessageSize);
+	}
+
+	if (this->latencyProbe)
+	{
+		JoinTimer::Scope joinScope(this->joinTimer, JoinTimer::kDataProduce);
+
+		// Unordered and partially reliable so that loss and reordering are visible.
+		this->probeDataProducer = sendTransport->ProduceData(
+		  this,
+		  "probe",
+		  "",
+		  false /*ordered*/,
+		  0 /*maxRetransmits*/,
+		  static_cast<int>(this->latencyProbe->GetOptions().timeoutMs) /*maxPacketLifeTime*/);
+		this->latencyProbe->Start(this->probeDataProducer);
+	}
+
+	if (this->fileTransfer)
+	{
+		JoinTimer::Scope joinScope(this->joinTimer, JoinTimer::kDataProduce);
+
+		this->fileDataProducer = sendTransport->ProduceData(this, "file");
+		this->fileTransfer->Start(this->fileDataProducer, this->sctpMaxMessageSize);
+	}
+
+	DataSender::Options chatSenderOptions = this->dataSenderOptions;
+
+	if (chatSenderOptions.maxBatchSize > this->sctpMaxMessageSize)
+		chatSenderOptions.maxBatchSize = this->sctpMaxMessageSize;
+
+	this->chatSender.reset(new DataSender(chatSenderOptions));
+	this->chatSender->Start(this->dataProducer);
 
 	uint32_t intervalSeconds = 10;
-	std::thread([this, intervalSeconds]() {
+	this->sendDataThread     = std::thread([this, intervalSeconds]() {
 		bool run = true;
 		while (run)
 		{
 			std::chrono::system_clock::time_point p = std::chrono::system_clock::now();
 			std::time_t t                           = std::chrono::system_clock::to_time_t(p);
 			std::string s                           = std::ctime(&t);
-			auto dataBuffer                         = webrtc::DataBuffer(s);
-			std::cout << "[INFO] sending chat data: " << s << std::endl;
-			this->dataProducer->Send(dataBuffer);
+			BCST_INFO << "sending chat data: " << s;
+			this->chatSender->Push(rtc::CopyOnWriteBuffer(s.data(), s.size()), false /*binary*/);
 			run = timerKiller.WaitFor(std::chrono::seconds(intervalSeconds));
 		}
-	})
-	  .detach();
+	});
 }
 
 void Broadcaster::CreateRecvTransport()
 {
-	std::cout << "[INFO] creating mediasoup recv WebRtcTransport..." << std::endl;
+	BCST_INFO << "creating mediasoup recv WebRtcTransport...";
 
 	json sctpCapabilities = this->device.GetSctpCapabilities();
 	/* clang-format off */
@@ -508,18 +1095,24 @@ void Broadcaster::CreateRecvTransport()
 	};
 	/* clang-format on */
 
+	cpr::Response r;
+
 	// create server transport
-	auto r = cpr::PostAsync(
-	           cpr::Url{ this->baseUrl + "/broadcasters/" + this->id + "/transports" },
-	           cpr::Body{ body.dump() },
-	           cpr::Header{ { "Content-Type", "application/json" } },
-	           cpr::VerifySsl{ verifySsl })
-	           .get();
+	{
+		JoinTimer::Scope joinScope(this->joinTimer, JoinTimer::kRecvTransportCreate);
+
+		r = cpr::PostAsync(
+		      cpr::Url{ this->baseUrl + "/broadcasters/" + this->id + "/transports" },
+		      cpr::Body{ body.dump() },
+		      cpr::Header{ { "Content-Type", "application/json" } },
+		      cpr::VerifySsl{ verifySsl })
+		      .get();
+	}
 
 	if (r.status_code != 200)
 	{
-		std::cerr << "[ERROR] unable to create mediasoup recv WebRtcTransport"
-		          << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]" << std::endl;
+		BCST_ERROR << "unable to create mediasoup recv WebRtcTransport"
+		           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
 
 		return;
 	}
@@ -528,92 +1121,500 @@ void Broadcaster::CreateRecvTransport()
 
 	if (response.find("id") == response.end())
 	{
-		std::cerr << "[ERROR] 'id' missing in response" << std::endl;
+		BCST_ERROR << "'id' missing in response";
 
 		return;
 	}
 	else if (response.find("iceParameters") == response.end())
 	{
-		std::cerr << "[ERROR] 'iceParameters' missing in response" << std::endl;
+		BCST_ERROR << "'iceParameters' missing in response";
 
 		return;
 	}
 	else if (response.find("iceCandidates") == response.end())
 	{
-		std::cerr << "[ERROR] 'iceCandidates' missing in response" << std::endl;
+		BCST_ERROR << "'iceCandidates' missing in response";
 
 		return;
 	}
 	else if (response.find("dtlsParameters") == response.end())
 	{
-		std::cerr << "[ERROR] 'dtlsParameters' missing in response" << std::endl;
+		BCST_ERROR << "'dtlsParameters' missing in response";
 
 		return;
 	}
 	else if (response.find("sctpParameters") == response.end())
 	{
-		std::cerr << "[ERROR] 'sctpParameters' missing in response" << std::endl;
+		BCST_ERROR << "'sctpParameters' missing in response";
 
 		return;
 	}
 
 	auto recvTransportId = response["id"].get<std::string>();
 
-	std::cout << "[INFO] creating RecvTransport..." << std::endl;
+	BCST_INFO << "creating RecvTransport...";
 
 	auto sctpParameters = response["sctpParameters"];
 
+	mediasoupclient::PeerConnection::Options peerConnectionOptions;
+	peerConnectionOptions.factory = getPeerConnectionFactory();
+
 	this->recvTransport = this->device.CreateRecvTransport(
 	  this,
 	  recvTransportId,
 	  response["iceParameters"],
 	  response["iceCandidates"],
 	  response["dtlsParameters"],
-	  sctpParameters);
+	  sctpParameters,
+	  &peerConnectionOptions);
+
+	{
+		std::lock_guard<std::mutex> lock(this->transportIdsMutex);
+
+		this->recvTransportId = recvTransportId;
+	}
+
+	this->dataConsumer = this->CreateDataConsumer(this->dataProducer, "chat");
 
-	this->CreateDataConsumer();
+	if (this->benchmarkDataProducer)
+	{
+		this->benchmarkDataConsumer =
+		  this->CreateDataConsumer(this->benchmarkDataProducer, "benchmark");
+	}
+
+	if (this->probeDataProducer)
+	{
+		this->probeDataConsumer = this->CreateDataConsumer(this->probeDataProducer, "probe");
+	}
+
+	if (this->fileDataProducer)
+	{
+		this->fileDataConsumer = this->CreateDataConsumer(this->fileDataProducer, "file");
+	}
 }
 
-void Broadcaster::OnMessage(mediasoupclient::DataConsumer* dataConsumer, const webrtc::DataBuffer& buffer)
+void Broadcaster::OnChatMessage(const rtc::CopyOnWriteBuffer& data, bool binary)
 {
-	std::cout << "[INFO] Broadcaster::OnMessage()" << std::endl;
-	if (dataConsumer->GetLabel() == "chat")
+	auto print = [](const uint8_t* message, size_t size) {
+		BCST_INFO << "received chat data: "
+		          << std::string(reinterpret_cast<const char*>(message), size);
+	};
+
+	// Coalesced batches are always binary.
+	if (binary && this->dataSenderOptions.coalesce)
 	{
-		std::string s = std::string(buffer.data.data<char>(), buffer.data.size());
-		std::cout << "[INFO] received chat data: " + s << std::endl;
+		if (!DataSender::Unbatch(data, print))
+			BCST_ERROR << "malformed chat data batch";
+
+		return;
 	}
+
+	if (binary)
+	{
+		BCST_INFO << "received chat data [binary, size:" << data.size() << "]";
+
+		return;
+	}
+
+	print(data.cdata(), data.size());
+}
+
+json Broadcaster::FindVideoCodec()
+{
+	if (this->videoCodec.empty())
+		return nullptr;
+
+	auto mimeType = "video/" + this->videoCodec;
+	json found;
+
+	for (const auto& codec : this->device.GetRtpCapabilities()["codecs"])
+	{
+		auto codecMimeType = codec.value("mimeType", std::string());
+
+		if (
+		  codecMimeType.size() != mimeType.size() ||
+		  !std::equal(mimeType.begin(), mimeType.end(), codecMimeType.begin(), [](char a, char b) {
+			  return std::tolower(a) == std::tolower(b);
+		  }))
+		{
+			continue;
+		}
+
+		// Prefer the H264 packetization mode allowing several NAL units per packet.
+		if (codec.count("parameters") && codec["parameters"].value("packetization-mode", 0) == 1)
+			return codec;
+
+		if (found.is_null())
+			found = codec;
+	}
+
+	if (found.is_null())
+		BCST_ERROR << "video codec " << this->videoCodec << " not supported, using the default one";
+
+	return found;
+}
+
+json Broadcaster::HandleControl(const json& request)
+{
+	auto method = request.value("method", std::string());
+
+	BCST_INFO << "Broadcaster::HandleControl() [method:" << method << "]";
+
+	std::lock_guard<std::mutex> lock(this->mediaMutex);
+
+	if (method == "getEncodings" || method == "setEncodings")
+	{
+		auto kind     = request.value("kind", std::string("video"));
+		auto producer = kind == "audio" ? this->audioProducer : this->videoProducer;
+
+		if (!producer)
+			throw std::invalid_argument("no " + kind + " producer");
+
+		if (method == "setEncodings")
+		{
+			if (!request.count("encodings") || !request["encodings"].is_array())
+				throw std::invalid_argument("'encodings' must be an array");
+
+			this->SetEncodings(producer, request["encodings"]);
+		}
+
+		return { { "ok", true }, { "encodings", this->GetEncodings(producer) } };
+	}
+	// Shorthands of setEncodings for a single simulcast layer.
+	else if (method == "pauseLayer" || method == "resumeLayer")
+	{
+		if (!this->videoProducer)
+			throw std::invalid_argument("no video producer");
+
+		json encoding = { { "active", method == "resumeLayer" } };
+
+		if (request.count("rid"))
+			encoding["rid"] = request["rid"];
+		else if (request.count("index"))
+			encoding["index"] = request["index"];
+		else
+			throw std::invalid_argument("'rid' or 'index' required");
+
+		this->SetEncodings(this->videoProducer, json::array({ encoding }));
+
+		return { { "ok", true }, { "encodings", this->GetEncodings(this->videoProducer) } };
+	}
+	else if (method == "setResolution")
+	{
+		if (!this->videoCapturer)
+			throw std::invalid_argument("no video capturer");
+
+		auto width  = request.at("width").get<size_t>();
+		auto height = request.at("height").get<size_t>();
+
+		if (width == 0 || height == 0 || width > 4096 || height > 4096)
+			throw std::invalid_argument("resolution out of range");
+
+		// Applies to the next generated frame, the encoder reconfigures itself.
+		this->videoCapturer->ChangeResolution(width, height);
+
+		return { { "ok", true } };
+	}
+	else if (method == "setFramerate")
+	{
+		if (!this->videoCapturer)
+			throw std::invalid_argument("no video capturer");
+
+		auto framerate = request.at("framerate").get<int>();
+
+		if (framerate <= 0 || framerate > 120)
+			throw std::invalid_argument("framerate out of range");
+
+		this->videoCapturer->ChangeFramerate(framerate);
+
+		return { { "ok", true } };
+	}
+
+	throw std::invalid_argument("unknown method '" + method + "'");
+}
+
+json Broadcaster::GetEncodings(mediasoupclient::Producer* producer)
+{
+	auto parameters = producer->GetRtpSender()->GetParameters();
+	json encodings  = json::array();
+
+	for (const auto& encoding : parameters.encodings)
+	{
+		json entry = { { "rid", encoding.rid }, { "active", encoding.active } };
+
+		if (encoding.max_bitrate_bps)
+			entry["maxBitrate"] = *encoding.max_bitrate_bps;
+
+		if (encoding.max_framerate)
+			entry["maxFramerate"] = *encoding.max_framerate;
+
+		if (encoding.scale_resolution_down_by)
+			entry["scaleResolutionDownBy"] = *encoding.scale_resolution_down_by;
+
+		encodings.push_back(entry);
+	}
+
+	return encodings;
+}
+
+void Broadcaster::SetEncodings(mediasoupclient::Producer* producer, const json& encodings)
+{
+	auto* rtpSender = producer->GetRtpSender();
+	auto parameters = rtpSender->GetParameters();
+
+	// Validated as a whole before anything is applied.
+	for (const auto& entry : encodings)
+	{
+		size_t index = parameters.encodings.size();
+
+		if (entry.count("rid"))
+		{
+			auto rid = entry["rid"].get<std::string>();
+
+			for (size_t i = 0; i < parameters.encodings.size(); ++i)
+			{
+				if (parameters.encodings[i].rid == rid)
+					index = i;
+			}
+		}
+		else if (entry.count("index"))
+		{
+			index = entry["index"].get<size_t>();
+		}
+		else if (parameters.encodings.size() == 1)
+		{
+			index = 0;
+		}
+
+		if (index >= parameters.encodings.size())
+			throw std::invalid_argument("no such encoding: " + entry.dump());
+
+		auto& encoding = parameters.encodings[index];
+
+		if (entry.count("active"))
+			encoding.active = entry["active"].get<bool>();
+
+		// null removes the limit.
+		if (entry.count("maxBitrate") && entry["maxBitrate"].is_null())
+			encoding.max_bitrate_bps.reset();
+		else if (entry.count("maxBitrate"))
+			encoding.max_bitrate_bps = entry["maxBitrate"].get<int>();
+
+		if (entry.count("maxFramerate") && entry["maxFramerate"].is_null())
+			encoding.max_framerate.reset();
+		else if (entry.count("maxFramerate"))
+			encoding.max_framerate = entry["maxFramerate"].get<double>();
+
+		if (entry.count("scaleResolutionDownBy"))
+		{
+			auto scale = entry["scaleResolutionDownBy"].get<double>();
+
+			if (scale < 1.0)
+				throw std::invalid_argument("'scaleResolutionDownBy' must be at least 1");
+
+			encoding.scale_resolution_down_by = scale;
+		}
+	}
+
+	// Applied without renegotiation, the encoder picks it up on the next frame.
+	auto error = rtpSender->SetParameters(parameters);
+
+	if (!error.ok())
+		throw std::runtime_error(std::string("SetParameters() failed: ") + error.message());
 }
 
 void Broadcaster::Stop()
 {
-	std::cout << "[INFO] Broadcaster::Stop()" << std::endl;
+	BCST_INFO << "Broadcaster::Stop()";
+
+	// First, so that it doesn't recreate what is being torn down.
+	if (this->recovery)
+	{
+		this->recovery->Stop();
+	}
+
+	if (this->controlServer)
+	{
+		this->controlServer->Stop();
+	}
 
+	this->Leave();
+
+	if (this->frameTracer)
+	{
+		this->frameTracer->Stop();
+	}
+}
+
+void Broadcaster::Leave()
+{
 	this->timerKiller.Kill();
 
-	if (this->recvTransport)
+	// Stats can't be polled once the transports are closed.
+	if (this->statsCollector)
+	{
+		this->statsCollector->Stop();
+	}
+
+	if (this->sendDataThread.joinable())
+	{
+		this->sendDataThread.join();
+	}
+
+	this->timerKiller.Reset();
+
+	// Independent of each other, each one joining its own thread, so stopped in
+	// parallel. They may still send what they have queued.
+	std::vector<std::future<void>> stops;
+
+	if (this->chatSender)
+		stops.push_back(std::async(std::launch::async, [this]() { this->chatSender->Stop(); }));
+
+	if (this->dataBenchmark)
+		stops.push_back(std::async(std::launch::async, [this]() { this->dataBenchmark->Stop(); }));
+
+	if (this->latencyProbe)
+		stops.push_back(std::async(std::launch::async, [this]() { this->latencyProbe->Stop(); }));
+
+	if (this->fileTransfer)
+		stops.push_back(std::async(std::launch::async, [this]() { this->fileTransfer->Stop(); }));
+
+	// Detaches its sinks from the tracks, which go away with the Consumers.
+	if (this->consumerMonitor)
+		stops.push_back(std::async(std::launch::async, [this]() { this->consumerMonitor->Stop(); }));
+
+	// Writes what it has queued, the transports still pass the frames on.
+	if (this->streamRecorder)
+		stops.push_back(std::async(std::launch::async, [this]() { this->streamRecorder->Stop(); }));
+
+	for (auto& stop : stops)
+	{
+		stop.get();
+	}
+
+	// Let the server close the broadcaster while the local side is closed.
+	cpr::AsyncResponse deleted;
+
+	if (this->joined)
 	{
-		recvTransport->Close();
+		deleted = cpr::DeleteAsync(
+		  cpr::Url{ this->baseUrl + "/broadcasters/" + this->id },
+		  cpr::VerifySsl{ verifySsl },
+		  cpr::Timeout{ static_cast<int32_t>(this->leaveTimeoutMs) });
 	}
 
+	// Closing a transport closes its producers and consumers.
+	auto recvTransportClosed = std::async(std::launch::async, [this]() {
+		if (this->recvTransport)
+			this->recvTransport->Close();
+	});
+
 	if (this->sendTransport)
 	{
-		sendTransport->Close();
+		this->sendTransport->Close();
+	}
+
+	recvTransportClosed.get();
+
+	// Owned by the application once closed, the transports last.
+	delete this->audioProducer;
+	delete this->videoProducer;
+	delete this->dataProducer;
+	delete this->benchmarkDataProducer;
+	delete this->probeDataProducer;
+	delete this->fileDataProducer;
+
+	for (auto* dataConsumer : { this->dataConsumer,
+	                            this->benchmarkDataConsumer,
+	                            this->probeDataConsumer,
+	                            this->fileDataConsumer })
+	{
+		delete dataConsumer;
+	}
+
+	for (auto* consumer : this->consumers)
+	{
+		delete consumer;
+	}
+
+	delete this->sendTransport;
+	delete this->recvTransport;
+
+	this->consumers.clear();
+
+	this->sendTransport         = nullptr;
+	this->recvTransport         = nullptr;
+	this->audioProducer         = nullptr;
+	this->videoProducer         = nullptr;
+	this->dataProducer          = nullptr;
+	this->dataConsumer          = nullptr;
+	this->benchmarkDataProducer = nullptr;
+	this->benchmarkDataConsumer = nullptr;
+	this->probeDataProducer     = nullptr;
+	this->probeDataConsumer     = nullptr;
+	this->fileDataProducer      = nullptr;
+	this->fileDataConsumer      = nullptr;
+	this->videoCapturer         = nullptr;
+	this->sctpOpen              = false;
+
+	if (deleted.valid())
+	{
+		auto r = deleted.get();
+
+		if (r.error)
+		{
+			BCST_WARN << "unable to delete Broadcaster [error:\"" << r.error.message << "\"]";
+		}
+		else if (r.status_code != 200)
+		{
+			BCST_WARN << "unable to delete Broadcaster"
+			          << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
+		}
 	}
 
-	cpr::DeleteAsync(
-	  cpr::Url{ this->baseUrl + "/broadcasters/" + this->id }, cpr::VerifySsl{ verifySsl })
-	  .get();
+	this->joined = false;
 }
 
-void Broadcaster::OnOpen(mediasoupclient::DataProducer* /*dataProducer*/)
+void Broadcaster::OnOpen(mediasoupclient::DataProducer* dataProducer)
 {
-	std::cout << "[INFO] Broadcaster::OnOpen()" << std::endl;
+	BCST_INFO << "Broadcaster::OnOpen()";
+
+	if (dataProducer == this->dataProducer)
+	{
+		if (this->joinTimer)
+			this->joinTimer->RecordSinceBegin(JoinTimer::kFirstSctp);
+
+		this->sctpOpen = true;
+	}
+	else if (dataProducer == this->benchmarkDataProducer)
+	{
+		this->dataBenchmark->OnOpen();
+	}
+	else if (dataProducer == this->fileDataProducer)
+	{
+		this->fileTransfer->OnOpen();
+	}
 }
 void Broadcaster::OnClose(mediasoupclient::DataProducer* /*dataProducer*/)
 {
-	std::cout << "[INFO] Broadcaster::OnClose()" << std::endl;
+	BCST_INFO << "Broadcaster::OnClose()";
 }
-void Broadcaster::OnBufferedAmountChange(mediasoupclient::DataProducer* /*dataProducer*/, uint64_t /*size*/)
+void Broadcaster::OnBufferedAmountChange(mediasoupclient::DataProducer* dataProducer, uint64_t /*size*/)
 {
-	std::cout << "[INFO] Broadcaster::OnBufferedAmountChange()" << std::endl;
+	// Fired for every message sent, so keep the benchmark path silent.
+	if (dataProducer == this->benchmarkDataProducer)
+	{
+		this->dataBenchmark->OnBufferedAmountChange();
+
+		return;
+	}
+
+	if (dataProducer == this->fileDataProducer)
+	{
+		this->fileTransfer->OnBufferedAmountChange();
+
+		return;
+	}
+
+	BCST_DEBUG << "Broadcaster::OnBufferedAmountChange()";
 }
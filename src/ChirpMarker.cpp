@@ -0,0 +1,309 @@
+#include "ChirpMarker.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	constexpr double kPi        = 3.14159265358979323846;
+	constexpr int kSyncMs       = 20;
+	constexpr int kSlotMs       = 5;
+	constexpr int kSequenceBits = 8;
+	constexpr int kCrcBits      = 4;
+	constexpr int kSlots        = kSequenceBits + kCrcBits;
+	constexpr double kAmplitude = 8000;
+	constexpr double kSyncLow   = 500;
+	constexpr double kSlotLow   = 1000;
+	constexpr double kHigh      = 4000;
+	constexpr double kSyncMatch = 0.6;
+	constexpr double kSlotMatch = 0.4;
+	// Mean amplitude below which a window is not correlated at all.
+	constexpr double kMinLevel  = 100;
+
+	// Linear sweep from |low| to |high| Hz, tapered to avoid clicks, peak of 1.
+	std::vector<float> chirp(int sampleRate, int durationMs, double low, double high)
+	{
+		size_t size  = static_cast<size_t>(sampleRate) * durationMs / 1000;
+		size_t taper = size / 10;
+		double span  = static_cast<double>(durationMs) / 1000;
+		std::vector<float> samples(size);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			double t     = static_cast<double>(i) / sampleRate;
+			double phase = 2 * kPi * (low * t + (high - low) * t * t / (2 * span));
+			double gain  = 1;
+
+			if (i < taper)
+				gain = 0.5 - 0.5 * std::cos(kPi * i / taper);
+			else if (i >= size - taper)
+				gain = 0.5 - 0.5 * std::cos(kPi * (size - 1 - i) / taper);
+
+			samples[i] = static_cast<float>(gain * std::sin(phase));
+		}
+
+		return samples;
+	}
+
+	std::vector<int16_t> toSamples(const std::vector<float>& pattern)
+	{
+		std::vector<int16_t> samples(pattern.size());
+
+		for (size_t i = 0; i < pattern.size(); ++i)
+		{
+			samples[i] = static_cast<int16_t>(std::lround(pattern[i] * kAmplitude));
+		}
+
+		return samples;
+	}
+
+	// Scaled to a unit energy, so that correlations are normalized by the
+	// energy of the received samples only.
+	std::vector<float> toTemplate(std::vector<float> pattern)
+	{
+		double energy = 0;
+
+		for (auto sample : pattern)
+		{
+			energy += static_cast<double>(sample) * sample;
+		}
+
+		auto scale = static_cast<float>(1 / std::sqrt(energy));
+
+		for (auto& sample : pattern)
+		{
+			sample *= scale;
+		}
+
+		return pattern;
+	}
+
+	// CRC-4, polynomial x^4 + x + 1.
+	uint8_t crc4(uint8_t value)
+	{
+		uint8_t crc = 0;
+
+		for (int bit = kSequenceBits - 1; bit >= 0; --bit)
+		{
+			bool feedback = ((value >> bit) & 1) != ((crc >> 3) & 1);
+
+			crc = static_cast<uint8_t>((crc << 1) & 0x0f);
+
+			if (feedback)
+				crc ^= 0x03;
+		}
+
+		return crc;
+	}
+} // namespace
+
+int64_t ChirpMarker::LatencyMs(uint8_t sequence, double nowMs)
+{
+	auto period = static_cast<int64_t>(nowMs) / static_cast<int64_t>(kPeriodMs);
+	// Periods elapsed since the marker was sent.
+	int64_t elapsed = (period - sequence) & 0xff;
+
+	// Negative if the sender clock is ahead.
+	if (elapsed >= 0x80)
+		elapsed -= 0x100;
+
+	return std::llround(nowMs - static_cast<double>((period - elapsed) * kPeriodMs));
+}
+
+ChirpMarker::Generator::Generator(int sampleRate)
+  : sampleRate(sampleRate), sync(toSamples(chirp(sampleRate, kSyncMs, kSyncLow, kHigh))),
+    up(toSamples(chirp(sampleRate, kSlotMs, kSlotLow, kHigh))),
+    down(toSamples(chirp(sampleRate, kSlotMs, kHigh, kSlotLow)))
+{
+}
+
+void ChirpMarker::Generator::Fill(int16_t* samples, size_t count, uint64_t nowMs)
+{
+	std::fill(samples, samples + count, 0);
+
+	if (this->nextMarkerMs == 0)
+		this->nextMarkerMs = (nowMs / kPeriodMs + 1) * kPeriodMs;
+
+	size_t index = 0;
+
+	while (index < count)
+	{
+		if (this->position < 0)
+		{
+			// A late frame misses the marker start, which would be mistimed.
+			while (this->nextMarkerMs < nowMs)
+			{
+				this->nextMarkerMs += kPeriodMs;
+			}
+
+			size_t delay = (this->nextMarkerMs - nowMs) * this->sampleRate / 1000;
+
+			if (delay >= count)
+				return;
+
+			auto sequence = static_cast<uint8_t>(this->nextMarkerMs / kPeriodMs);
+			uint16_t bits = static_cast<uint16_t>(sequence << kCrcBits | crc4(sequence));
+
+			this->marker = this->sync;
+
+			for (int slot = kSlots - 1; slot >= 0; --slot)
+			{
+				const auto& pattern = ((bits >> slot) & 1) ? this->up : this->down;
+
+				this->marker.insert(this->marker.end(), pattern.begin(), pattern.end());
+			}
+
+			this->position = 0;
+			index          = std::max(index, delay);
+		}
+
+		size_t size = std::min(count - index, this->marker.size() - this->position);
+
+		std::copy_n(this->marker.begin() + this->position, size, samples + index);
+
+		index += size;
+		this->position += size;
+
+		if (static_cast<size_t>(this->position) == this->marker.size())
+		{
+			this->position = -1;
+			this->nextMarkerMs += kPeriodMs;
+		}
+	}
+}
+
+ChirpMarker::Detector::Detector(int sampleRate)
+  : sampleRate(sampleRate), sync(toTemplate(chirp(sampleRate, kSyncMs, kSyncLow, kHigh))),
+    up(toTemplate(chirp(sampleRate, kSlotMs, kSlotLow, kHigh))),
+    down(toTemplate(chirp(sampleRate, kSlotMs, kHigh, kSlotLow))),
+    markerSize(this->sync.size() + kSlots * this->up.size()), energy(1, 0)
+{
+}
+
+std::vector<ChirpMarker::Detector::Detection> ChirpMarker::Detector::Process(
+  const int16_t* samples, size_t count, size_t channels, uint64_t nowMs)
+{
+	std::vector<Detection> detections;
+
+	this->lastStart = this->bufferStart + this->buffer.size();
+	this->lastMs    = nowMs;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		float sample = samples[i * channels];
+
+		this->buffer.push_back(sample);
+		this->energy.push_back(this->energy.back() + static_cast<double>(sample) * sample);
+	}
+
+	const double minEnergy = kMinLevel * kMinLevel * this->sync.size();
+	// A sync match is refined over a slot, and the whole marker decoded.
+	const size_t lookahead = this->up.size() + this->markerSize;
+
+	while (this->searchStart + lookahead <= this->bufferStart + this->buffer.size())
+	{
+		size_t offset = this->searchStart - this->bufferStart;
+
+		if (
+		  this->energy[offset + this->sync.size()] - this->energy[offset] < minEnergy ||
+		  this->Correlate(this->sync, offset) < kSyncMatch)
+		{
+			++this->searchStart;
+
+			continue;
+		}
+
+		// The correlation peak.
+		size_t best      = offset;
+		double bestMatch = 0;
+
+		for (size_t candidate = offset; candidate <= offset + this->up.size(); ++candidate)
+		{
+			double match = this->Correlate(this->sync, candidate);
+
+			if (match > bestMatch)
+			{
+				best      = candidate;
+				bestMatch = match;
+			}
+		}
+
+		uint8_t sequence;
+
+		if (!this->Decode(best, sequence))
+		{
+			this->searchStart = this->bufferStart + best + 1;
+
+			continue;
+		}
+
+		Detection detection;
+
+		detection.sequence  = sequence;
+		detection.arrivalMs = this->lastMs + (static_cast<double>(this->bufferStart + best) -
+		                                      static_cast<double>(this->lastStart)) *
+		                                       1000 / this->sampleRate;
+
+		detections.push_back(detection);
+
+		this->searchStart = this->bufferStart + best + this->markerSize;
+	}
+
+	// Only the samples not searched yet are kept, rebasing the energy sums so
+	// that they do not grow forever.
+	size_t searched = std::min<size_t>(this->searchStart - this->bufferStart, this->buffer.size());
+
+	if (searched > 0)
+	{
+		double base = this->energy[searched];
+
+		this->buffer.erase(this->buffer.begin(), this->buffer.begin() + searched);
+		this->energy.erase(this->energy.begin(), this->energy.begin() + searched);
+
+		for (auto& sum : this->energy)
+		{
+			sum -= base;
+		}
+
+		this->bufferStart += searched;
+	}
+
+	return detections;
+}
+
+double ChirpMarker::Detector::Correlate(const std::vector<float>& pattern, size_t offset) const
+{
+	double energy = this->energy[offset + pattern.size()] - this->energy[offset];
+
+	if (energy <= 0)
+		return 0;
+
+	double product = 0;
+
+	for (size_t i = 0; i < pattern.size(); ++i)
+	{
+		product += pattern[i] * this->buffer[offset + i];
+	}
+
+	return product / std::sqrt(energy);
+}
+
+bool ChirpMarker::Detector::Decode(size_t offset, uint8_t& sequence) const
+{
+	uint16_t bits = 0;
+
+	for (int slot = 0; slot < kSlots; ++slot)
+	{
+		size_t position = offset + this->sync.size() + slot * this->up.size();
+		double up       = this->Correlate(this->up, position);
+		double down     = this->Correlate(this->down, position);
+
+		if (std::max(up, down) < kSlotMatch)
+			return false;
+
+		bits = static_cast<uint16_t>(bits << 1 | (up > down ? 1 : 0));
+	}
+
+	sequence = static_cast<uint8_t>(bits >> kCrcBits);
+
+	return crc4(sequence) == (bits & 0x0f);
+}
@@ -0,0 +1,460 @@
+#include "ConsumerMonitor.hpp"
+#include "AsyncLogger.hpp"
+#include "FrameStamp.hpp"
+#include "json.hpp"
+#include "rtc_base/ref_counted_object.h"
+#include <iomanip>
+#include <map>
+
+using namespace std::chrono;
+using json = nlohmann::json;
+
+namespace
+{
+	double getNumber(const json& stat, const char* key)
+	{
+		auto it = stat.find(key);
+
+		return it != stat.end() && it->is_number() ? it->get<double>() : 0;
+	}
+
+	// Returns the inbound-rtp entry of the Consumer stats, null if there is none.
+	json getInboundRtp(mediasoupclient::Consumer* consumer)
+	{
+		json stats;
+
+		try
+		{
+			stats = consumer->GetStats();
+		}
+		catch (const std::exception& error)
+		{
+			BCST_WARN << "unable to get Consumer stats: " << error.what();
+
+			return nullptr;
+		}
+
+		if (!stats.is_array())
+			return nullptr;
+
+		for (const auto& stat : stats)
+		{
+			if (stat.value("type", std::string()) == "inbound-rtp")
+				return stat;
+		}
+
+		return nullptr;
+	}
+} // namespace
+
+ConsumerMonitor::Sink::Sink(bool scoreQuality)
+{
+	if (!scoreQuality)
+		return;
+
+	this->scorer.reset(new QualityScorer());
+	this->scoreQueue.reset(new MpscRing<ScoreJob>(kScoreQueueSize));
+	this->scoreThread = std::thread(&ConsumerMonitor::Sink::RunScorer, this);
+}
+
+ConsumerMonitor::Sink::~Sink()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->stopping = true;
+	}
+
+	this->scoreCv.notify_all();
+
+	if (this->scoreThread.joinable())
+		this->scoreThread.join();
+}
+
+void ConsumerMonitor::Sink::OnFrame(const webrtc::VideoFrame& frame)
+{
+	this->counter.OnFrame(
+	  0, false, static_cast<uint32_t>(frame.width()), static_cast<uint32_t>(frame.height()));
+
+	auto buffer = frame.video_frame_buffer()->ToI420();
+	FrameStamp::Stamp stamp;
+
+	if (!FrameStamp::Read(
+	      buffer->DataY(), buffer->StrideY(), buffer->width(), buffer->height(), stamp))
+	{
+		return;
+	}
+
+	int64_t latencyMs = FrameStamp::LatencyMs(stamp, FrameStamp::NowMs());
+	auto now          = steady_clock::now();
+	bool unscored     = false;
+
+	// Holds a reference to the decoded buffer until scored.
+	if (this->scoreQueue)
+	{
+		unscored = !this->scoreQueue->TryPush([&buffer, &stamp](ScoreJob& job) {
+			job.buffer = buffer;
+			job.stamp  = stamp;
+		});
+
+		// Without the lock a wake up may be missed, which just delays the scoring.
+		if (!unscored)
+			this->scoreCv.notify_one();
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if (unscored)
+		++this->stampStats.unscored;
+
+	++this->stampStats.frames;
+	// Clocks off by more than the latency are reported as 0.
+	this->stampStats.latencyMs.Record(latencyMs > 0 ? latencyMs : 0);
+
+	if (this->stampSeen)
+	{
+		// Frame numbers are 24 bit.
+		uint32_t distance = (stamp.frameNumber - this->lastFrameNumber) & 0xffffff;
+
+		// Otherwise reordered or repeated.
+		if (distance > 1 && distance < 0x800000)
+			this->stampStats.skipped += distance - 1;
+
+		this->stampStats.frameGapMs.Record(
+		  duration_cast<milliseconds>(now - this->lastStampedFrame).count());
+	}
+
+	this->stampSeen        = true;
+	this->lastFrameNumber  = stamp.frameNumber;
+	this->lastStampedFrame = now;
+}
+
+void ConsumerMonitor::Sink::RunScorer()
+{
+	ScoreJob job;
+
+	while (true)
+	{
+		while (this->scoreQueue->TryPop([&job](ScoreJob& queued) { job = std::move(queued); }))
+		{
+			QualityScorer::Score score;
+			bool scored = this->scorer->Compute(*job.buffer, job.stamp, score);
+			auto layer  = std::make_pair(job.buffer->width(), job.buffer->height());
+
+			job.buffer = nullptr;
+
+			if (!scored)
+				continue;
+
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			auto& quality = this->stampStats.quality[layer];
+
+			if (quality.frames == 0 || score.psnr < quality.psnrMin)
+				quality.psnrMin = score.psnr;
+
+			if (quality.frames == 0 || score.ssim < quality.ssimMin)
+				quality.ssimMin = score.ssim;
+
+			++quality.frames;
+			quality.psnrSum += score.psnr;
+			quality.ssimSum += score.ssim;
+		}
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		if (this->stopping)
+			break;
+
+		this->scoreCv.wait_for(lock, milliseconds(50));
+	}
+}
+
+ConsumerMonitor::Sink::StampStats ConsumerMonitor::Sink::TakeStampStats()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	StampStats stats = this->stampStats;
+
+	this->stampStats = StampStats();
+
+	return stats;
+}
+
+void ConsumerMonitor::AudioSink::OnData(
+  const void* audioData,
+  int bitsPerSample,
+  int sampleRate,
+  size_t numberOfChannels,
+  size_t numberOfFrames)
+{
+	if (bitsPerSample != 16 || numberOfChannels == 0)
+		return;
+
+	if (!this->detector || this->detector->GetSampleRate() != sampleRate)
+		this->detector.reset(new ChirpMarker::Detector(sampleRate));
+
+	auto detections = this->detector->Process(
+	  static_cast<const int16_t*>(audioData), numberOfFrames, numberOfChannels, FrameStamp::NowMs());
+
+	if (detections.empty())
+		return;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	for (const auto& detection : detections)
+	{
+		int64_t latencyMs = ChirpMarker::LatencyMs(detection.sequence, detection.arrivalMs);
+
+		++this->chirpStats.markers;
+		// Clocks off by more than the latency are reported as 0.
+		this->chirpStats.latencyMs.Record(latencyMs > 0 ? latencyMs : 0);
+
+		if (this->markerSeen)
+		{
+			auto distance = static_cast<uint8_t>(detection.sequence - this->lastSequence);
+
+			// Otherwise repeated.
+			if (distance > 1 && distance < 0x80)
+				this->chirpStats.missed += distance - 1;
+		}
+
+		this->markerSeen   = true;
+		this->lastSequence = detection.sequence;
+	}
+}
+
+ConsumerMonitor::AudioSink::ChirpStats ConsumerMonitor::AudioSink::TakeChirpStats()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	ChirpStats stats = this->chirpStats;
+
+	this->chirpStats = ChirpStats();
+
+	return stats;
+}
+
+ConsumerMonitor::ConsumerMonitor(const Options& options) : options(options)
+{
+}
+
+ConsumerMonitor::~ConsumerMonitor()
+{
+	this->Stop();
+}
+
+void ConsumerMonitor::Start(const std::vector<mediasoupclient::Consumer*>& consumers)
+{
+	BCST_INFO << "ConsumerMonitor::Start() [consumers:" << consumers.size() << "]";
+
+	for (auto* consumer : consumers)
+	{
+		Entry entry;
+
+		entry.consumer = consumer;
+		entry.peerId   = consumer->GetAppData().value("peerId", std::string());
+
+		if (consumer->GetKind() == "audio" && this->options.chirps)
+		{
+			entry.audioSink.reset(new AudioSink());
+
+			static_cast<webrtc::AudioTrackInterface*>(consumer->GetTrack())
+			  ->AddSink(entry.audioSink.get());
+		}
+		else if (consumer->GetKind() == "video" && this->options.decode)
+		{
+			entry.sink.reset(new Sink(this->options.quality));
+
+			static_cast<webrtc::VideoTrackInterface*>(consumer->GetTrack())
+			  ->AddOrUpdateSink(entry.sink.get(), rtc::VideoSinkWants());
+		}
+		// Stays attached to the receiver until the Consumer is gone.
+		else if (consumer->GetKind() == "video")
+		{
+			entry.encodedFrameCounter = new rtc::RefCountedObject<EncodedFrameCounter>();
+
+			consumer->GetRtpReceiver()->SetDepacketizerToDecoderFrameTransformer(
+			  entry.encodedFrameCounter);
+		}
+
+		this->entries.push_back(std::move(entry));
+	}
+
+	this->thread = std::thread(&ConsumerMonitor::Run, this);
+}
+
+void ConsumerMonitor::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->stopping = true;
+	}
+
+	this->cv.notify_all();
+
+	if (this->thread.joinable())
+		this->thread.join();
+
+	for (auto& entry : this->entries)
+	{
+		if (entry.sink)
+		{
+			static_cast<webrtc::VideoTrackInterface*>(entry.consumer->GetTrack())
+			  ->RemoveSink(entry.sink.get());
+		}
+		else if (entry.audioSink)
+		{
+			static_cast<webrtc::AudioTrackInterface*>(entry.consumer->GetTrack())
+			  ->RemoveSink(entry.audioSink.get());
+		}
+	}
+
+	this->entries.clear();
+}
+
+void ConsumerMonitor::Run()
+{
+	const auto interval = seconds(this->options.reportIntervalSeconds);
+	auto lastReport     = steady_clock::now();
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	while (!this->cv.wait_for(lock, interval, [this]() { return this->stopping; }))
+	{
+		auto now = steady_clock::now();
+
+		// Stats are polled from the signaling thread, not under the lock.
+		lock.unlock();
+		this->Report(now - lastReport);
+		lock.lock();
+
+		lastReport = now;
+	}
+}
+
+void ConsumerMonitor::Report(steady_clock::duration elapsed)
+{
+	double elapsedSeconds = duration_cast<duration<double>>(elapsed).count();
+	// Keyed by peer id, to get the A/V offset.
+	std::map<std::string, Histogram> audioLatencies;
+	std::map<std::string, Histogram> videoLatencies;
+
+	for (auto& entry : this->entries)
+	{
+		json inboundRtp = getInboundRtp(entry.consumer);
+
+		auto packetsReceived = static_cast<uint64_t>(getNumber(inboundRtp, "packetsReceived"));
+		auto packetsLost     = static_cast<int64_t>(getNumber(inboundRtp, "packetsLost"));
+
+		if (!entry.sink && !entry.encodedFrameCounter)
+		{
+			BCST_INFO << "consumer [id:" << entry.consumer->GetId() << ", kind:audio, packets/s:"
+			          << std::fixed << std::setprecision(1)
+			          << (packetsReceived - entry.previousPacketsReceived) / elapsedSeconds
+			          << ", lost:" << packetsLost << "]";
+
+			entry.previousPacketsReceived = packetsReceived;
+
+			if (!entry.audioSink)
+				continue;
+
+			auto chirpStats = entry.audioSink->TakeChirpStats();
+
+			if (chirpStats.markers > 0)
+			{
+				BCST_INFO << "consumer [id:" << entry.consumer->GetId()
+				          << "] mouth-to-ear latency ms: " << chirpStats.latencyMs.ToString()
+				          << " [markers:" << chirpStats.markers << ", missed:" << chirpStats.missed
+				          << "]";
+
+				audioLatencies[entry.peerId].Merge(chirpStats.latencyMs);
+			}
+
+			continue;
+		}
+
+		auto video =
+		  entry.sink ? entry.sink->counter.GetStats() : entry.encodedFrameCounter->GetStats();
+		uint64_t frames = video.frames - entry.previousVideo.frames;
+
+		if (entry.encodedFrameCounter)
+		{
+			BCST_INFO << "consumer [id:" << entry.consumer->GetId()
+			          << ", kind:video, decode:false, fps:" << std::fixed << std::setprecision(1)
+			          << frames / elapsedSeconds
+			          << ", keyFrames:" << video.keyFrames - entry.previousVideo.keyFrames
+			          << ", kbps:"
+			          << (video.bytes - entry.previousVideo.bytes) * 8 / elapsedSeconds / 1000
+			          << ", freezes:" << video.freezes - entry.previousVideo.freezes
+			          << ", freezeMs:" << video.totalFreezeMs - entry.previousVideo.totalFreezeMs
+			          << ", lost:" << packetsLost << "]";
+
+			entry.previousVideo = video;
+
+			continue;
+		}
+
+		auto framesDecoded     = static_cast<uint64_t>(getNumber(inboundRtp, "framesDecoded"));
+		double totalDecodeTime = getNumber(inboundRtp, "totalDecodeTime");
+		uint64_t decodedFrames = framesDecoded - entry.previousFramesDecoded;
+		double decodeTimeMs    = 0;
+
+		if (decodedFrames > 0)
+			decodeTimeMs = (totalDecodeTime - entry.previousTotalDecodeTime) * 1000 / decodedFrames;
+
+		BCST_INFO << "consumer [id:" << entry.consumer->GetId() << ", kind:video, fps:" << std::fixed
+		          << std::setprecision(1) << frames / elapsedSeconds << ", resolution:" << video.width
+		          << "x" << video.height
+		          << ", freezes:" << video.freezes - entry.previousVideo.freezes
+		          << ", freezeMs:" << video.totalFreezeMs - entry.previousVideo.totalFreezeMs
+		          << ", decodeMs:" << std::setprecision(2) << decodeTimeMs << ", lost:" << packetsLost
+		          << "]";
+
+		auto stampStats = entry.sink->TakeStampStats();
+
+		if (stampStats.frames > 0)
+		{
+			BCST_INFO << "consumer [id:" << entry.consumer->GetId()
+			          << "] glass-to-glass latency ms: " << stampStats.latencyMs.ToString();
+			BCST_INFO << "consumer [id:" << entry.consumer->GetId()
+			          << "] frame gap ms: " << stampStats.frameGapMs.ToString()
+			          << " [stamped:" << stampStats.frames << ", skipped:" << stampStats.skipped
+			          << ", unscored:" << stampStats.unscored << "]";
+
+			videoLatencies[entry.peerId].Merge(stampStats.latencyMs);
+		}
+
+		for (const auto& kv : stampStats.quality)
+		{
+			const auto& quality = kv.second;
+
+			BCST_INFO << "consumer [id:" << entry.consumer->GetId() << "] quality [layer:"
+			          << kv.first.first << "x" << kv.first.second << ", frames:" << quality.frames
+			          << ", psnr:" << std::fixed << std::setprecision(2)
+			          << quality.psnrSum / quality.frames
+			          << ", minPsnr:" << quality.psnrMin << ", ssim:" << std::setprecision(4)
+			          << quality.ssimSum / quality.frames << ", minSsim:" << quality.ssimMin << "]";
+		}
+
+		entry.previousVideo           = video;
+		entry.previousFramesDecoded   = framesDecoded;
+		entry.previousTotalDecodeTime = totalDecodeTime;
+	}
+
+	for (const auto& kv : audioLatencies)
+	{
+		auto it = videoLatencies.find(kv.first);
+
+		if (kv.first.empty() || it == videoLatencies.end())
+			continue;
+
+		auto audioMs = static_cast<int64_t>(kv.second.Percentile(50));
+		auto videoMs = static_cast<int64_t>(it->second.Percentile(50));
+
+		// Positive if the audio lags the video.
+		BCST_INFO << "peer [id:" << kv.first << "] A/V offset ms: " << audioMs - videoMs
+		          << " [audio p50:" << audioMs << ", video p50:" << videoMs << "]";
+	}
+}
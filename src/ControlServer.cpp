@@ -0,0 +1,232 @@
+#include "ControlServer.hpp"
+#include "AsyncLogger.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace
+{
+	bool sendAll(int fd, const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+
+			if (sent < 0 && errno == EINTR)
+				continue;
+
+			if (sent <= 0)
+				return false;
+
+			data += sent;
+			size -= sent;
+		}
+
+		return true;
+	}
+
+	json errorResponse(const std::string& message)
+	{
+		return { { "ok", false }, { "error", message } };
+	}
+} // namespace
+
+ControlServer::ControlServer(const Options& options, Handler handler)
+  : options(options), handler(std::move(handler))
+{
+}
+
+ControlServer::~ControlServer()
+{
+	this->Stop();
+}
+
+bool ControlServer::Start()
+{
+	sockaddr_un addr{};
+
+	if (this->options.path.empty())
+	{
+		BCST_ERROR << "empty control socket path";
+
+		return false;
+	}
+
+	// Along with its terminating null character.
+	if (this->options.path.size() >= sizeof(addr.sun_path))
+	{
+		BCST_ERROR << "control socket path too long, up to " << sizeof(addr.sun_path) - 1
+		           << " characters [path:" << this->options.path << "]";
+
+		return false;
+	}
+
+	addr.sun_family = AF_UNIX;
+	std::memcpy(addr.sun_path, this->options.path.c_str(), this->options.path.size() + 1);
+
+	struct stat st;
+
+	// A socket left behind by a previous run, never anything else.
+	if (::lstat(this->options.path.c_str(), &st) == 0)
+	{
+		if (!S_ISSOCK(st.st_mode))
+		{
+			BCST_ERROR << "control socket path exists and is not a socket [path:"
+			           << this->options.path << "]";
+
+			return false;
+		}
+
+		::unlink(this->options.path.c_str());
+	}
+
+	this->listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (this->listenFd < 0)
+	{
+		BCST_ERROR << "unable to create control socket: " << std::strerror(errno);
+
+		return false;
+	}
+
+	if (
+	  ::bind(this->listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+	  ::listen(this->listenFd, 4) != 0)
+	{
+		BCST_ERROR << "unable to listen on " << this->options.path << ": " << std::strerror(errno);
+
+		::close(this->listenFd);
+		this->listenFd = -1;
+
+		return false;
+	}
+
+	BCST_INFO << "ControlServer::Start() [path:" << this->options.path << "]";
+
+	this->thread = std::thread(&ControlServer::Run, this);
+
+	return true;
+}
+
+void ControlServer::Stop()
+{
+	this->stopping = true;
+
+	if (this->thread.joinable())
+		this->thread.join();
+
+	if (this->listenFd >= 0)
+	{
+		::close(this->listenFd);
+		::unlink(this->options.path.c_str());
+		this->listenFd = -1;
+	}
+}
+
+void ControlServer::Run()
+{
+	pollfd pfd{ this->listenFd, POLLIN, 0 };
+
+	while (!this->stopping)
+	{
+		// Wake up periodically to check |stopping|.
+		if (::poll(&pfd, 1, 200) <= 0)
+			continue;
+
+		int fd = ::accept4(this->listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+
+		if (fd < 0)
+			continue;
+
+		this->Serve(fd);
+		::close(fd);
+	}
+}
+
+void ControlServer::Serve(int fd)
+{
+	using namespace std::chrono;
+
+	pollfd pfd{ fd, POLLIN, 0 };
+	std::string data;
+	char buffer[4096];
+	auto lastActivity = steady_clock::now();
+
+	while (!this->stopping)
+	{
+		int ready = ::poll(&pfd, 1, 200);
+
+		if (ready < 0 && errno != EINTR)
+			return;
+
+		if (ready <= 0)
+		{
+			if (steady_clock::now() - lastActivity > milliseconds(this->options.idleTimeoutMs))
+				return;
+
+			continue;
+		}
+
+		ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+
+		if (received < 0 && errno == EINTR)
+			continue;
+
+		if (received <= 0)
+			return;
+
+		lastActivity = steady_clock::now();
+		data.append(buffer, received);
+
+		size_t lineEnd;
+
+		while ((lineEnd = data.find('\n')) != std::string::npos)
+		{
+			std::string line = data.substr(0, lineEnd);
+
+			data.erase(0, lineEnd + 1);
+
+			if (line.find_first_not_of(" \t\r") == std::string::npos)
+				continue;
+
+			std::string response = this->Handle(line).dump() + "\n";
+
+			if (!sendAll(fd, response.data(), response.size()))
+				return;
+		}
+
+		if (data.size() > kMaxRequestSize)
+		{
+			std::string response = errorResponse("request too large").dump() + "\n";
+
+			sendAll(fd, response.data(), response.size());
+
+			return;
+		}
+	}
+}
+
+json ControlServer::Handle(const std::string& line)
+{
+	auto request = json::parse(line, nullptr, false);
+
+	if (request.is_discarded() || !request.is_object())
+		return errorResponse("request must be a JSON object");
+
+	try
+	{
+		return this->handler(request);
+	}
+	catch (const std::exception& error)
+	{
+		return errorResponse(error.what());
+	}
+}
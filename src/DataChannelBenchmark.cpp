@@ -0,0 +1,204 @@
+#include "DataChannelBenchmark.hpp"
+#include "AsyncLogger.hpp"
+#include "DataChannelLimits.hpp"
+#include <cstring>
+
+using namespace std::chrono;
+
+DataChannelBenchmark::DataChannelBenchmark(const Options& options) : options(options)
+{
+	if (this->options.messageSize == 0)
+		this->options.messageSize = 1;
+
+	if (this->options.reportIntervalSeconds == 0)
+		this->options.reportIntervalSeconds = 1;
+}
+
+DataChannelBenchmark::~DataChannelBenchmark()
+{
+	this->Stop();
+}
+
+void DataChannelBenchmark::Start(mediasoupclient::DataProducer* dataProducer, size_t maxMessageSize)
+{
+	// Larger messages would fail on every send.
+	if (this->options.messageSize > maxMessageSize)
+		this->options.messageSize = maxMessageSize;
+
+	// Sending below the high-water mark must never exceed the buffered amount limit.
+	uint64_t maxHighWaterMark = DataChannelLimits::kMaxBufferedAmount - this->options.messageSize;
+
+	if (this->options.highWaterMark > maxHighWaterMark)
+		this->options.highWaterMark = maxHighWaterMark;
+
+	if (this->options.lowWaterMark >= this->options.highWaterMark)
+		this->options.lowWaterMark = this->options.highWaterMark / 2;
+
+	BCST_INFO << "DataChannelBenchmark::Start() [messageSize:" << this->options.messageSize
+	          << ", highWaterMark:" << this->options.highWaterMark
+	          << ", lowWaterMark:" << this->options.lowWaterMark << "]";
+
+	this->dataProducer = dataProducer;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->open = DataChannelLimits::IsOpen(this->dataProducer);
+	}
+
+	this->thread = std::thread(&DataChannelBenchmark::Run, this);
+}
+
+void DataChannelBenchmark::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->stopping = true;
+	}
+
+	this->cv.notify_all();
+
+	if (this->thread.joinable())
+		this->thread.join();
+}
+
+void DataChannelBenchmark::OnOpen()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->open = true;
+	}
+
+	this->cv.notify_all();
+}
+
+void DataChannelBenchmark::OnBufferedAmountChange()
+{
+	uint64_t amount = this->dataProducer->GetBufferedAmount();
+	bool resume     = false;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->bufferedAmount.Record(amount);
+
+		if (this->paused && amount <= this->options.lowWaterMark)
+		{
+			this->paused = false;
+			resume       = true;
+		}
+	}
+
+	if (resume)
+		this->cv.notify_all();
+}
+
+void DataChannelBenchmark::OnMessage(const rtc::CopyOnWriteBuffer& data)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	++this->receivedMessages;
+	this->receivedBytes += data.size();
+}
+
+void DataChannelBenchmark::Run()
+{
+	rtc::CopyOnWriteBuffer payload(this->options.messageSize);
+
+	std::memset(payload.data(), 0xA5, payload.size());
+
+	const webrtc::DataBuffer buffer(payload, true /* binary */);
+	const auto interval = seconds(this->options.reportIntervalSeconds);
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	this->cv.wait(lock, [this] { return this->open || this->stopping; });
+
+	this->lastReport = steady_clock::now();
+	auto nextReport  = this->lastReport + interval;
+
+	while (!this->stopping)
+	{
+		auto now = steady_clock::now();
+
+		if (now >= nextReport)
+		{
+			this->Report(now);
+			nextReport = now + interval;
+		}
+
+		if (this->paused)
+		{
+			// OnBufferedAmountChange() normally resumes us, but the buffer may have
+			// drained before we paused, so poll it as well.
+			this->cv.wait_until(lock, std::min(nextReport, now + milliseconds(100)), [this] {
+				return !this->paused || this->stopping;
+			});
+
+			if (!this->paused || this->stopping)
+				continue;
+
+			lock.unlock();
+			uint64_t amount = this->dataProducer->GetBufferedAmount();
+			lock.lock();
+
+			if (amount <= this->options.lowWaterMark)
+				this->paused = false;
+
+			continue;
+		}
+
+		lock.unlock();
+		bool open       = DataChannelLimits::IsOpen(this->dataProducer);
+		uint64_t amount = open ? this->dataProducer->GetBufferedAmount() : 0;
+
+		if (open && amount < this->options.highWaterMark)
+			this->dataProducer->Send(buffer);
+		lock.lock();
+
+		if (!open)
+		{
+			// The channel is closing or the SCTP association is not ready.
+			++this->sendFailures;
+			this->cv.wait_for(lock, milliseconds(10), [this] { return this->stopping; });
+		}
+		else if (amount >= this->options.highWaterMark)
+		{
+			this->paused = true;
+			++this->pauses;
+		}
+		else
+		{
+			++this->sentMessages;
+			this->sentBytes += this->options.messageSize;
+		}
+	}
+}
+
+void DataChannelBenchmark::Report(steady_clock::time_point now)
+{
+	double elapsed = duration<double>(now - this->lastReport).count();
+
+	if (elapsed <= 0)
+		return;
+
+	const double megabyte = 1024 * 1024;
+
+	BCST_INFO << "data benchmark [sent:" << this->sentMessages / elapsed << " msg/s "
+	          << this->sentBytes / megabyte / elapsed << " MB/s, received:"
+	          << this->receivedMessages / elapsed << " msg/s "
+	          << this->receivedBytes / megabyte / elapsed << " MB/s, pauses:" << this->pauses
+	          << ", sendFailures:" << this->sendFailures
+	          << ", bufferedAmount(KB):" << this->bufferedAmount.ToString(1024) << "]";
+
+	this->sentMessages     = 0;
+	this->sentBytes        = 0;
+	this->receivedMessages = 0;
+	this->receivedBytes    = 0;
+	this->pauses           = 0;
+	this->sendFailures     = 0;
+	this->bufferedAmount.Reset();
+	this->lastReport = now;
+}
@@ -0,0 +1,50 @@
+#include "DataMessageDispatcher.hpp"
+#include <utility>
+
+void DataMessageDispatcher::RegisterHandler(const std::string& label, Handler handler)
+{
+	auto& entry = this->entries[label];
+
+	if (!entry)
+		entry.reset(new Entry());
+
+	entry->handler = std::move(handler);
+}
+
+mediasoupclient::DataConsumer::Listener* DataMessageDispatcher::AddDataConsumer(
+  const std::string& label)
+{
+	auto it = this->entries.find(label);
+
+	return it != this->entries.end() ? it->second.get() : &this->unhandled;
+}
+
+std::vector<DataMessageDispatcher::Counters> DataMessageDispatcher::GetCounters() const
+{
+	std::vector<Counters> counters;
+
+	counters.reserve(this->entries.size() + 1);
+
+	for (const auto& kv : this->entries)
+	{
+		counters.push_back({ kv.first,
+		                     kv.second->messages.load(std::memory_order_relaxed),
+		                     kv.second->bytes.load(std::memory_order_relaxed) });
+	}
+
+	counters.push_back({ "",
+	                     this->unhandled.messages.load(std::memory_order_relaxed),
+	                     this->unhandled.bytes.load(std::memory_order_relaxed) });
+
+	return counters;
+}
+
+void DataMessageDispatcher::Entry::OnMessage(
+  mediasoupclient::DataConsumer* /*dataConsumer*/, const webrtc::DataBuffer& buffer)
+{
+	this->messages.fetch_add(1, std::memory_order_relaxed);
+	this->bytes.fetch_add(buffer.size(), std::memory_order_relaxed);
+
+	if (this->handler)
+		this->handler(buffer.data, buffer.binary);
+}
@@ -0,0 +1,193 @@
+#include "DataSender.hpp"
+#include "AsyncLogger.hpp"
+#include "DataChannelLimits.hpp"
+#include <chrono>
+#include <utility>
+
+DataSender::DataSender(const Options& options) : options(options)
+{
+	if (this->options.maxBatchSize <= kFrameHeaderSize)
+		this->options.maxBatchSize = kFrameHeaderSize + 1;
+
+	if (this->options.flushIntervalMs == 0)
+		this->options.flushIntervalMs = 1;
+}
+
+DataSender::~DataSender()
+{
+	this->Stop();
+}
+
+void DataSender::Start(mediasoupclient::DataProducer* dataProducer)
+{
+	BCST_INFO << "DataSender::Start() [coalesce:" << std::boolalpha << this->options.coalesce
+	          << ", maxBatchSize:" << this->options.maxBatchSize
+	          << ", flushInterval:" << this->options.flushIntervalMs << "ms]";
+
+	this->dataProducer = dataProducer;
+	this->batch        = rtc::CopyOnWriteBuffer(0, this->options.maxBatchSize);
+	this->thread       = std::thread(&DataSender::Run, this);
+}
+
+void DataSender::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->stopping = true;
+	}
+
+	this->cv.notify_all();
+
+	if (this->thread.joinable())
+		this->thread.join();
+}
+
+bool DataSender::Push(rtc::CopyOnWriteBuffer data, bool binary)
+{
+	size_t size  = data.size();
+	size_t limit = this->options.maxBatchSize;
+
+	if (this->options.coalesce)
+		limit -= kFrameHeaderSize;
+
+	// Messages pushed concurrently with Stop() may still be discarded.
+	if (this->stopping.load(std::memory_order_relaxed) || size > limit)
+	{
+		this->droppedMessages.fetch_add(1, std::memory_order_relaxed);
+
+		return false;
+	}
+
+	size_t queued = this->queuedBytes.fetch_add(size, std::memory_order_relaxed) + size;
+
+	if (queued > this->options.maxQueuedBytes)
+	{
+		this->queuedBytes.fetch_sub(size, std::memory_order_relaxed);
+		this->droppedMessages.fetch_add(1, std::memory_order_relaxed);
+
+		return false;
+	}
+
+	this->queue.Push({ std::move(data), binary });
+
+	// Not taking the mutex may lose a wake up, which just delays the message
+	// until the next flush interval.
+	if (!this->options.coalesce || queued >= this->options.maxBatchSize)
+		this->cv.notify_one();
+
+	return true;
+}
+
+bool DataSender::Unbatch(
+  const rtc::CopyOnWriteBuffer& batch,
+  const std::function<void(const uint8_t* data, size_t size)>& onMessage)
+{
+	const uint8_t* data = batch.cdata();
+	size_t remaining    = batch.size();
+
+	while (remaining > 0)
+	{
+		if (remaining < kFrameHeaderSize)
+			return false;
+
+		size_t size = static_cast<size_t>(data[0]) | static_cast<size_t>(data[1]) << 8 |
+		              static_cast<size_t>(data[2]) << 16 | static_cast<size_t>(data[3]) << 24;
+
+		data += kFrameHeaderSize;
+		remaining -= kFrameHeaderSize;
+
+		if (size > remaining)
+			return false;
+
+		onMessage(data, size);
+
+		data += size;
+		remaining -= size;
+	}
+
+	return true;
+}
+
+void DataSender::Run()
+{
+	const auto interval = std::chrono::milliseconds(this->options.flushIntervalMs);
+
+	while (!this->stopping)
+	{
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			this->cv.wait_for(lock, interval, [this] { return this->stopping.load(); });
+		}
+
+		this->Flush();
+	}
+
+	// Send what was queued before stopping.
+	this->Flush();
+
+	BCST_INFO << "DataSender stopped [messages:" << this->sentMessages
+	          << ", batches:" << this->sentBatches << ", failedSends:" << this->failedSends
+	          << ", dropped:" << this->droppedMessages << "]";
+}
+
+void DataSender::Flush()
+{
+	Message message;
+
+	while (this->queue.Pop(message))
+	{
+		size_t size = message.data.size();
+
+		this->queuedBytes.fetch_sub(size, std::memory_order_relaxed);
+
+		if (!this->options.coalesce)
+		{
+			this->Send(message.data, message.binary);
+			++this->sentMessages;
+
+			continue;
+		}
+
+		if (this->batch.size() + kFrameHeaderSize + size > this->options.maxBatchSize)
+		{
+			this->Send(this->batch, true);
+			this->batch = rtc::CopyOnWriteBuffer(0, this->options.maxBatchSize);
+		}
+
+		uint8_t header[kFrameHeaderSize];
+
+		header[0] = static_cast<uint8_t>(size);
+		header[1] = static_cast<uint8_t>(size >> 8);
+		header[2] = static_cast<uint8_t>(size >> 16);
+		header[3] = static_cast<uint8_t>(size >> 24);
+
+		this->batch.AppendData(header, kFrameHeaderSize);
+		this->batch.AppendData(message.data.cdata(), size);
+		++this->sentMessages;
+	}
+
+	if (this->batch.size() > 0)
+	{
+		this->Send(this->batch, true);
+		this->batch = rtc::CopyOnWriteBuffer(0, this->options.maxBatchSize);
+	}
+}
+
+void DataSender::Send(const rtc::CopyOnWriteBuffer& data, bool binary)
+{
+	if (this->options.coalesce)
+		++this->sentBatches;
+
+	if (
+	  !DataChannelLimits::IsOpen(this->dataProducer) ||
+	  this->dataProducer->GetBufferedAmount() + data.size() > DataChannelLimits::kMaxBufferedAmount)
+	{
+		++this->failedSends;
+
+		return;
+	}
+
+	this->dataProducer->Send(webrtc::DataBuffer(data, binary));
+}
@@ -0,0 +1,54 @@
+#include "EncodedFrameCounter.hpp"
+#include <utility>
+
+void EncodedFrameCounter::Transform(std::unique_ptr<webrtc::TransformableFrameInterface> frame)
+{
+	// Only attached to video receivers.
+	bool keyFrame = static_cast<webrtc::TransformableVideoFrameInterface*>(frame.get())->IsKeyFrame();
+
+	this->counter.OnFrame(frame->GetData().size(), keyFrame);
+
+	rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		auto it = this->sinkCallbacks.find(frame->GetSsrc());
+
+		callback = it != this->sinkCallbacks.end() ? it->second : this->callback;
+	}
+
+	// Without a callback the frame is dropped.
+	if (callback)
+		callback->OnTransformedFrame(std::move(frame));
+}
+
+void EncodedFrameCounter::RegisterTransformedFrameCallback(
+  rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->callback = callback;
+}
+
+void EncodedFrameCounter::RegisterTransformedFrameSinkCallback(
+  rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback, uint32_t ssrc)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->sinkCallbacks[ssrc] = callback;
+}
+
+void EncodedFrameCounter::UnregisterTransformedFrameCallback()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->callback = nullptr;
+}
+
+void EncodedFrameCounter::UnregisterTransformedFrameSinkCallback(uint32_t ssrc)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->sinkCallbacks.erase(ssrc);
+}
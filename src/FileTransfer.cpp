@@ -0,0 +1,543 @@
+#include "FileTransfer.hpp"
+#include "AsyncLogger.hpp"
+#include "DataChannelLimits.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::chrono;
+
+namespace
+{
+	constexpr size_t kHeaderSize      = 1 + 4;
+	constexpr size_t kBeginHeaderSize = kHeaderSize + 8 + 4 + 2;
+	constexpr size_t kChunkHeaderSize = kHeaderSize + 8;
+	constexpr size_t kEndSize         = kHeaderSize + 4;
+
+	void writeUint(uint8_t* data, uint64_t value, size_t bytes)
+	{
+		for (size_t i = 0; i < bytes; ++i)
+		{
+			data[i] = static_cast<uint8_t>(value >> (8 * i));
+		}
+	}
+
+	uint64_t readUint(const uint8_t* data, size_t bytes)
+	{
+		uint64_t value = 0;
+
+		for (size_t i = 0; i < bytes; ++i)
+		{
+			value |= static_cast<uint64_t>(data[i]) << (8 * i);
+		}
+
+		return value;
+	}
+
+	rtc::CopyOnWriteBuffer createMessage(
+	  FileTransfer::MessageType type, uint32_t id, size_t size, size_t payloadSize = 0)
+	{
+		rtc::CopyOnWriteBuffer message(size, size + payloadSize);
+
+		message.data()[0] = type;
+		writeUint(message.data() + 1, id, 4);
+
+		return message;
+	}
+
+	std::string toHex(uint32_t value)
+	{
+		char hex[9];
+
+		std::snprintf(hex, sizeof(hex), "%08x", value);
+
+		return hex;
+	}
+
+	bool sameFile(const std::string& a, const std::string& b)
+	{
+		struct stat stA, stB;
+
+		return ::stat(a.c_str(), &stA) == 0 && ::stat(b.c_str(), &stB) == 0 &&
+		       stA.st_dev == stB.st_dev && stA.st_ino == stB.st_ino;
+	}
+
+	double megabytesPerSecond(uint64_t bytes, steady_clock::time_point since)
+	{
+		double elapsed = duration<double>(steady_clock::now() - since).count();
+
+		return elapsed > 0 ? bytes / (1024.0 * 1024.0) / elapsed : 0;
+	}
+} // namespace
+
+uint32_t FileTransfer::Crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+	static const std::array<uint32_t, 256> table = [] {
+		std::array<uint32_t, 256> table{};
+
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t value = i;
+
+			for (int bit = 0; bit < 8; ++bit)
+			{
+				value = (value & 1) ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+			}
+
+			table[i] = value;
+		}
+
+		return table;
+	}();
+
+	crc = ~crc;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+
+	return ~crc;
+}
+
+FileTransfer::FileTransfer(const Options& options) : options(options)
+{
+	if (this->options.windowSize > DataChannelLimits::kMaxBufferedAmount)
+		this->options.windowSize = DataChannelLimits::kMaxBufferedAmount;
+
+	this->receiverThread = std::thread(&FileTransfer::RunReceiver, this);
+}
+
+FileTransfer::~FileTransfer()
+{
+	this->Stop();
+}
+
+void FileTransfer::Start(mediasoupclient::DataProducer* dataProducer, size_t maxMessageSize)
+{
+	this->dataProducer = dataProducer;
+
+	if (maxMessageSize <= kChunkHeaderSize)
+	{
+		BCST_ERROR << "SCTP max message size too small for file transfer chunks [maxMessageSize:"
+		           << maxMessageSize << "]";
+
+		return;
+	}
+
+	// Chunks must fit, along with their header, in a single SCTP message.
+	this->chunkSize = std::min(this->options.chunkSize, maxMessageSize - kChunkHeaderSize);
+
+	if (this->chunkSize == 0)
+		this->chunkSize = 1;
+
+	// The window must fit a whole chunk.
+	this->options.windowSize =
+	  std::max<uint64_t>(this->options.windowSize, this->chunkSize + kChunkHeaderSize);
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->open = DataChannelLimits::IsOpen(this->dataProducer);
+	}
+
+	if (!this->options.sendPath.empty())
+		this->senderThread = std::thread(&FileTransfer::RunSender, this);
+}
+
+void FileTransfer::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->stopping = true;
+	}
+
+	this->cv.notify_all();
+	this->receiverCv.notify_all();
+
+	if (this->senderThread.joinable())
+		this->senderThread.join();
+
+	if (this->receiverThread.joinable())
+		this->receiverThread.join();
+}
+
+void FileTransfer::OnOpen()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->open = true;
+	}
+
+	this->cv.notify_all();
+}
+
+void FileTransfer::OnBufferedAmountChange()
+{
+	uint64_t amount = this->dataProducer->GetBufferedAmount();
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->bufferedAmount = amount;
+	}
+
+	this->cv.notify_all();
+}
+
+void FileTransfer::OnMessage(const rtc::CopyOnWriteBuffer& data)
+{
+	// Takes a reference, not a copy.
+	this->incomingQueue.Push(data);
+	this->receiverCv.notify_one();
+}
+
+void FileTransfer::RunSender()
+{
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		this->cv.wait(lock, [this] { return this->open || this->stopping; });
+
+		if (this->stopping)
+			return;
+	}
+
+	if (!this->SendFile())
+	{
+		BCST_ERROR << "file transfer failed [path:" << this->options.sendPath << "]";
+	}
+}
+
+bool FileTransfer::SendFile()
+{
+	const std::string& path = this->options.sendPath;
+	int fd                  = ::open(path.c_str(), O_RDONLY);
+
+	if (fd < 0)
+	{
+		BCST_ERROR << "unable to open file: " << std::strerror(errno);
+
+		return false;
+	}
+
+	struct stat st;
+
+	if (::fstat(fd, &st) != 0)
+	{
+		::close(fd);
+
+		return false;
+	}
+
+	auto size            = static_cast<uint64_t>(st.st_size);
+	const uint8_t* bytes = nullptr;
+
+	if (size > 0)
+	{
+		void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (mapped == MAP_FAILED)
+		{
+			BCST_ERROR << "unable to map file: " << std::strerror(errno);
+			::close(fd);
+
+			return false;
+		}
+
+		::madvise(mapped, size, MADV_SEQUENTIAL);
+		bytes = static_cast<const uint8_t*>(mapped);
+	}
+
+	// Descriptor no longer needed once mapped.
+	::close(fd);
+
+	uint32_t id      = std::random_device()();
+	std::string name = path.substr(path.find_last_of('/') + 1);
+
+	name.resize(std::min<size_t>(name.size(), UINT16_MAX));
+
+	BCST_INFO << "sending file [path:" << path << ", size:" << size
+	          << ", chunkSize:" << this->chunkSize << "]";
+
+	auto startedAt = steady_clock::now();
+	auto begin     = createMessage(kBegin, id, kBeginHeaderSize, name.size());
+
+	writeUint(begin.data() + kHeaderSize, size, 8);
+	writeUint(begin.data() + kHeaderSize + 8, this->chunkSize, 4);
+	writeUint(begin.data() + kHeaderSize + 12, name.size(), 2);
+	begin.AppendData(name.data(), name.size());
+
+	bool ok      = this->SendMessage(begin);
+	uint32_t crc = 0;
+
+	for (uint64_t offset = 0; ok && offset < size; offset += this->chunkSize)
+	{
+		size_t length = static_cast<size_t>(std::min<uint64_t>(this->chunkSize, size - offset));
+		auto chunk    = createMessage(kChunk, id, kChunkHeaderSize, length);
+
+		writeUint(chunk.data() + kHeaderSize, offset, 8);
+		chunk.AppendData(bytes + offset, length);
+		crc = Crc32(crc, bytes + offset, length);
+
+		ok = this->WaitForWindow(chunk.size()) && this->SendMessage(chunk);
+	}
+
+	if (ok)
+	{
+		auto end = createMessage(kEnd, id, kEndSize);
+
+		writeUint(end.data() + kHeaderSize, crc, 4);
+		ok = this->SendMessage(end);
+	}
+
+	if (bytes)
+		::munmap(const_cast<uint8_t*>(bytes), size);
+
+	if (ok)
+	{
+		BCST_INFO << "file sent [size:" << size << ", crc32:" << toHex(crc)
+		          << ", throughput:" << megabytesPerSecond(size, startedAt) << " MB/s]";
+	}
+
+	return ok;
+}
+
+bool FileTransfer::WaitForWindow(size_t size)
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	while (!this->stopping)
+	{
+		if (this->bufferedAmount + size <= this->options.windowSize)
+			return true;
+
+		// OnBufferedAmountChange() wakes us up, poll anyway in case it was missed.
+		this->cv.wait_for(lock, milliseconds(100));
+
+		lock.unlock();
+		uint64_t amount = this->dataProducer->GetBufferedAmount();
+		lock.lock();
+
+		this->bufferedAmount = amount;
+	}
+
+	return false;
+}
+
+bool FileTransfer::SendMessage(const rtc::CopyOnWriteBuffer& message)
+{
+	// The window keeps the buffered amount below the limit.
+	if (!DataChannelLimits::IsOpen(this->dataProducer))
+	{
+		BCST_ERROR << "unable to send file transfer message, DataChannel not open";
+
+		return false;
+	}
+
+	this->dataProducer->Send(webrtc::DataBuffer(message, true /* binary */));
+
+	// Until OnBufferedAmountChange() reports the actual amount.
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->bufferedAmount += message.size();
+
+	return true;
+}
+
+void FileTransfer::RunReceiver()
+{
+	rtc::CopyOnWriteBuffer data;
+
+	while (true)
+	{
+		while (this->incomingQueue.Pop(data))
+		{
+			this->Receive(data);
+		}
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		if (this->stopping)
+			break;
+
+		// OnMessage() doesn't take the lock, a missed wake up costs one timeout.
+		this->receiverCv.wait_for(lock, milliseconds(50));
+	}
+
+	if (this->incoming.fd >= 0)
+	{
+		BCST_WARN << "incomplete file transfer discarded [path:" << this->incoming.path << "]";
+
+		this->CloseIncoming();
+	}
+}
+
+void FileTransfer::Receive(const rtc::CopyOnWriteBuffer& data)
+{
+	if (data.size() < kHeaderSize)
+		return;
+
+	const uint8_t* message = data.cdata();
+	auto type              = message[0];
+	auto id                = static_cast<uint32_t>(readUint(message + 1, 4));
+
+	if (type == kBegin)
+	{
+		if (data.size() < kBeginHeaderSize)
+			return;
+
+		size_t nameLength = readUint(message + kHeaderSize + 12, 2);
+
+		if (data.size() < kBeginHeaderSize + nameLength)
+			return;
+
+		if (this->incoming.fd >= 0)
+		{
+			BCST_WARN << "file transfer interrupted [path:" << this->incoming.path << "]";
+
+			this->CloseIncoming();
+		}
+
+		// Never trust the remote name to pick a directory.
+		std::string name(reinterpret_cast<const char*>(message) + kBeginHeaderSize, nameLength);
+
+		name = name.substr(name.find_last_of('/') + 1);
+
+		if (name.empty() || name == "." || name == "..")
+			name = "transfer-" + std::to_string(id);
+
+		std::string path = this->options.outputDir + "/" + name;
+
+		// The loopback consumes our own DataProducer: the file being sent may be
+		// the one received.
+		if (!this->options.sendPath.empty() && sameFile(path, this->options.sendPath))
+		{
+			path += ".received";
+
+			BCST_WARN << "received file is the one being sent, renaming it [path:" << path << "]";
+		}
+
+		this->incoming.id        = id;
+		this->incoming.path      = path;
+		this->incoming.partPath  = path + "." + toHex(id) + ".part";
+		this->incoming.size      = readUint(message + kHeaderSize, 8);
+		this->incoming.received  = 0;
+		this->incoming.crc       = 0;
+		this->incoming.startedAt = steady_clock::now();
+		this->incoming.fd =
+		  ::open(this->incoming.partPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+		if (this->incoming.fd < 0)
+		{
+			BCST_ERROR << "unable to create file [path:" << this->incoming.partPath
+			           << ", error:" << std::strerror(errno) << "]";
+
+			this->incoming = Incoming();
+
+			return;
+		}
+
+		BCST_INFO << "receiving file [path:" << this->incoming.path
+		          << ", size:" << this->incoming.size << "]";
+
+		return;
+	}
+
+	if (this->incoming.fd < 0 || id != this->incoming.id)
+		return;
+
+	if (type == kChunk)
+	{
+		if (data.size() < kChunkHeaderSize)
+			return;
+
+		uint64_t offset        = readUint(message + kHeaderSize, 8);
+		const uint8_t* payload = message + kChunkHeaderSize;
+		size_t length          = data.size() - kChunkHeaderSize;
+
+		// The DataChannel is ordered, so the CRC can be computed on the fly.
+		if (offset != this->incoming.received || offset + length > this->incoming.size)
+		{
+			BCST_ERROR << "unexpected file chunk [offset:" << offset << "]";
+
+			this->CloseIncoming();
+
+			return;
+		}
+
+		while (length > 0)
+		{
+			ssize_t written = ::pwrite(this->incoming.fd, payload, length, static_cast<off_t>(offset));
+
+			if (written < 0 && errno == EINTR)
+				continue;
+
+			if (written <= 0)
+			{
+				BCST_ERROR << "unable to write file: " << std::strerror(errno);
+
+				this->CloseIncoming();
+
+				return;
+			}
+
+			this->incoming.crc = Crc32(this->incoming.crc, payload, written);
+			this->incoming.received += written;
+			payload += written;
+			offset += written;
+			length -= written;
+		}
+	}
+	else if (type == kEnd)
+	{
+		if (data.size() < kEndSize)
+			return;
+
+		auto crc = static_cast<uint32_t>(readUint(message + kHeaderSize, 4));
+
+		if (this->incoming.received != this->incoming.size || crc != this->incoming.crc)
+		{
+			BCST_ERROR << "file transfer corrupted [path:" << this->incoming.path
+			           << ", received:" << this->incoming.received << "/" << this->incoming.size
+			           << ", crc32:" << toHex(this->incoming.crc)
+			           << ", expected crc32:" << toHex(crc) << "]";
+		}
+		else if (::rename(this->incoming.partPath.c_str(), this->incoming.path.c_str()) != 0)
+		{
+			BCST_ERROR << "unable to rename '" << this->incoming.partPath << "' to '"
+			           << this->incoming.path << "': " << std::strerror(errno);
+		}
+		else
+		{
+			this->incoming.partPath.clear();
+
+			BCST_INFO << "file received [path:" << this->incoming.path
+			          << ", size:" << this->incoming.size << ", crc32:" << toHex(crc)
+			          << ", throughput:"
+			          << megabytesPerSecond(this->incoming.size, this->incoming.startedAt) << " MB/s]";
+		}
+
+		this->CloseIncoming();
+	}
+}
+
+void FileTransfer::CloseIncoming()
+{
+	if (this->incoming.fd >= 0)
+		::close(this->incoming.fd);
+
+	// Unless complete and renamed.
+	if (!this->incoming.partPath.empty())
+		::unlink(this->incoming.partPath.c_str());
+
+	this->incoming = Incoming();
+}
@@ -0,0 +1,58 @@
+#include "FrameCounter.hpp"
+#include <algorithm>
+
+using namespace std::chrono;
+
+void FrameCounter::OnFrame(size_t bytes, bool keyFrame, uint32_t width, uint32_t height)
+{
+	auto now = steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if (this->stats.frames > 0)
+	{
+		auto gap = now - this->lastFrame;
+
+		// Once there is an average to compare with.
+		if (this->gaps > 0)
+		{
+			auto averageGap = this->totalGap / this->gaps;
+
+			if (gap > std::max(3 * averageGap, averageGap + milliseconds(150)))
+			{
+				++this->stats.freezes;
+				this->stats.totalFreezeMs += duration_cast<milliseconds>(gap).count();
+			}
+		}
+
+		this->totalGap += gap;
+		++this->gaps;
+	}
+
+	++this->stats.frames;
+	this->stats.bytes += bytes;
+	this->lastFrame = now;
+
+	if (keyFrame)
+		++this->stats.keyFrames;
+
+	if (width > 0 && height > 0)
+	{
+		this->stats.width  = width;
+		this->stats.height = height;
+	}
+}
+
+FrameCounter::Stats FrameCounter::GetStats()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	// The average of this interval weighs as a single gap in the next one.
+	if (this->gaps > 1)
+	{
+		this->totalGap /= this->gaps;
+		this->gaps = 1;
+	}
+
+	return this->stats;
+}
@@ -0,0 +1,174 @@
+#include "FrameStamp.hpp"
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	constexpr uint8_t kSync  = 0xA5;
+	constexpr uint8_t kBlack = 16;
+	constexpr uint8_t kWhite = 235;
+	constexpr size_t kBytes  = FrameStamp::kColumns * FrameStamp::kRows / 8;
+	// 40 bits.
+	constexpr uint64_t kTimestampMask = (uint64_t{ 1 } << 40) - 1;
+
+	// CRC-8, polynomial 0x07.
+	uint8_t crc8(const uint8_t* data, size_t size)
+	{
+		uint8_t crc = 0;
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			crc ^= data[i];
+
+			for (int bit = 0; bit < 8; ++bit)
+			{
+				crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+			}
+		}
+
+		return crc;
+	}
+
+	bool fits(int width, int height)
+	{
+		return width >= FrameStamp::kGrid * 2 &&
+		       FrameStamp::kRows * width / FrameStamp::kGrid <= height;
+	}
+
+	// Pixel bounds of a block, in a plane |scale| times smaller than the frame.
+	void blockBounds(int index, int width, int scale, int& x0, int& x1, int& y0, int& y1)
+	{
+		int column = index % FrameStamp::kColumns;
+		int row    = index / FrameStamp::kColumns;
+
+		x0 = column * width / FrameStamp::kGrid / scale;
+		x1 = (column + 1) * width / FrameStamp::kGrid / scale;
+		y0 = row * width / FrameStamp::kGrid / scale;
+		y1 = (row + 1) * width / FrameStamp::kGrid / scale;
+	}
+} // namespace
+
+uint64_t FrameStamp::NowMs()
+{
+	using namespace std::chrono;
+
+	return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+int64_t FrameStamp::LatencyMs(const Stamp& stamp, uint64_t nowMs)
+{
+	// Only the low 40 bits of the timestamp are stamped.
+	uint64_t elapsed = (nowMs - stamp.timestampMs) & kTimestampMask;
+
+	// Negative if the sender clock is ahead.
+	if (elapsed > kTimestampMask / 2)
+		return static_cast<int64_t>(elapsed) - static_cast<int64_t>(kTimestampMask) - 1;
+
+	return static_cast<int64_t>(elapsed);
+}
+
+bool FrameStamp::Write(
+  const Stamp& stamp,
+  uint8_t* dataY,
+  int strideY,
+  uint8_t* dataU,
+  int strideU,
+  uint8_t* dataV,
+  int strideV,
+  int width,
+  int height)
+{
+	if (!fits(width, height))
+		return false;
+
+	uint8_t bytes[kBytes];
+
+	bytes[0] = kSync;
+
+	for (int i = 0; i < 5; ++i)
+	{
+		bytes[1 + i] = static_cast<uint8_t>(stamp.timestampMs >> (8 * (4 - i)));
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		bytes[6 + i] = static_cast<uint8_t>(stamp.frameNumber >> (8 * (2 - i)));
+	}
+
+	bytes[9] = crc8(bytes, 9);
+
+	int x0, x1, y0, y1;
+
+	for (int index = 0; index < kColumns * kRows; ++index)
+	{
+		bool bit = (bytes[index / 8] >> (7 - index % 8)) & 1;
+
+		blockBounds(index, width, 1, x0, x1, y0, y1);
+
+		for (int y = y0; y < y1; ++y)
+		{
+			std::memset(dataY + y * strideY + x0, bit ? kWhite : kBlack, x1 - x0);
+		}
+
+		// Neutral chroma, for pure black and white.
+		blockBounds(index, width, 2, x0, x1, y0, y1);
+
+		for (int y = y0; y < y1; ++y)
+		{
+			std::memset(dataU + y * strideU + x0, 128, x1 - x0);
+			std::memset(dataV + y * strideV + x0, 128, x1 - x0);
+		}
+	}
+
+	return true;
+}
+
+bool FrameStamp::Read(const uint8_t* dataY, int strideY, int width, int height, Stamp& stamp)
+{
+	if (!fits(width, height))
+		return false;
+
+	uint8_t bytes[kBytes]{};
+	int x0, x1, y0, y1;
+
+	for (int index = 0; index < kColumns * kRows; ++index)
+	{
+		blockBounds(index, width, 1, x0, x1, y0, y1);
+
+		// The center half, away from the ringing at the block edges.
+		int marginX    = (x1 - x0) / 4;
+		int marginY    = (y1 - y0) / 4;
+		uint32_t sum   = 0;
+		uint32_t count = 0;
+
+		for (int y = y0 + marginY; y < y1 - marginY; ++y)
+		{
+			for (int x = x0 + marginX; x < x1 - marginX; ++x)
+			{
+				sum += dataY[y * strideY + x];
+				++count;
+			}
+		}
+
+		if (count > 0 && sum / count > (kBlack + kWhite) / 2)
+			bytes[index / 8] |= static_cast<uint8_t>(1 << (7 - index % 8));
+	}
+
+	if (bytes[0] != kSync || bytes[9] != crc8(bytes, 9))
+		return false;
+
+	stamp.timestampMs = 0;
+	stamp.frameNumber = 0;
+
+	for (int i = 0; i < 5; ++i)
+	{
+		stamp.timestampMs = (stamp.timestampMs << 8) | bytes[1 + i];
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		stamp.frameNumber = (stamp.frameNumber << 8) | bytes[6 + i];
+	}
+
+	return true;
+}
@@ -0,0 +1,405 @@
+#include "FrameTracer.hpp"
+#include "AsyncLogger.hpp"
+#include "rtc_base/time_utils.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <pthread.h>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace
+{
+	using TracePoint = webrtc::test::TestVideoCapturer::FrameTraceObserver::Point;
+
+	// Frames are reported once this old, by then all their events were recorded.
+	constexpr int64_t kFinalizeDelayMs = 1000;
+
+	/* Single producer ring. Each slot is a seqlock so that the exporter never
+	 * reads an event being overwritten.
+	 */
+	struct Ring
+	{
+		struct Slot
+		{
+			std::atomic<uint64_t> sequence{ 0 };
+			std::atomic<int64_t> timeUs{ 0 };
+			// Capture time (ms) << 16 | point << 8 | layer.
+			std::atomic<uint64_t> event{ 0 };
+		};
+
+		Ring(uint32_t id, std::string name) : id(id), name(std::move(name))
+		{
+		}
+
+		const uint32_t id;
+		const std::string name;
+		std::atomic<uint64_t> head{ 0 };
+		std::array<Slot, FrameTracer::kRingSize> slots;
+		// Exporter thread only.
+		uint64_t readIndex{ 0 };
+	};
+
+	std::atomic<bool> enabled{ false };
+	std::mutex ringsMutex;
+	std::vector<std::shared_ptr<Ring>> rings;
+
+	Ring* threadRing()
+	{
+		// Rings outlive their thread so that its last events can be collected.
+		thread_local std::shared_ptr<Ring> ring;
+
+		if (!ring)
+		{
+			char name[64] = "";
+
+			pthread_getname_np(pthread_self(), name, sizeof(name));
+
+			std::lock_guard<std::mutex> lock(ringsMutex);
+
+			ring = std::make_shared<Ring>(static_cast<uint32_t>(rings.size() + 1), name);
+			rings.push_back(ring);
+		}
+
+		return ring.get();
+	}
+
+	class CapturerObserver : public webrtc::test::TestVideoCapturer::FrameTraceObserver
+	{
+	public:
+		void OnTracePoint(Point point, int64_t captureTimeUs) override
+		{
+			FrameTracer::Point tracePoint;
+
+			switch (point)
+			{
+				case TracePoint::kCaptureStart:
+					tracePoint = FrameTracer::kCaptureStart;
+					break;
+				case TracePoint::kCaptureEnd:
+					tracePoint = FrameTracer::kCaptureEnd;
+					break;
+				case TracePoint::kAdaptStart:
+					tracePoint = FrameTracer::kAdaptStart;
+					break;
+				case TracePoint::kAdaptEnd:
+					tracePoint = FrameTracer::kAdaptEnd;
+					break;
+				case TracePoint::kDropped:
+					tracePoint = FrameTracer::kDropped;
+					break;
+				default:
+					return;
+			}
+
+			FrameTracer::Record(tracePoint, captureTimeUs / 1000);
+		}
+	};
+} // namespace
+
+void FrameTracer::Record(Point point, int64_t captureTimeMs, uint8_t layer)
+{
+	if (!enabled.load(std::memory_order_relaxed))
+		return;
+
+	Ring* ring     = threadRing();
+	uint64_t index = ring->head.load(std::memory_order_relaxed);
+	auto& slot     = ring->slots[index % kRingSize];
+
+	slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.timeUs.store(rtc::TimeMicros(), std::memory_order_relaxed);
+	slot.event.store(
+	  static_cast<uint64_t>(captureTimeMs) << 16 | static_cast<uint64_t>(point) << 8 | layer,
+	  std::memory_order_relaxed);
+	slot.sequence.store(2 * index + 2, std::memory_order_release);
+	ring->head.store(index + 1, std::memory_order_release);
+}
+
+webrtc::test::TestVideoCapturer::FrameTraceObserver* FrameTracer::GetCapturerObserver()
+{
+	static CapturerObserver observer;
+
+	return &observer;
+}
+
+FrameTracer::FrameTracer(const Options& options) : options(options)
+{
+	if (this->options.exportIntervalSeconds == 0)
+		this->options.exportIntervalSeconds = 1;
+
+	if (!this->options.traceFile.empty())
+	{
+		this->traceStream.open(this->options.traceFile, std::ios::out | std::ios::trunc);
+
+		if (!this->traceStream)
+		{
+			BCST_ERROR << "unable to open frame trace file '" << this->options.traceFile << "'";
+		}
+	}
+}
+
+FrameTracer::~FrameTracer()
+{
+	this->Stop();
+}
+
+void FrameTracer::Start()
+{
+	BCST_INFO << "FrameTracer::Start() [exportInterval:" << this->options.exportIntervalSeconds
+	          << "s]";
+
+	// The closing ']' is optional in the Chrome trace format, so the file can be
+	// loaded even if the process never stops cleanly.
+	if (this->traceStream.is_open())
+	{
+		this->traceStream
+		  << "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"broadcaster\"}}";
+	}
+
+	enabled = true;
+
+	this->thread = std::thread(&FrameTracer::Run, this);
+}
+
+void FrameTracer::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if (this->stopping)
+			return;
+
+		this->stopping = true;
+	}
+
+	this->cv.notify_all();
+
+	if (!this->thread.joinable())
+		return;
+
+	this->thread.join();
+
+	enabled = false;
+
+	// Report whatever is left.
+	this->Collect();
+
+	for (const auto& kv : this->pending)
+	{
+		this->Finalize(kv.first, kv.second);
+	}
+
+	this->pending.clear();
+	this->Export();
+
+	if (this->traceStream.is_open())
+	{
+		this->traceStream << "\n]\n";
+		this->traceStream.close();
+	}
+}
+
+void FrameTracer::Run()
+{
+	const auto interval = seconds(this->options.exportIntervalSeconds);
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			if (this->cv.wait_for(lock, interval, [this] { return this->stopping; }))
+				break;
+		}
+
+		this->Collect();
+
+		int64_t deadline = rtc::TimeMillis() - kFinalizeDelayMs;
+
+		while (!this->pending.empty() && this->pending.begin()->first < deadline)
+		{
+			this->Finalize(this->pending.begin()->first, this->pending.begin()->second);
+			this->pending.erase(this->pending.begin());
+		}
+
+		this->Export();
+	}
+}
+
+void FrameTracer::Collect()
+{
+	std::vector<std::shared_ptr<Ring>> snapshot;
+
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+
+		snapshot = rings;
+	}
+
+	for (auto& ring : snapshot)
+	{
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+
+		if (head - ring->readIndex > kRingSize)
+		{
+			this->lostEvents += head - ring->readIndex - kRingSize;
+			ring->readIndex = head - kRingSize;
+		}
+
+		if (this->traceStream.is_open() && this->namedThreads.insert(ring->id).second)
+		{
+			this->traceStream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+			                  << ring->id << ",\"args\":{\"name\":\"" << ring->name << "\"}}";
+		}
+
+		for (; ring->readIndex < head; ++ring->readIndex)
+		{
+			auto& slot        = ring->slots[ring->readIndex % kRingSize];
+			uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			int64_t timeUs    = slot.timeUs.load(std::memory_order_relaxed);
+			uint64_t event    = slot.event.load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			// Overwritten by the producer while being read.
+			if (
+			  sequence != 2 * ring->readIndex + 2 ||
+			  slot.sequence.load(std::memory_order_relaxed) != sequence)
+			{
+				++this->lostEvents;
+
+				continue;
+			}
+
+			auto captureTimeMs = static_cast<int64_t>(event >> 16);
+			auto point         = static_cast<Point>((event >> 8) & 0xFF);
+			size_t layer       = std::min<size_t>(event & 0xFF, kMaxLayers - 1);
+
+			if (point >= kPointCount)
+				continue;
+
+			Frame& frame = this->pending[captureTimeMs];
+
+			if (point == kEncodeEnd)
+			{
+				frame.encodeEnd[layer] = timeUs;
+			}
+			else if (point == kPacketized)
+			{
+				frame.packetized[layer] = timeUs;
+			}
+			else
+			{
+				frame.times[point] = timeUs;
+			}
+
+			frame.threads[point] = ring->id;
+		}
+	}
+}
+
+void FrameTracer::Finalize(int64_t captureTimeMs, const Frame& frame)
+{
+	const int64_t* times = frame.times;
+
+	if (times[kDropped])
+	{
+		++this->dropped;
+
+		return;
+	}
+
+	if (!times[kCaptureStart])
+		return;
+
+	++this->frames;
+
+	int spanLayer = -1;
+
+	// Records the span in |histogram| and the trace file if both ends were traced.
+	auto span =
+	  [&](Histogram& histogram, const char* name, Point endPoint, int64_t start, int64_t end) {
+		  if (!start || !end)
+			  return;
+
+		  histogram.Record(static_cast<uint64_t>(std::max<int64_t>(end - start, 0)));
+		  this->WriteSpan(name, captureTimeMs, frame.threads[endPoint], start, end, spanLayer);
+	  };
+
+	span(this->capture, "capture", kCaptureEnd, times[kCaptureStart], times[kCaptureEnd]);
+	span(this->adapt, "adapt", kAdaptEnd, times[kAdaptStart], times[kAdaptEnd]);
+	span(this->queue, "queue", kEncodeStart, times[kAdaptEnd], times[kEncodeStart]);
+
+	int64_t lastPacketized = 0;
+
+	for (size_t layer = 0; layer < kMaxLayers; ++layer)
+	{
+		int64_t encodeEnd  = frame.encodeEnd[layer];
+		int64_t packetized = frame.packetized[layer];
+
+		spanLayer = static_cast<int>(layer);
+		span(this->encode, "encode", kEncodeEnd, times[kEncodeStart], encodeEnd);
+		span(this->packetize, "packetize", kPacketized, encodeEnd, packetized);
+
+		if (encodeEnd && packetized)
+			lastPacketized = std::max(lastPacketized, packetized);
+	}
+
+	// Glass to wire, as far as the pacer queue.
+	if (lastPacketized)
+	{
+		this->total.Record(
+		  static_cast<uint64_t>(std::max<int64_t>(lastPacketized - times[kCaptureStart], 0)));
+	}
+}
+
+void FrameTracer::WriteSpan(
+  const char* name,
+  int64_t captureTimeMs,
+  uint32_t thread,
+  int64_t start,
+  int64_t end,
+  int layer)
+{
+	if (!this->traceStream.is_open())
+		return;
+
+	// Complete events on the thread that ended the span, tied together by the
+	// frame capture time.
+	this->traceStream << ",\n{\"name\":\"" << name << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1"
+	                  << ",\"tid\":" << thread << ",\"ts\":" << start << ",\"dur\":" << end - start
+	                  << ",\"args\":{\"frame\":" << captureTimeMs;
+
+	if (layer >= 0)
+		this->traceStream << ",\"layer\":" << layer;
+
+	this->traceStream << "}}";
+}
+
+void FrameTracer::Export()
+{
+	BCST_INFO << "frame trace [frames:" << this->frames << ", dropped:" << this->dropped
+	          << ", lostEvents:" << this->lostEvents << "]"
+	          << "\n  capture(ms):   " << this->capture.ToString(1000)
+	          << "\n  adapt(ms):     " << this->adapt.ToString(1000)
+	          << "\n  queue(ms):     " << this->queue.ToString(1000)
+	          << "\n  encode(ms):    " << this->encode.ToString(1000)
+	          << "\n  packetize(ms): " << this->packetize.ToString(1000)
+	          << "\n  total(ms):     " << this->total.ToString(1000);
+
+	if (this->traceStream.is_open())
+		this->traceStream.flush();
+
+	this->frames     = 0;
+	this->dropped    = 0;
+	this->lostEvents = 0;
+	this->capture.Reset();
+	this->adapt.Reset();
+	this->queue.Reset();
+	this->encode.Reset();
+	this->packetize.Reset();
+	this->total.Reset();
+}
@@ -0,0 +1,99 @@
+#include "Histogram.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+size_t Histogram::BucketIndex(uint64_t value)
+{
+	if (value < kSubBuckets)
+		return static_cast<size_t>(value);
+
+	size_t msb   = 63 - static_cast<size_t>(__builtin_clzll(value));
+	size_t shift = msb - kSubBucketBits;
+	size_t sub   = static_cast<size_t>(value >> shift) & (kSubBuckets - 1);
+
+	return (shift + 1) * kSubBuckets + sub;
+}
+
+uint64_t Histogram::BucketUpperBound(size_t index)
+{
+	if (index < kSubBuckets)
+		return index;
+
+	size_t shift   = index / kSubBuckets - 1;
+	uint64_t sub   = index % kSubBuckets;
+	uint64_t lower = (kSubBuckets + sub) << shift;
+
+	return lower + ((uint64_t{ 1 } << shift) - 1);
+}
+
+void Histogram::Record(uint64_t value)
+{
+	++this->buckets[BucketIndex(value)];
+	++this->count;
+	this->sum += value;
+	this->min = std::min(this->min, value);
+	this->max = std::max(this->max, value);
+}
+
+void Histogram::Merge(const Histogram& other)
+{
+	for (size_t i = 0; i < kBuckets; ++i)
+	{
+		this->buckets[i] += other.buckets[i];
+	}
+
+	this->count += other.count;
+	this->sum += other.sum;
+	this->min = std::min(this->min, other.min);
+	this->max = std::max(this->max, other.max);
+}
+
+void Histogram::Reset()
+{
+	*this = Histogram();
+}
+
+uint64_t Histogram::Percentile(double percentile) const
+{
+	if (this->count == 0)
+		return 0;
+
+	if (percentile <= 0)
+		return this->min;
+
+	auto rank = static_cast<uint64_t>(std::ceil(percentile / 100 * this->count));
+
+	rank = std::max<uint64_t>(1, std::min(rank, this->count));
+
+	uint64_t seen = 0;
+
+	for (size_t i = 0; i < kBuckets; ++i)
+	{
+		seen += this->buckets[i];
+
+		if (seen >= rank)
+			return std::min(std::max(BucketUpperBound(i), this->min), this->max);
+	}
+
+	return this->max;
+}
+
+std::string Histogram::ToString(double divisor) const
+{
+	char buffer[256];
+
+	std::snprintf(
+	  buffer,
+	  sizeof(buffer),
+	  "count:%llu min:%.2f p50:%.2f p90:%.2f p99:%.2f p999:%.2f max:%.2f",
+	  static_cast<unsigned long long>(this->count),
+	  this->Min() / divisor,
+	  this->Percentile(50) / divisor,
+	  this->Percentile(90) / divisor,
+	  this->Percentile(99) / divisor,
+	  this->Percentile(99.9) / divisor,
+	  this->Max() / divisor);
+
+	return buffer;
+}
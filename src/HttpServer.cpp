@@ -0,0 +1,262 @@
+#include "HttpServer.hpp"
+#include "AsyncLogger.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <utility>
+
+namespace
+{
+	const char* statusText(int status)
+	{
+		switch (status)
+		{
+			case 200:
+				return "OK";
+			case 400:
+				return "Bad Request";
+			case 404:
+				return "Not Found";
+			case 405:
+				return "Method Not Allowed";
+			case 413:
+				return "Payload Too Large";
+			case 500:
+				return "Internal Server Error";
+			default:
+				return "Unknown";
+		}
+	}
+
+	bool sendAll(int fd, const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+
+			if (sent < 0 && errno == EINTR)
+				continue;
+
+			if (sent <= 0)
+				return false;
+
+			data += sent;
+			size -= sent;
+		}
+
+		return true;
+	}
+
+	void sendResponse(int fd, const HttpServer::Response& response)
+	{
+		std::string head = "HTTP/1.1 " + std::to_string(response.status) + " " +
+		                   statusText(response.status) + "\r\nContent-Type: " + response.contentType +
+		                   "\r\nContent-Length: " + std::to_string(response.body.size()) +
+		                   "\r\nConnection: close\r\n\r\n";
+
+		if (sendAll(fd, head.data(), head.size()))
+			sendAll(fd, response.body.data(), response.body.size());
+	}
+} // namespace
+
+HttpServer::HttpServer(Handler handler) : handler(std::move(handler))
+{
+}
+
+HttpServer::~HttpServer()
+{
+	this->Stop();
+}
+
+bool HttpServer::Start(const std::string& host, uint16_t port)
+{
+	sockaddr_in addr{};
+
+	addr.sin_family = AF_INET;
+	addr.sin_port   = htons(port);
+
+	if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1)
+	{
+		BCST_ERROR << "invalid HTTP server address '" << host << "'";
+
+		return false;
+	}
+
+	this->listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (this->listenFd < 0)
+		return false;
+
+	int reuse = 1;
+
+	::setsockopt(this->listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	socklen_t addrLen = sizeof(addr);
+
+	if (
+	  ::bind(this->listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+	  ::listen(this->listenFd, 16) != 0 ||
+	  ::getsockname(this->listenFd, reinterpret_cast<sockaddr*>(&addr), &addrLen) != 0)
+	{
+		BCST_ERROR << "unable to listen on " << host << ":" << port << ": " << std::strerror(errno);
+
+		::close(this->listenFd);
+		this->listenFd = -1;
+
+		return false;
+	}
+
+	this->port   = ntohs(addr.sin_port);
+	this->thread = std::thread(&HttpServer::Run, this);
+
+	return true;
+}
+
+void HttpServer::Stop()
+{
+	this->stopping = true;
+
+	if (this->thread.joinable())
+		this->thread.join();
+
+	if (this->listenFd >= 0)
+	{
+		::close(this->listenFd);
+		this->listenFd = -1;
+	}
+}
+
+void HttpServer::Run()
+{
+	pollfd pfd{ this->listenFd, POLLIN, 0 };
+
+	while (!this->stopping)
+	{
+		// Wake up periodically to check |stopping|.
+		if (::poll(&pfd, 1, 200) <= 0)
+			continue;
+
+		int fd = ::accept4(this->listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+
+		if (fd < 0)
+			continue;
+
+		// Don't let a stalled client block the server.
+		timeval timeout{ 2, 0 };
+
+		::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		this->Serve(fd);
+		::close(fd);
+	}
+}
+
+void HttpServer::Serve(int fd)
+{
+	std::string data;
+	size_t headerEnd;
+	char buffer[4096];
+
+	while ((headerEnd = data.find("\r\n\r\n")) == std::string::npos)
+	{
+		if (data.size() > kMaxHeaderSize)
+		{
+			sendResponse(fd, { 413, "text/plain", "header too large\n" });
+
+			return;
+		}
+
+		ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+
+		if (received < 0 && errno == EINTR)
+			continue;
+
+		if (received <= 0)
+			return;
+
+		data.append(buffer, received);
+	}
+
+	Request request;
+	size_t contentLength = 0;
+	size_t lineEnd       = data.find("\r\n");
+	std::string line     = data.substr(0, lineEnd);
+	size_t methodEnd     = line.find(' ');
+	size_t targetEnd     = line.find(' ', methodEnd + 1);
+
+	if (methodEnd == std::string::npos || targetEnd == std::string::npos)
+	{
+		sendResponse(fd, { 400, "text/plain", "malformed request line\n" });
+
+		return;
+	}
+
+	request.method     = line.substr(0, methodEnd);
+	std::string target = line.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+	size_t queryStart  = target.find('?');
+
+	request.path = target.substr(0, queryStart);
+
+	if (queryStart != std::string::npos)
+		request.query = target.substr(queryStart + 1);
+
+	// Only Content-Length matters, the rest of the headers are ignored.
+	while (lineEnd < headerEnd)
+	{
+		size_t start = lineEnd + 2;
+
+		lineEnd = data.find("\r\n", start);
+		line    = data.substr(start, lineEnd - start);
+
+		static const char kContentLength[] = "content-length:";
+
+		if (::strncasecmp(line.c_str(), kContentLength, sizeof(kContentLength) - 1) == 0)
+			contentLength = std::strtoul(line.c_str() + sizeof(kContentLength) - 1, nullptr, 10);
+	}
+
+	if (contentLength > kMaxBodySize)
+	{
+		sendResponse(fd, { 413, "text/plain", "body too large\n" });
+
+		return;
+	}
+
+	request.body = data.substr(headerEnd + 4);
+
+	while (request.body.size() < contentLength)
+	{
+		ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+
+		if (received < 0 && errno == EINTR)
+			continue;
+
+		if (received <= 0)
+			return;
+
+		request.body.append(buffer, received);
+	}
+
+	request.body.resize(contentLength);
+
+	Response response;
+
+	try
+	{
+		response = this->handler(request);
+	}
+	catch (const std::exception& error)
+	{
+		response = { 500, "text/plain", std::string(error.what()) + "\n" };
+	}
+
+	sendResponse(fd, response);
+}
@@ -0,0 +1,119 @@
+#include "JoinBenchmark.hpp"
+#include "AsyncLogger.hpp"
+#include "Broadcaster.hpp"
+#include <chrono>
+#include <cpr/cpr.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using json = nlohmann::json;
+
+JoinBenchmark::JoinBenchmark(const Options& options) : options(options)
+{
+}
+
+bool JoinBenchmark::Run(
+  const std::string& baseUrl, bool enableAudio, bool useSimulcast, bool verifySsl)
+{
+	BCST_INFO << "running join benchmark [runs:" << this->options.runs << "]";
+
+	uint32_t failures = 0;
+
+	for (uint32_t run = 0; run < this->options.runs; ++run)
+	{
+		this->timer.BeginRun();
+
+		cpr::Response r;
+
+		{
+			JoinTimer::Scope joinScope(&this->timer, JoinTimer::kRoomGet);
+
+			r = cpr::GetAsync(cpr::Url{ baseUrl }, cpr::VerifySsl{ verifySsl }).get();
+		}
+
+		if (r.status_code != 200)
+		{
+			BCST_ERROR << "unable to retrieve room info"
+			           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
+
+			++failures;
+
+			continue;
+		}
+
+		auto routerRtpCapabilities = json::parse(r.text, nullptr, false);
+
+		if (routerRtpCapabilities.is_discarded())
+		{
+			BCST_ERROR << "invalid room info";
+
+			++failures;
+
+			continue;
+		}
+
+		// A new Broadcaster per run, so that every join starts from scratch.
+		Broadcaster broadcaster;
+
+		broadcaster.SetJoinTimer(&this->timer);
+
+		bool joined;
+
+		try
+		{
+			joined =
+			  broadcaster.Start(baseUrl, enableAudio, useSimulcast, routerRtpCapabilities, verifySsl);
+		}
+		catch (const std::exception& error)
+		{
+			BCST_ERROR << "join failed: " << error.what();
+
+			joined = false;
+		}
+
+		if (!joined)
+		{
+			++failures;
+
+			continue;
+		}
+
+		this->timer.RecordSinceBegin(JoinTimer::kJoin);
+
+		if (this->options.mediaTimeoutMs > 0)
+			broadcaster.WaitForMedia(std::chrono::milliseconds(this->options.mediaTimeoutMs));
+
+		// The Broadcaster leaves the room when destroyed.
+	}
+
+	BCST_INFO << "join benchmark results [runs:" << this->options.runs << ", failures:" << failures
+	          << "]";
+
+	// Line by line, the whole table exceeds the maximum log message size.
+	std::istringstream table(this->timer.ToTable());
+	std::string line;
+
+	while (std::getline(table, line))
+	{
+		BCST_INFO << line;
+	}
+
+	if (failures > 0)
+		return false;
+
+	if (this->options.maxJoinP95Ms > 0)
+	{
+		double joinP95Ms = this->timer.Percentile(JoinTimer::kJoin, 95) / 1000.0;
+
+		if (joinP95Ms > this->options.maxJoinP95Ms)
+		{
+			BCST_ERROR << "p95 join time above the limit [p95:" << joinP95Ms
+			           << "ms, limit:" << this->options.maxJoinP95Ms << "ms]";
+
+			return false;
+		}
+	}
+
+	return true;
+}
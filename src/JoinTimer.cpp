@@ -0,0 +1,132 @@
+#include "JoinTimer.hpp"
+#include "rtc_base/time_utils.h"
+#include <cstdio>
+
+JoinTimer::Scope::Scope(JoinTimer* timer, Phase phase)
+  : timer(timer), phase(phase), startUs(timer ? rtc::TimeMicros() : 0)
+{
+}
+
+JoinTimer::Scope::~Scope()
+{
+	if (this->timer)
+		this->timer->Record(this->phase, rtc::TimeMicros() - this->startUs);
+}
+
+void JoinTimer::Scope::Exclude(int64_t durationUs)
+{
+	this->startUs += durationUs;
+}
+
+const char* JoinTimer::GetPhaseName(Phase phase)
+{
+	switch (phase)
+	{
+		case kRoomGet:
+			return "room GET";
+		case kBroadcasterCreate:
+			return "broadcaster POST";
+		case kSendTransportCreate:
+			return "send transport create";
+		case kSendTransportConnect:
+			return "send transport connect";
+		case kAudioProduce:
+			return "audio produce";
+		case kVideoProduce:
+			return "video produce";
+		case kDataProduce:
+			return "data produce";
+		case kRecvTransportCreate:
+			return "recv transport create";
+		case kRecvTransportConnect:
+			return "recv transport connect";
+		case kDataConsume:
+			return "data consume";
+		case kJoin:
+			return "join (total)";
+		case kFirstRtp:
+			return "first RTP";
+		case kFirstSctp:
+			return "first SCTP";
+		default:
+			return "unknown";
+	}
+}
+
+void JoinTimer::BeginRun()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->runBeginUs = rtc::TimeMicros();
+}
+
+void JoinTimer::Record(Phase phase, int64_t durationUs)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->histograms[phase].Record(durationUs > 0 ? static_cast<uint64_t>(durationUs) : 0);
+}
+
+void JoinTimer::RecordSinceBegin(Phase phase)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	int64_t elapsedUs = rtc::TimeMicros() - this->runBeginUs;
+
+	this->histograms[phase].Record(elapsedUs > 0 ? static_cast<uint64_t>(elapsedUs) : 0);
+}
+
+void JoinTimer::RecordMissed(Phase phase)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	++this->missed[phase];
+}
+
+uint64_t JoinTimer::Percentile(Phase phase, double percentile)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	return this->histograms[phase].Percentile(percentile);
+}
+
+std::string JoinTimer::ToTable()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	std::string table;
+	char line[160];
+
+	std::snprintf(
+	  line,
+	  sizeof(line),
+	  "%-24s %6s %9s %9s %9s %9s %6s\n",
+	  "phase",
+	  "count",
+	  "p50 ms",
+	  "p90 ms",
+	  "p99 ms",
+	  "max ms",
+	  "missed");
+	table.append(line);
+
+	for (size_t i = 0; i < kPhaseCount; ++i)
+	{
+		const auto& histogram = this->histograms[i];
+
+		std::snprintf(
+		  line,
+		  sizeof(line),
+		  "%-24s %6llu %9.2f %9.2f %9.2f %9.2f %6llu\n",
+		  GetPhaseName(static_cast<Phase>(i)),
+		  static_cast<unsigned long long>(histogram.Count()),
+		  histogram.Percentile(50) / 1000.0,
+		  histogram.Percentile(90) / 1000.0,
+		  histogram.Percentile(99) / 1000.0,
+		  histogram.Max() / 1000.0,
+		  static_cast<unsigned long long>(this->missed[i]));
+		table.append(line);
+	}
+
+	return table;
+}
@@ -0,0 +1,211 @@
+#include "LatencyProbe.hpp"
+#include "AsyncLogger.hpp"
+#include "DataChannelLimits.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace std::chrono;
+
+namespace
+{
+	int64_t nowUs()
+	{
+		return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+} // namespace
+
+LatencyProbe::LatencyProbe(const Options& options) : options(options)
+{
+	if (this->options.intervalMs == 0)
+		this->options.intervalMs = 1;
+
+	if (this->options.exportIntervalSeconds == 0)
+		this->options.exportIntervalSeconds = 1;
+
+	if (!this->options.exportFile.empty())
+	{
+		this->exportStream.open(this->options.exportFile, std::ios::out | std::ios::app);
+
+		if (!this->exportStream)
+		{
+			BCST_ERROR << "unable to open latency probe export file '" << this->options.exportFile << "'";
+		}
+	}
+}
+
+LatencyProbe::~LatencyProbe()
+{
+	this->Stop();
+}
+
+void LatencyProbe::Start(mediasoupclient::DataProducer* dataProducer)
+{
+	BCST_INFO << "LatencyProbe::Start() [interval:" << this->options.intervalMs
+	          << "ms, timeout:" << this->options.timeoutMs << "ms]";
+
+	this->dataProducer = dataProducer;
+	this->thread       = std::thread(&LatencyProbe::Run, this);
+}
+
+void LatencyProbe::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->stopping = true;
+	}
+
+	this->cv.notify_all();
+
+	if (this->thread.joinable())
+		this->thread.join();
+}
+
+void LatencyProbe::OnMessage(const rtc::CopyOnWriteBuffer& data)
+{
+	int64_t receivedAt = nowUs();
+
+	if (data.size() != kProbeSize)
+		return;
+
+	const uint8_t* probe = data.cdata();
+	uint32_t magic;
+	uint64_t seq;
+	int64_t sentAt;
+
+	std::memcpy(&magic, probe, sizeof(magic));
+	std::memcpy(&seq, probe + 4, sizeof(seq));
+	std::memcpy(&sentAt, probe + 12, sizeof(sentAt));
+
+	if (magic != kMagic)
+		return;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	auto it = this->outstanding.find(seq);
+
+	// Already accounted as lost, or duplicated.
+	if (it == this->outstanding.end())
+	{
+		++this->late;
+
+		return;
+	}
+
+	this->outstanding.erase(it);
+
+	if (this->receivedAny && seq < this->highestReceivedSeq)
+		++this->reordered;
+	else
+		this->highestReceivedSeq = seq;
+
+	this->receivedAny = true;
+	++this->received;
+	this->rtt.Record(static_cast<uint64_t>(std::max<int64_t>(0, receivedAt - sentAt)));
+}
+
+void LatencyProbe::Run()
+{
+	const auto interval       = milliseconds(this->options.intervalMs);
+	const auto exportInterval = seconds(this->options.exportIntervalSeconds);
+	uint8_t probe[kProbeSize];
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	this->lastExport = steady_clock::now();
+	auto nextExport  = this->lastExport + exportInterval;
+	auto nextProbe   = this->lastExport;
+
+	while (!this->stopping)
+	{
+		auto now = steady_clock::now();
+
+		if (now >= nextExport)
+		{
+			this->Export(now);
+			nextExport += exportInterval;
+		}
+
+		if (now >= nextProbe)
+		{
+			uint32_t magic = kMagic;
+			uint64_t seq   = this->nextSeq++;
+			int64_t sentAt = nowUs();
+
+			std::memcpy(probe, &magic, sizeof(magic));
+			std::memcpy(probe + 4, &seq, sizeof(seq));
+			std::memcpy(probe + 12, &sentAt, sizeof(sentAt));
+
+			this->outstanding[seq] = sentAt;
+
+			lock.unlock();
+			bool ok = DataChannelLimits::IsOpen(this->dataProducer);
+
+			if (ok)
+			{
+				this->dataProducer->Send(
+				  webrtc::DataBuffer(rtc::CopyOnWriteBuffer(probe, kProbeSize), true /* binary */));
+			}
+			lock.lock();
+
+			if (ok)
+				++this->sent;
+			else
+				this->outstanding.erase(seq);
+
+			nextProbe += interval;
+
+			// Don't try to catch up after a stall.
+			if (nextProbe < now)
+				nextProbe = now + interval;
+		}
+
+		this->cv.wait_until(
+		  lock, std::min(nextProbe, nextExport), [this] { return this->stopping; });
+	}
+}
+
+void LatencyProbe::Export(steady_clock::time_point now)
+{
+	int64_t deadline = nowUs() - int64_t{ this->options.timeoutMs } * 1000;
+
+	for (auto it = this->outstanding.begin(); it != this->outstanding.end();)
+	{
+		if (it->second > deadline)
+			break;
+
+		++this->lost;
+		it = this->outstanding.erase(it);
+	}
+
+	double elapsed    = duration<double>(now - this->lastExport).count();
+	uint64_t expected = this->received + this->lost;
+	double lossPct    = expected ? 100.0 * this->lost / expected : 0;
+
+	BCST_INFO << "latency probe [sent:" << this->sent << ", received:" << this->received
+	          << ", lost:" << this->lost << " (" << lossPct << "%), reordered:" << this->reordered
+	          << ", late:" << this->late << ", rtt(ms):" << this->rtt.ToString(1000) << "]";
+
+	if (this->exportStream.is_open())
+	{
+		auto timestamp = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+
+		this->exportStream << "{\"timestamp\":" << timestamp.count() << ",\"interval\":" << elapsed
+		                   << ",\"sent\":" << this->sent
+		                   << ",\"received\":" << this->received << ",\"lost\":" << this->lost
+		                   << ",\"reordered\":" << this->reordered << ",\"late\":" << this->late
+		                   << ",\"rttP50\":" << this->rtt.Percentile(50) / 1000.0
+		                   << ",\"rttP99\":" << this->rtt.Percentile(99) / 1000.0
+		                   << ",\"rttP999\":" << this->rtt.Percentile(99.9) / 1000.0
+		                   << ",\"rttMax\":" << this->rtt.Max() / 1000.0 << "}\n";
+		this->exportStream.flush();
+	}
+
+	this->sent      = 0;
+	this->received  = 0;
+	this->lost      = 0;
+	this->reordered = 0;
+	this->late      = 0;
+	this->rtt.Reset();
+	this->lastExport = now;
+}
@@ -1,25 +1,69 @@
 #define MSC_CLASS "MediaStreamTrackFactory"
 
-#include <iostream>
-
+#include "AsyncLogger.hpp"
+#include "BatchingSocketServer.hpp"
+#include "ChirpMarker.hpp"
+#include "FrameStamp.hpp"
+#include "FrameTracer.hpp"
 #include "MediaSoupClientErrors.hpp"
 #include "MediaStreamTrackFactory.hpp"
+#include "RtcEventLogWriter.hpp"
+#include "StampingFrameGenerator.hpp"
+#include "TracingVideoEncoderFactory.hpp"
 #include "pc/test/fake_audio_capture_module.h"
 #include "pc/test/fake_periodic_video_track_source.h"
 #include "pc/test/frame_generator_capturer_video_track_source.h"
 #include "system_wrappers/include/clock.h"
 #include "api/audio_codecs/builtin_audio_decoder_factory.h"
 #include "api/audio_codecs/builtin_audio_encoder_factory.h"
-#include "api/create_peerconnection_factory.h"
+#include "api/call/call_factory_interface.h"
+#include "api/rtc_event_log/rtc_event_log_factory.h"
+#include "api/task_queue/default_task_queue_factory.h"
+#include "api/test/create_frame_generator.h"
 #include "api/video_codecs/builtin_video_decoder_factory.h"
 #include "api/video_codecs/builtin_video_encoder_factory.h"
+#include "media/engine/webrtc_media_engine.h"
+#include "modules/audio_processing/include/audio_processing.h"
+#include <utility>
 
 using namespace mediasoupclient;
 
 static rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> factory;
+static std::unique_ptr<webrtc::VideoEncoderFactory> videoEncoderFactory;
+static std::unique_ptr<webrtc::VideoDecoderFactory> videoDecoderFactory;
+
+// Feeds the fake audio device with ChirpMarkers rather than a constant value.
+class ChirpFrameSource : public FakeAudioCaptureModule::SendFrameSource
+{
+public:
+	void FillFrame(int16_t* samples, size_t numberOfSamples, int sampleRate) override
+	{
+		// Called from the audio device thread only.
+		if (!this->generator)
+			this->generator.reset(new ChirpMarker::Generator(sampleRate));
+
+		this->generator->Fill(samples, numberOfSamples, FrameStamp::NowMs());
+	}
+
+private:
+	std::unique_ptr<ChirpMarker::Generator> generator;
+};
+
+// Must outlive the audio device, which the factory holds until released.
+static std::unique_ptr<ChirpFrameSource> chirpFrameSource;
+
+// Wraps the factory if set.
+static RtcEventLogWriter* rtcEventLogWriter{ nullptr };
+
+// Socket server of the network thread if set.
+static std::unique_ptr<BatchingSocketServer::Options> udpBatchingOptions;
+
+// Wraps the video encoder factory if set.
+static bool encoderTracing{ false };
 
 /* MediaStreamTrack holds reference to the threads of the PeerConnectionFactory.
- * Use plain pointers in order to avoid threads being destructed before tracks.
+ * Use plain pointers in order to avoid threads being destructed before tracks,
+ * they are only destroyed by releasePeerConnectionFactory().
  */
 static rtc::Thread* networkThread;
 static rtc::Thread* signalingThread;
@@ -27,7 +71,18 @@ static rtc::Thread* workerThread;
 
 static void createFactory()
 {
-	networkThread   = rtc::Thread::Create().release();
+	// The network thread needs a socket server as the factory is also used for
+	// the PeerConnections of the transports.
+	if (udpBatchingOptions)
+	{
+		networkThread = new rtc::Thread(
+		  std::unique_ptr<rtc::SocketServer>(new BatchingSocketServer(*udpBatchingOptions)));
+	}
+	else
+	{
+		networkThread = rtc::Thread::CreateWithSocketServer().release();
+	}
+
 	signalingThread = rtc::Thread::Create().release();
 	workerThread    = rtc::Thread::Create().release();
 
@@ -48,17 +103,49 @@ static void createFactory()
 		MSC_THROW_INVALID_STATE_ERROR("audio capture module creation errored");
 	}
 
-	factory = webrtc::CreatePeerConnectionFactory(
-	  networkThread,
-	  workerThread,
-	  signalingThread,
-	  fakeAudioCaptureModule,
-	  webrtc::CreateBuiltinAudioEncoderFactory(),
-	  webrtc::CreateBuiltinAudioDecoderFactory(),
-	  webrtc::CreateBuiltinVideoEncoderFactory(),
-	  webrtc::CreateBuiltinVideoDecoderFactory(),
-	  nullptr /*audio_mixer*/,
-	  nullptr /*audio_processing*/);
+	if (chirpFrameSource)
+		fakeAudioCaptureModule->SetSendFrameSource(chirpFrameSource.get());
+
+	if (!videoEncoderFactory)
+		videoEncoderFactory = webrtc::CreateBuiltinVideoEncoderFactory();
+
+	if (encoderTracing)
+	{
+		videoEncoderFactory = std::unique_ptr<webrtc::VideoEncoderFactory>(
+		  new TracingVideoEncoderFactory(std::move(videoEncoderFactory)));
+	}
+
+	if (!videoDecoderFactory)
+		videoDecoderFactory = webrtc::CreateBuiltinVideoDecoderFactory();
+
+	// As webrtc::CreatePeerConnectionFactory() does, but with the event log
+	// factory made explicit: PeerConnections can't log events without one.
+	webrtc::PeerConnectionFactoryDependencies dependencies;
+
+	dependencies.network_thread     = networkThread;
+	dependencies.worker_thread      = workerThread;
+	dependencies.signaling_thread   = signalingThread;
+	dependencies.task_queue_factory = webrtc::CreateDefaultTaskQueueFactory();
+	dependencies.call_factory       = webrtc::CreateCallFactory();
+	dependencies.event_log_factory  = std::unique_ptr<webrtc::RtcEventLogFactoryInterface>(
+	  new webrtc::RtcEventLogFactory(dependencies.task_queue_factory.get()));
+
+	cricket::MediaEngineDependencies mediaDependencies;
+
+	mediaDependencies.task_queue_factory    = dependencies.task_queue_factory.get();
+	mediaDependencies.adm                   = fakeAudioCaptureModule;
+	mediaDependencies.audio_encoder_factory = webrtc::CreateBuiltinAudioEncoderFactory();
+	mediaDependencies.audio_decoder_factory = webrtc::CreateBuiltinAudioDecoderFactory();
+	mediaDependencies.audio_processing      = webrtc::AudioProcessingBuilder().Create();
+	mediaDependencies.video_encoder_factory = std::move(videoEncoderFactory);
+	mediaDependencies.video_decoder_factory = std::move(videoDecoderFactory);
+
+	dependencies.media_engine = cricket::CreateMediaEngine(std::move(mediaDependencies));
+
+	factory = webrtc::CreateModularPeerConnectionFactory(std::move(dependencies));
+
+	if (factory && rtcEventLogWriter)
+		factory = rtcEventLogWriter->WrapFactory(factory);
 
 	if (!factory)
 	{
@@ -66,6 +153,101 @@ static void createFactory()
 	}
 }
 
+webrtc::PeerConnectionFactoryInterface* getPeerConnectionFactory()
+{
+	if (!factory)
+		createFactory();
+
+	return factory.get();
+}
+
+void setVideoEncoderFactory(std::unique_ptr<webrtc::VideoEncoderFactory> encoderFactory)
+{
+	if (factory)
+	{
+		BCST_WARN << "peerconnection factory already created, video encoder factory ignored";
+
+		return;
+	}
+
+	videoEncoderFactory = std::move(encoderFactory);
+}
+
+void setVideoDecoderFactory(std::unique_ptr<webrtc::VideoDecoderFactory> decoderFactory)
+{
+	if (factory)
+	{
+		BCST_WARN << "peerconnection factory already created, video decoder factory ignored";
+
+		return;
+	}
+
+	videoDecoderFactory = std::move(decoderFactory);
+}
+
+void enableAudioChirps()
+{
+	if (factory)
+	{
+		BCST_WARN << "peerconnection factory already created, audio chirps ignored";
+
+		return;
+	}
+
+	chirpFrameSource.reset(new ChirpFrameSource());
+}
+
+void enableRtcEventLog(RtcEventLogWriter* writer)
+{
+	if (factory)
+	{
+		BCST_WARN << "peerconnection factory already created, RTC event log ignored";
+
+		return;
+	}
+
+	rtcEventLogWriter = writer;
+}
+
+void enableUdpBatching(const BatchingSocketServer::Options& options)
+{
+	if (factory)
+	{
+		BCST_WARN << "peerconnection factory already created, UDP batching ignored";
+
+		return;
+	}
+
+	udpBatchingOptions.reset(new BatchingSocketServer::Options(options));
+}
+
+void enableEncoderTracing()
+{
+	if (factory)
+	{
+		BCST_WARN << "peerconnection factory already created, encoder tracing ignored";
+
+		return;
+	}
+
+	encoderTracing = true;
+}
+
+void releasePeerConnectionFactory()
+{
+	// The factory is destroyed on the signaling thread, so before the threads.
+	factory = nullptr;
+
+	// rtc::Thread destructor stops (and joins) the thread.
+	delete signalingThread;
+	delete workerThread;
+	delete networkThread;
+
+	signalingThread = nullptr;
+	workerThread    = nullptr;
+	networkThread   = nullptr;
+}
+
 // Audio track creation.
 rtc::scoped_refptr<webrtc::AudioTrackInterface> createAudioTrack(const std::string& label)
 {
@@ -75,6 +257,15 @@ rtc::scoped_refptr<webrtc::AudioTrackInterface> createAudioTrack(const std::stri
 	cricket::AudioOptions options;
 	options.highpass_filter = false;
 
+	// The audio processing would attenuate the chirps, or cancel them as echo
+	// of the ones played out.
+	if (chirpFrameSource)
+	{
+		options.echo_cancellation = false;
+		options.auto_gain_control = false;
+		options.noise_suppression = false;
+	}
+
 	rtc::scoped_refptr<webrtc::AudioSourceInterface> source = factory->CreateAudioSource(options);
 
 	return factory->CreateAudioTrack(label, source);
@@ -92,16 +283,50 @@ rtc::scoped_refptr<webrtc::VideoTrackInterface> createVideoTrack(const std::stri
 	return factory->CreateVideoTrack(rtc::CreateRandomUuid(), videoTrackSource);
 }
 
-rtc::scoped_refptr<webrtc::VideoTrackInterface> createSquaresVideoTrack(const std::string& /*label*/)
+rtc::scoped_refptr<webrtc::VideoTrackInterface> createSquaresVideoTrack(
+  const std::string& /*label*/,
+  webrtc::test::FrameGeneratorCapturer** capturer,
+  bool timestampOverlay)
 {
 	if (!factory)
 		createFactory();
 
-	std::cout << "[INFO] getting frame generator" << std::endl;
-	auto* videoTrackSource = new rtc::RefCountedObject<webrtc::FrameGeneratorCapturerVideoTrackSource>(
-	  webrtc::FrameGeneratorCapturerVideoTrackSource::Config(), webrtc::Clock::GetRealTimeClock(), false);
+	BCST_INFO << "getting frame generator";
+	webrtc::FrameGeneratorCapturerVideoTrackSource* videoTrackSource;
+	webrtc::FrameGeneratorCapturerVideoTrackSource::Config config;
+
+	if (timestampOverlay)
+	{
+		// Outlives the capturers, which create their task queue from it.
+		static auto taskQueueFactory = webrtc::CreateDefaultTaskQueueFactory();
+
+		std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator(
+		  new StampingFrameGenerator(webrtc::test::CreateSquareFrameGenerator(
+		    config.width, config.height, absl::nullopt, config.num_squares_generated)));
+		std::unique_ptr<webrtc::test::FrameGeneratorCapturer> videoCapturer(
+		  new webrtc::test::FrameGeneratorCapturer(
+		    webrtc::Clock::GetRealTimeClock(),
+		    std::move(generator),
+		    config.frames_per_second,
+		    *taskQueueFactory));
+
+		videoCapturer->Init();
+
+		videoTrackSource = new rtc::RefCountedObject<webrtc::FrameGeneratorCapturerVideoTrackSource>(
+		  std::move(videoCapturer), false);
+	}
+	else
+	{
+		videoTrackSource = new rtc::RefCountedObject<webrtc::FrameGeneratorCapturerVideoTrackSource>(
+		  config, webrtc::Clock::GetRealTimeClock(), false);
+	}
+
+	videoTrackSource->capturer()->SetFrameTraceObserver(FrameTracer::GetCapturerObserver());
 	videoTrackSource->Start();
 
-	std::cout << "[INFO] creating video track" << std::endl;
+	if (capturer)
+		*capturer = videoTrackSource->capturer();
+
+	BCST_INFO << "creating video track";
 	return factory->CreateVideoTrack(rtc::CreateRandomUuid(), videoTrackSource);
 }
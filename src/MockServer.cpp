@@ -0,0 +1,618 @@
+#include "MockServer.hpp"
+#include "AsyncLogger.hpp"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace
+{
+	const char kAlphanumeric[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+	const char kHex[]          = "0123456789ABCDEF";
+
+	HttpServer::Response jsonResponse(const json& body)
+	{
+		return { 200, "application/json", body.dump() };
+	}
+
+	HttpServer::Response errorResponse(int status, const std::string& message)
+	{
+		return { status, "text/plain", message + "\n" };
+	}
+
+	std::vector<std::string> splitPath(const std::string& path)
+	{
+		std::vector<std::string> segments;
+		size_t start = 0;
+
+		while (start < path.size())
+		{
+			size_t end = path.find('/', start);
+
+			if (end == std::string::npos)
+				end = path.size();
+
+			if (end > start)
+				segments.push_back(path.substr(start, end - start));
+
+			start = end + 1;
+		}
+
+		return segments;
+	}
+
+	std::string queryParameter(const std::string& query, const std::string& name)
+	{
+		size_t start = 0;
+
+		while (start < query.size())
+		{
+			size_t end = query.find('&', start);
+
+			if (end == std::string::npos)
+				end = query.size();
+
+			if (query.compare(start, name.size() + 1, name + "=") == 0)
+				return query.substr(start + name.size() + 1, end - start - name.size() - 1);
+
+			start = end + 1;
+		}
+
+		return "";
+	}
+
+	json headerExtension(const char* kind, const char* uri, int preferredId, const char* direction)
+	{
+		/* clang-format off */
+		return
+		{
+			{ "kind",             kind        },
+			{ "uri",              uri         },
+			{ "preferredId",      preferredId },
+			{ "preferredEncrypt", false       },
+			{ "direction",        direction   }
+		};
+		/* clang-format on */
+	}
+
+	// What a mediasoup-demo router with its default media codecs returns.
+	const json& routerRtpCapabilities()
+	{
+		static const char kRidUri[]         = "urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id";
+		static const char kRepairedRidUri[] = "urn:ietf:params:rtp-hdrext:sdes:repaired-rtp-stream-id";
+		static const char kAbsSendTimeUri[] =
+		  "http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time";
+		static const char kTransportWideCcUri[] =
+		  "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01";
+
+		/* clang-format off */
+		static const json videoFeedback =
+		{
+			{ { "type", "nack"        }, { "parameter", ""     } },
+			{ { "type", "nack"        }, { "parameter", "pli"  } },
+			{ { "type", "ccm"         }, { "parameter", "fir"  } },
+			{ { "type", "goog-remb"   }, { "parameter", ""     } },
+			{ { "type", "transport-cc" }, { "parameter", ""    } }
+		};
+
+		static const json capabilities =
+		{
+			{ "codecs",
+				{
+					{
+						{ "kind",                 "audio"      },
+						{ "mimeType",             "audio/opus" },
+						{ "clockRate",            48000        },
+						{ "channels",             2            },
+						{ "preferredPayloadType", 100          },
+						{ "parameters",           json::object() },
+						{ "rtcpFeedback",         { { { "type", "transport-cc" }, { "parameter", "" } } } }
+					},
+					{
+						{ "kind",                 "video"     },
+						{ "mimeType",             "video/VP8" },
+						{ "clockRate",            90000       },
+						{ "preferredPayloadType", 101         },
+						{ "parameters",           json::object() },
+						{ "rtcpFeedback",         videoFeedback }
+					},
+					{
+						{ "kind",                 "video"     },
+						{ "mimeType",             "video/rtx" },
+						{ "clockRate",            90000       },
+						{ "preferredPayloadType", 102         },
+						{ "parameters",           { { "apt", 101 } } },
+						{ "rtcpFeedback",         json::array() }
+					},
+					{
+						{ "kind",                 "video"      },
+						{ "mimeType",             "video/H264" },
+						{ "clockRate",            90000        },
+						{ "preferredPayloadType", 103          },
+						{ "parameters",
+							{
+								{ "level-asymmetry-allowed", 1        },
+								{ "packetization-mode",      1        },
+								{ "profile-level-id",        "42e01f" }
+							}
+						},
+						{ "rtcpFeedback",         videoFeedback }
+					},
+					{
+						{ "kind",                 "video"     },
+						{ "mimeType",             "video/rtx" },
+						{ "clockRate",            90000       },
+						{ "preferredPayloadType", 104         },
+						{ "parameters",           { { "apt", 103 } } },
+						{ "rtcpFeedback",         json::array() }
+					}
+				}
+			},
+			{ "headerExtensions",
+				{
+					headerExtension("audio", "urn:ietf:params:rtp-hdrext:sdes:mid", 1, "sendrecv"),
+					headerExtension("video", "urn:ietf:params:rtp-hdrext:sdes:mid", 1, "sendrecv"),
+					headerExtension("video", kRidUri, 2, "recvonly"),
+					headerExtension("video", kRepairedRidUri, 3, "recvonly"),
+					headerExtension("audio", kAbsSendTimeUri, 4, "sendrecv"),
+					headerExtension("video", kAbsSendTimeUri, 4, "sendrecv"),
+					headerExtension("video", kTransportWideCcUri, 5, "sendrecv"),
+					headerExtension("audio", "urn:ietf:params:rtp-hdrext:ssrc-audio-level", 10, "sendrecv"),
+					headerExtension("video", "urn:3gpp:video-orientation", 11, "sendrecv"),
+					headerExtension("video", "urn:ietf:params:rtp-hdrext:toffset", 12, "sendrecv")
+				}
+			}
+		};
+		/* clang-format on */
+
+		return capabilities;
+	}
+} // namespace
+
+MockServer::MockServer(const Options& options)
+  : options(options),
+    server([this](const HttpServer::Request& request) { return this->Handle(request); }),
+    random(std::random_device()())
+{
+}
+
+MockServer::~MockServer()
+{
+	this->Stop();
+}
+
+bool MockServer::Start()
+{
+	if (!this->server.Start(this->options.host, this->options.port))
+		return false;
+
+	BCST_INFO << "MockServer::Start() [url:" << this->GetUrl() << "]";
+
+	return true;
+}
+
+void MockServer::Stop()
+{
+	this->server.Stop();
+}
+
+std::string MockServer::GetUrl() const
+{
+	return "http://" + this->options.host + ":" + std::to_string(this->server.GetPort());
+}
+
+HttpServer::Response MockServer::Handle(const HttpServer::Request& request)
+{
+	if (this->options.rttMs > 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(this->options.rttMs));
+
+	auto segments = splitPath(request.path);
+
+	if (segments.size() < 2 || segments[0] != "rooms")
+		return errorResponse(404, "not found");
+
+	json body;
+
+	if (request.method == "POST")
+	{
+		body = json::parse(request.body, nullptr, false);
+
+		if (body.is_discarded() || !body.is_object())
+			return errorResponse(400, "request body must be a JSON object");
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	const std::string& roomId = segments[1];
+	// Rooms are created on demand, as the real server does.
+	auto& broadcasters = this->rooms[roomId];
+
+	// /rooms/:roomId
+	if (segments.size() == 2)
+	{
+		if (request.method != "GET")
+			return errorResponse(405, "method not allowed");
+
+		return jsonResponse(routerRtpCapabilities());
+	}
+
+	if (segments[2] != "broadcasters")
+		return errorResponse(404, "not found");
+
+	// /rooms/:roomId/broadcasters
+	if (segments.size() == 3)
+	{
+		if (request.method != "POST")
+			return errorResponse(405, "method not allowed");
+
+		return this->CreateBroadcaster(roomId, body);
+	}
+
+	auto it = broadcasters.find(segments[3]);
+
+	if (it == broadcasters.end())
+		return errorResponse(404, "broadcaster with id \"" + segments[3] + "\" not found");
+
+	Broadcaster& broadcaster = it->second;
+
+	// /rooms/:roomId/broadcasters/:broadcasterId
+	if (segments.size() == 4)
+	{
+		if (request.method != "DELETE")
+			return errorResponse(405, "method not allowed");
+
+		broadcasters.erase(it);
+
+		BCST_INFO << "MockServer: broadcaster deleted [id:" << segments[3] << "]";
+
+		return jsonResponse(json::object());
+	}
+
+	if (segments[4] != "transports" || request.method != "POST")
+		return errorResponse(404, "not found");
+
+	// /rooms/:roomId/broadcasters/:broadcasterId/transports
+	if (segments.size() == 5)
+		return jsonResponse(this->CreateTransport(broadcaster));
+
+	// /rooms/:roomId/broadcasters/:broadcasterId/transports/:transportId/...
+	std::string action;
+
+	for (size_t i = 6; i < segments.size(); ++i)
+	{
+		action += (action.empty() ? "" : "/") + segments[i];
+	}
+
+	if (action == "consume")
+	{
+		auto transport = broadcaster.transports.find(segments[5]);
+
+		if (transport == broadcaster.transports.end())
+			return errorResponse(404, "transport with id \"" + segments[5] + "\" not found");
+
+		return this->Consume(
+		  broadcasters, transport->second, queryParameter(request.query, "producerId"));
+	}
+
+	return this->HandleTransport(broadcaster, segments[5], action, body);
+}
+
+HttpServer::Response MockServer::CreateBroadcaster(const std::string& roomId, const json& body)
+{
+	auto id = body.find("id");
+
+	if (id == body.end() || !id->is_string())
+		return errorResponse(400, "missing body.id");
+
+	auto displayName = body.find("displayName");
+
+	if (displayName == body.end() || !displayName->is_string())
+		return errorResponse(400, "missing body.displayName");
+
+	auto device = body.find("device");
+
+	if (device == body.end() || !device->is_object() || !device->count("name"))
+		return errorResponse(400, "missing body.device.name");
+
+	auto& broadcasters = this->rooms[roomId];
+	auto broadcasterId = id->get<std::string>();
+
+	if (broadcasters.count(broadcasterId))
+		return errorResponse(500, "broadcaster with id \"" + broadcasterId + "\" already exists");
+
+	// The other broadcasters are the peers of the room, with their producers.
+	json peers = json::array();
+
+	for (const auto& kv : broadcasters)
+	{
+		json producers = json::array();
+
+		for (const auto& transport : kv.second.transports)
+		{
+			for (const auto& producer : transport.second.producers)
+			{
+				producers.push_back({ { "id", producer.first }, { "kind", producer.second.kind } });
+			}
+		}
+
+		/* clang-format off */
+		peers.push_back(
+		{
+			{ "id",          kv.first                },
+			{ "displayName", kv.second.displayName   },
+			{ "device",      kv.second.device        },
+			{ "producers",   producers               }
+		});
+		/* clang-format on */
+	}
+
+	auto& broadcaster = broadcasters[broadcasterId];
+
+	broadcaster.displayName = displayName->get<std::string>();
+	broadcaster.device      = *device;
+
+	BCST_INFO << "MockServer: broadcaster created [room:" << roomId << ", id:" << broadcasterId
+	          << "]";
+
+	return jsonResponse({ { "peers", peers } });
+}
+
+HttpServer::Response MockServer::HandleTransport(
+  Broadcaster& broadcaster,
+  const std::string& transportId,
+  const std::string& action,
+  const json& body)
+{
+	auto it = broadcaster.transports.find(transportId);
+
+	if (it == broadcaster.transports.end())
+		return errorResponse(404, "transport with id \"" + transportId + "\" not found");
+
+	Transport& transport = it->second;
+
+	if (action == "connect")
+	{
+		auto dtlsParameters = body.find("dtlsParameters");
+
+		if (
+		  dtlsParameters == body.end() || !dtlsParameters->is_object() ||
+		  !dtlsParameters->count("fingerprints"))
+		{
+			return errorResponse(400, "missing body.dtlsParameters");
+		}
+
+		if (transport.connected)
+			return errorResponse(500, "connect() already called");
+
+		transport.connected = true;
+
+		return jsonResponse(json::object());
+	}
+	else if (action == "producers")
+	{
+		auto kind = body.find("kind");
+
+		if (kind == body.end() || (*kind != "audio" && *kind != "video"))
+			return errorResponse(400, "missing or invalid body.kind");
+
+		auto rtpParameters = body.find("rtpParameters");
+
+		if (
+		  rtpParameters == body.end() || !rtpParameters->is_object() ||
+		  !rtpParameters->count("codecs") || !rtpParameters->count("encodings"))
+		{
+			return errorResponse(400, "missing body.rtpParameters");
+		}
+
+		auto id = this->RandomId();
+
+		transport.producers[id] = { kind->get<std::string>(), *rtpParameters };
+
+		return jsonResponse({ { "id", id } });
+	}
+	else if (action == "produce/data")
+	{
+		auto sctpStreamParameters = body.find("sctpStreamParameters");
+
+		if (
+		  sctpStreamParameters == body.end() || !sctpStreamParameters->is_object() ||
+		  !sctpStreamParameters->count("streamId"))
+		{
+			return errorResponse(400, "missing body.sctpStreamParameters");
+		}
+
+		auto id = this->RandomId();
+
+		transport.dataProducers.insert(id);
+
+		return jsonResponse({ { "id", id } });
+	}
+	else if (action == "consume/data")
+	{
+		auto dataProducerId = body.find("dataProducerId");
+
+		if (dataProducerId == body.end() || !dataProducerId->is_string())
+			return errorResponse(400, "missing body.dataProducerId");
+
+		bool found = false;
+
+		for (const auto& kv : broadcaster.transports)
+		{
+			if (kv.second.dataProducers.count(dataProducerId->get<std::string>()))
+				found = true;
+		}
+
+		if (!found)
+		{
+			return errorResponse(
+			  404, "dataProducer with id \"" + dataProducerId->get<std::string>() + "\" not found");
+		}
+
+		auto id           = this->RandomId();
+		uint16_t streamId = transport.nextStreamId++;
+
+		transport.dataConsumers.insert(id);
+
+		/* clang-format off */
+		return jsonResponse(
+		{
+			{ "id",                   id                                                   },
+			{ "dataProducerId",       *dataProducerId                                      },
+			{ "streamId",             streamId                                             },
+			{ "sctpStreamParameters", { { "streamId", streamId }, { "ordered", true } }    },
+			{ "label",                ""                                                   },
+			{ "protocol",             ""                                                   }
+		});
+		/* clang-format on */
+	}
+
+	else if (action == "restart-ice")
+	{
+		return jsonResponse({ { "iceParameters", this->CreateIceParameters() } });
+	}
+
+	return errorResponse(404, "not found");
+}
+
+HttpServer::Response MockServer::Consume(
+  std::map<std::string, Broadcaster>& broadcasters,
+  Transport& transport,
+  const std::string& producerId)
+{
+	if (producerId.empty())
+		return errorResponse(400, "missing query.producerId");
+
+	const Producer* producer{ nullptr };
+
+	for (const auto& kv : broadcasters)
+	{
+		for (const auto& other : kv.second.transports)
+		{
+			auto it = other.second.producers.find(producerId);
+
+			if (it != other.second.producers.end())
+				producer = &it->second;
+		}
+	}
+
+	if (!producer)
+		return errorResponse(404, "producer with id \"" + producerId + "\" not found");
+
+	const json& producerRtpParameters = producer->rtpParameters;
+	auto id                           = this->RandomId();
+	uint32_t ssrc                     = std::uniform_int_distribution<uint32_t>(1)(this->random);
+
+	transport.consumers.insert(id);
+
+	// A single stream whatever the producer encodings are, as the SFU forwards
+	// one simulcast layer.
+	/* clang-format off */
+	json rtpParameters =
+	{
+		{ "codecs",           producerRtpParameters["codecs"]                                     },
+		{ "headerExtensions", producerRtpParameters.value("headerExtensions", json::array())      },
+		{ "encodings",        { { { "ssrc", ssrc } } }                                            },
+		{ "rtcp",
+			{
+				{ "cname",       this->RandomString(16, kAlphanumeric) },
+				{ "reducedSize", true                                  },
+				{ "mux",         true                                  }
+			}
+		}
+	};
+
+	return jsonResponse(
+	{
+		{ "id",            id              },
+		{ "producerId",    producerId      },
+		{ "kind",          producer->kind  },
+		{ "rtpParameters", rtpParameters   },
+		{ "type",          "simple"        }
+	});
+	/* clang-format on */
+}
+
+json MockServer::CreateIceParameters()
+{
+	/* clang-format off */
+	return
+	{
+		{ "usernameFragment", this->RandomString(16, kAlphanumeric) },
+		{ "password",         this->RandomString(32, kAlphanumeric) },
+		{ "iceLite",          true                                 }
+	};
+	/* clang-format on */
+}
+
+json MockServer::CreateTransport(Broadcaster& broadcaster)
+{
+	auto id = this->RandomId();
+
+	broadcaster.transports[id];
+
+	std::string fingerprint;
+
+	for (int i = 0; i < 32; ++i)
+	{
+		fingerprint += (i ? ":" : "") + this->RandomString(2, kHex);
+	}
+
+	/* clang-format off */
+	return
+	{
+		{ "id", id },
+		{ "iceParameters", this->CreateIceParameters() },
+		{ "iceCandidates",
+			{
+				{
+					{ "foundation", "udpcandidate"          },
+					{ "ip",         this->options.host      },
+					{ "port",       this->nextPort++        },
+					{ "priority",   1076302079              },
+					{ "protocol",   "udp"                   },
+					{ "type",       "host"                  }
+				}
+			}
+		},
+		{ "dtlsParameters",
+			{
+				{ "role", "auto" },
+				{ "fingerprints", { { { "algorithm", "sha-256" }, { "value", fingerprint } } } }
+			}
+		},
+		{ "sctpParameters",
+			{
+				{ "port",           5000   },
+				{ "OS",             1024   },
+				{ "MIS",            1024   },
+				{ "maxMessageSize", 262144 }
+			}
+		}
+	};
+	/* clang-format on */
+}
+
+std::string MockServer::RandomString(size_t length, const char* alphabet)
+{
+	std::string value;
+	size_t size = std::char_traits<char>::length(alphabet);
+
+	for (size_t i = 0; i < length; ++i)
+	{
+		value += alphabet[this->random() % size];
+	}
+
+	return value;
+}
+
+std::string MockServer::RandomId()
+{
+	// UUID v4 like, as mediasoup ids are.
+	std::string id = this->RandomString(32, "0123456789abcdef");
+
+	id[12] = '4';
+
+	return id.substr(0, 8) + "-" + id.substr(8, 4) + "-" + id.substr(12, 4) + "-" +
+	       id.substr(16, 4) + "-" + id.substr(20);
+}
@@ -0,0 +1,58 @@
+#include "NullVideoDecoderFactory.hpp"
+#include "modules/video_coding/include/video_error_codes.h"
+#include <utility>
+
+namespace
+{
+	// Reporting success keeps the receiver from requesting key frames.
+	class NullVideoDecoder : public webrtc::VideoDecoder
+	{
+		/* Virtual methods inherited from webrtc::VideoDecoder. */
+	public:
+		int32_t InitDecode(
+		  const webrtc::VideoCodec* /*codecSettings*/, int32_t /*numberOfCores*/) override
+		{
+			return WEBRTC_VIDEO_CODEC_OK;
+		}
+
+		int32_t Decode(
+		  const webrtc::EncodedImage& /*inputImage*/,
+		  bool /*missingFrames*/,
+		  int64_t /*renderTimeMs*/) override
+		{
+			return WEBRTC_VIDEO_CODEC_OK;
+		}
+
+		int32_t RegisterDecodeCompleteCallback(webrtc::DecodedImageCallback* /*callback*/) override
+		{
+			return WEBRTC_VIDEO_CODEC_OK;
+		}
+
+		int32_t Release() override
+		{
+			return WEBRTC_VIDEO_CODEC_OK;
+		}
+
+		const char* ImplementationName() const override
+		{
+			return "NullVideoDecoder";
+		}
+	};
+} // namespace
+
+NullVideoDecoderFactory::NullVideoDecoderFactory(
+  std::unique_ptr<webrtc::VideoDecoderFactory> factory)
+  : factory(std::move(factory))
+{
+}
+
+std::vector<webrtc::SdpVideoFormat> NullVideoDecoderFactory::GetSupportedFormats() const
+{
+	return this->factory->GetSupportedFormats();
+}
+
+std::unique_ptr<webrtc::VideoDecoder> NullVideoDecoderFactory::CreateVideoDecoder(
+  const webrtc::SdpVideoFormat& /*format*/)
+{
+	return std::unique_ptr<webrtc::VideoDecoder>(new NullVideoDecoder());
+}
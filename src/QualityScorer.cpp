@@ -0,0 +1,84 @@
+#include "QualityScorer.hpp"
+#include "AsyncLogger.hpp"
+#include "api/test/create_frame_generator.h"
+#include "api/video/i420_buffer.h"
+#include "common_video/libyuv/include/webrtc_libyuv.h"
+#include "pc/test/frame_generator_capturer_video_track_source.h"
+
+QualityScorer::QualityScorer()
+{
+	this->ResetReference();
+}
+
+bool QualityScorer::Compute(
+  const webrtc::I420BufferInterface& frame, const FrameStamp::Stamp& stamp, Score& score)
+{
+	// A lower frame number than the reference one means that the sender
+	// restarted, e.g. on a rejoin. The same one is a repeated frame.
+	if (stamp.frameNumber + 1 < this->nextFrameNumber)
+		this->ResetReference();
+
+	if (stamp.frameNumber >= this->nextFrameNumber + kMaxCatchUpFrames)
+	{
+		if (!this->catchUpWarned)
+		{
+			BCST_WARN << "frames too far ahead of the quality reference, not scored [frameNumber:"
+			          << stamp.frameNumber << ", referenceFrameNumber:" << this->nextFrameNumber
+			          << "]";
+
+			this->catchUpWarned = true;
+		}
+
+		return false;
+	}
+
+	this->catchUpWarned = false;
+
+	while (this->nextFrameNumber <= stamp.frameNumber)
+	{
+		this->reference = this->generator->NextFrame().buffer;
+
+		++this->nextFrameNumber;
+	}
+
+	// The reference is scaled down to the received frame, not up.
+	if (
+	  !this->reference || frame.width() > this->reference->width() ||
+	  frame.height() > this->reference->height())
+	{
+		return false;
+	}
+
+	rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+	  webrtc::I420Buffer::Copy(*this->reference->ToI420());
+
+	if (!FrameStamp::Write(
+	      stamp,
+	      buffer->MutableDataY(),
+	      buffer->StrideY(),
+	      buffer->MutableDataU(),
+	      buffer->StrideU(),
+	      buffer->MutableDataV(),
+	      buffer->StrideV(),
+	      buffer->width(),
+	      buffer->height()))
+	{
+		return false;
+	}
+
+	score.psnr = webrtc::I420PSNR(*buffer, frame);
+	score.ssim = webrtc::I420SSIM(*buffer, frame);
+
+	return true;
+}
+
+void QualityScorer::ResetReference()
+{
+	// The configuration createSquaresVideoTrack() uses.
+	webrtc::FrameGeneratorCapturerVideoTrackSource::Config config;
+
+	this->generator = webrtc::test::CreateSquareFrameGenerator(
+	  config.width, config.height, absl::nullopt, config.num_squares_generated);
+	this->nextFrameNumber = 0;
+	this->reference       = nullptr;
+}
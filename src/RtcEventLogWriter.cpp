@@ -0,0 +1,376 @@
+#include "RtcEventLogWriter.hpp"
+#include "AsyncLogger.hpp"
+#include "rtc_base/ref_counted_object.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <utility>
+
+namespace
+{
+	constexpr auto kFlushInterval = std::chrono::seconds(1);
+
+	// CPU time consumed by the calling thread.
+	int64_t threadCpuNs()
+	{
+		timespec ts;
+
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+			return 0;
+
+		return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+	}
+} // namespace
+
+RtcEventLogWriter::Output::Output(
+  std::shared_ptr<Queue> queue, uint32_t peerConnection, uint64_t maxQueuedBytes)
+  : queue(std::move(queue)), peerConnection(peerConnection), maxQueuedBytes(maxQueuedBytes)
+{
+}
+
+bool RtcEventLogWriter::Output::IsActive() const
+{
+	std::lock_guard<std::mutex> lock(this->queue->mutex);
+
+	return this->queue->accepting;
+}
+
+bool RtcEventLogWriter::Output::Write(const std::string& output)
+{
+	// Called from the task queue of the event log, which encodes the events.
+	Chunk chunk;
+
+	chunk.peerConnection = this->peerConnection;
+	chunk.data           = output;
+
+	std::lock_guard<std::mutex> lock(this->queue->mutex);
+
+	if (!this->queue->accepting)
+		return false;
+
+	if (this->queue->queuedBytes + output.size() > this->maxQueuedBytes)
+	{
+		this->queue->dropped += output.size();
+	}
+	else
+	{
+		this->queue->queuedBytes += output.size();
+		this->queue->chunks.push_back(std::move(chunk));
+	}
+
+	this->queue->encodingCpuNs[this->peerConnection] = threadCpuNs();
+
+	// Dropped output is lost, but the log goes on.
+	return true;
+}
+
+RtcEventLogWriter::Factory::Factory(
+  rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> factory,
+  std::shared_ptr<Queue> queue,
+  const RtcEventLogWriter::Options& options)
+  : factory(std::move(factory)), queue(std::move(queue)), options(options)
+{
+}
+
+void RtcEventLogWriter::Factory::SetOptions(
+  const webrtc::PeerConnectionFactoryInterface::Options& options)
+{
+	this->factory->SetOptions(options);
+}
+
+rtc::scoped_refptr<webrtc::PeerConnectionInterface> RtcEventLogWriter::Factory::CreatePeerConnection(
+  const webrtc::PeerConnectionInterface::RTCConfiguration& configuration,
+  webrtc::PeerConnectionDependencies dependencies)
+{
+	return this->StartEventLog(
+	  this->factory->CreatePeerConnection(configuration, std::move(dependencies)));
+}
+
+rtc::scoped_refptr<webrtc::PeerConnectionInterface> RtcEventLogWriter::Factory::CreatePeerConnection(
+  const webrtc::PeerConnectionInterface::RTCConfiguration& configuration,
+  std::unique_ptr<cricket::PortAllocator> allocator,
+  std::unique_ptr<rtc::RTCCertificateGeneratorInterface> certGenerator,
+  webrtc::PeerConnectionObserver* observer)
+{
+	return this->StartEventLog(this->factory->CreatePeerConnection(
+	  configuration, std::move(allocator), std::move(certGenerator), observer));
+}
+
+webrtc::RtpCapabilities RtcEventLogWriter::Factory::GetRtpSenderCapabilities(
+  cricket::MediaType kind) const
+{
+	return this->factory->GetRtpSenderCapabilities(kind);
+}
+
+webrtc::RtpCapabilities RtcEventLogWriter::Factory::GetRtpReceiverCapabilities(
+  cricket::MediaType kind) const
+{
+	return this->factory->GetRtpReceiverCapabilities(kind);
+}
+
+rtc::scoped_refptr<webrtc::MediaStreamInterface> RtcEventLogWriter::Factory::CreateLocalMediaStream(
+  const std::string& streamId)
+{
+	return this->factory->CreateLocalMediaStream(streamId);
+}
+
+rtc::scoped_refptr<webrtc::AudioSourceInterface> RtcEventLogWriter::Factory::CreateAudioSource(
+  const cricket::AudioOptions& options)
+{
+	return this->factory->CreateAudioSource(options);
+}
+
+rtc::scoped_refptr<webrtc::VideoTrackInterface> RtcEventLogWriter::Factory::CreateVideoTrack(
+  const std::string& label, webrtc::VideoTrackSourceInterface* source)
+{
+	return this->factory->CreateVideoTrack(label, source);
+}
+
+rtc::scoped_refptr<webrtc::AudioTrackInterface> RtcEventLogWriter::Factory::CreateAudioTrack(
+  const std::string& label, webrtc::AudioSourceInterface* source)
+{
+	return this->factory->CreateAudioTrack(label, source);
+}
+
+bool RtcEventLogWriter::Factory::StartAecDump(FILE* file, int64_t maxSizeBytes)
+{
+	return this->factory->StartAecDump(file, maxSizeBytes);
+}
+
+void RtcEventLogWriter::Factory::StopAecDump()
+{
+	this->factory->StopAecDump();
+}
+
+rtc::scoped_refptr<webrtc::PeerConnectionInterface> RtcEventLogWriter::Factory::StartEventLog(
+  rtc::scoped_refptr<webrtc::PeerConnectionInterface> peerConnection)
+{
+	if (!peerConnection)
+		return peerConnection;
+
+	uint32_t index;
+
+	{
+		std::lock_guard<std::mutex> lock(this->queue->mutex);
+
+		index = this->queue->peerConnections++;
+	}
+
+	std::unique_ptr<webrtc::RtcEventLogOutput> output(
+	  new Output(this->queue, index, this->options.maxQueuedBytes));
+
+	if (!peerConnection->StartRtcEventLog(std::move(output), this->options.outputPeriodMs))
+		BCST_WARN << "unable to start the RTC event log [peerConnection:" << index << "]";
+	else
+		BCST_INFO << "RTC event log started [peerConnection:" << index << "]";
+
+	return peerConnection;
+}
+
+RtcEventLogWriter::RtcEventLogWriter(const Options& options)
+  : options(options), queue(std::make_shared<Queue>())
+{
+	auto startTime = static_cast<int64_t>(std::time(nullptr));
+
+	this->prefix = options.directory + "/rtc-event-log-" + std::to_string(startTime);
+}
+
+RtcEventLogWriter::~RtcEventLogWriter()
+{
+	this->Stop();
+}
+
+void RtcEventLogWriter::Start()
+{
+	BCST_INFO << "RtcEventLogWriter::Start() [directory:" << this->options.directory << "]";
+
+	{
+		std::lock_guard<std::mutex> lock(this->queue->mutex);
+
+		this->queue->accepting = true;
+	}
+
+	this->reportedAt = std::chrono::steady_clock::now();
+	this->thread     = std::thread(&RtcEventLogWriter::Run, this);
+}
+
+void RtcEventLogWriter::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->queue->mutex);
+
+		this->queue->accepting = false;
+		this->queue->stopping  = true;
+	}
+
+	this->queue->cv.notify_all();
+
+	if (this->thread.joinable())
+		this->thread.join();
+
+	for (auto& kv : this->files)
+	{
+		if (kv.second.file)
+			std::fclose(kv.second.file);
+	}
+
+	this->files.clear();
+}
+
+rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> RtcEventLogWriter::WrapFactory(
+  rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> factory)
+{
+	return new rtc::RefCountedObject<Factory>(std::move(factory), this->queue, this->options);
+}
+
+void RtcEventLogWriter::Run()
+{
+	std::unique_lock<std::mutex> lock(this->queue->mutex);
+
+	while (!this->queue->stopping)
+	{
+		this->queue->cv.wait_for(lock, kFlushInterval);
+
+		lock.unlock();
+		this->Drain();
+
+		auto now = std::chrono::steady_clock::now();
+
+		if (now - this->reportedAt >= std::chrono::seconds(this->options.reportIntervalSeconds))
+			this->Report(now);
+
+		lock.lock();
+	}
+
+	lock.unlock();
+
+	// Whatever was output when stopping.
+	this->Drain();
+	this->Report(std::chrono::steady_clock::now());
+}
+
+void RtcEventLogWriter::Drain()
+{
+	std::deque<Chunk> chunks;
+
+	{
+		std::lock_guard<std::mutex> lock(this->queue->mutex);
+
+		chunks.swap(this->queue->chunks);
+		this->queue->queuedBytes = 0;
+	}
+
+	if (chunks.empty())
+		return;
+
+	for (const auto& chunk : chunks)
+	{
+		this->Write(chunk);
+	}
+
+	for (auto& kv : this->files)
+	{
+		if (kv.second.file)
+			std::fflush(kv.second.file);
+	}
+}
+
+void RtcEventLogWriter::Write(const Chunk& chunk)
+{
+	auto& file = this->files[chunk.peerConnection];
+	auto now   = std::chrono::steady_clock::now();
+
+	if (
+	  file.file &&
+	  ((this->options.maxFileSize && file.size + chunk.data.size() > this->options.maxFileSize) ||
+	   (this->options.maxFileSeconds &&
+	    now - file.openedAt >= std::chrono::seconds(this->options.maxFileSeconds))))
+	{
+		std::fclose(file.file);
+
+		file.file = nullptr;
+	}
+
+	if (!file.file && !this->Open(chunk.peerConnection, file))
+		return;
+
+	std::fwrite(chunk.data.data(), 1, chunk.data.size(), file.file);
+
+	file.size += chunk.data.size();
+	this->bytes += chunk.data.size();
+}
+
+bool RtcEventLogWriter::Open(uint32_t peerConnection, File& file)
+{
+	std::string path = this->prefix + "-pc" + std::to_string(peerConnection) + "-" +
+	                   std::to_string(file.part++) + ".rtclog";
+
+	file.file = std::fopen(path.c_str(), "wb");
+
+	if (!file.file)
+	{
+		BCST_ERROR << "unable to open '" << path << "': " << std::strerror(errno);
+
+		return false;
+	}
+
+	file.size     = 0;
+	file.openedAt = std::chrono::steady_clock::now();
+	file.paths.push_back(path);
+	++this->filesOpened;
+
+	// The first part carries the stream configurations, without which the
+	// others can not be parsed: the oldest part after it is removed instead.
+	while (this->options.maxFiles &&
+	       file.paths.size() > std::max<size_t>(this->options.maxFiles, 2))
+	{
+		std::remove(file.paths[1].c_str());
+		file.paths.erase(file.paths.begin() + 1);
+	}
+
+	BCST_INFO << "writing the RTC event log into '" << path << "'";
+
+	return true;
+}
+
+void RtcEventLogWriter::Report(std::chrono::steady_clock::time_point now)
+{
+	int64_t encodingCpuNs = 0;
+	uint32_t peerConnections;
+	uint64_t dropped;
+
+	{
+		std::lock_guard<std::mutex> lock(this->queue->mutex);
+
+		for (const auto& kv : this->queue->encodingCpuNs)
+		{
+			encodingCpuNs += kv.second;
+		}
+
+		peerConnections = this->queue->peerConnections;
+		dropped         = this->queue->dropped;
+	}
+
+	int64_t writingCpuNs = threadCpuNs();
+	double seconds       = std::chrono::duration<double>(now - this->reportedAt).count();
+
+	if (seconds <= 0)
+		return;
+
+	double encodingCpu = (encodingCpuNs - this->reportedEncodingCpuNs) / (seconds * 1e7);
+	double writingCpu  = (writingCpuNs - this->reportedWritingCpuNs) / (seconds * 1e7);
+	double rate        = (this->bytes - this->reportedBytes) / seconds / 1024;
+
+	BCST_INFO << "RTC event log [peerConnections:" << peerConnections
+	          << ", files:" << this->filesOpened << ", bytes:" << this->bytes
+	          << ", droppedBytes:" << dropped << ", kB/s:" << std::fixed << std::setprecision(1)
+	          << rate << ", encodingCpu:" << std::setprecision(2) << encodingCpu
+	          << "%, writingCpu:" << writingCpu << "%]";
+
+	this->reportedAt            = now;
+	this->reportedBytes         = this->bytes;
+	this->reportedEncodingCpuNs = encodingCpuNs;
+	this->reportedWritingCpuNs  = writingCpuNs;
+}
@@ -0,0 +1,41 @@
+#include "StampingFrameGenerator.hpp"
+#include "FrameStamp.hpp"
+#include "api/video/i420_buffer.h"
+#include <utility>
+
+StampingFrameGenerator::StampingFrameGenerator(
+  std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator)
+  : generator(std::move(generator))
+{
+}
+
+webrtc::test::FrameGeneratorInterface::VideoFrameData StampingFrameGenerator::NextFrame()
+{
+	auto data = this->generator->NextFrame();
+	auto i420 = data.buffer->ToI420();
+
+	rtc::scoped_refptr<webrtc::I420Buffer> buffer = webrtc::I420Buffer::Copy(*i420);
+	FrameStamp::Stamp stamp;
+
+	stamp.timestampMs = FrameStamp::NowMs();
+	stamp.frameNumber = this->frameNumber++;
+
+	FrameStamp::Write(
+	  stamp,
+	  buffer->MutableDataY(),
+	  buffer->StrideY(),
+	  buffer->MutableDataU(),
+	  buffer->StrideU(),
+	  buffer->MutableDataV(),
+	  buffer->StrideV(),
+	  buffer->width(),
+	  buffer->height());
+
+	// The whole frame is reported as updated.
+	return VideoFrameData(buffer, absl::nullopt);
+}
+
+void StampingFrameGenerator::ChangeResolution(size_t width, size_t height)
+{
+	this->generator->ChangeResolution(width, height);
+}
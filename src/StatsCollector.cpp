@@ -0,0 +1,498 @@
+#include "StatsCollector.hpp"
+#include "AsyncLogger.hpp"
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <unordered_map>
+
+using namespace std::chrono;
+using json = nlohmann::json;
+
+namespace
+{
+	double getNumber(const json& stat, const char* key)
+	{
+		auto it = stat.find(key);
+
+		return it != stat.end() && it->is_number() ? it->get<double>() : 0;
+	}
+
+	uint64_t getCounter(const json& stat, const char* key)
+	{
+		double value = getNumber(stat, key);
+
+		return value > 0 ? static_cast<uint64_t>(value) : 0;
+	}
+
+	std::string getString(const json& stat, const char* key)
+	{
+		auto it = stat.find(key);
+
+		return it != stat.end() && it->is_string() ? it->get<std::string>() : "";
+	}
+
+	bool getBool(const json& stat, const char* key)
+	{
+		auto it = stat.find(key);
+
+		return it != stat.end() && it->is_boolean() && it->get<bool>();
+	}
+
+	void parseCandidatePair(const json& stat, StatsCollector::TransportStats& transport)
+	{
+		transport.currentRoundTripTime     = getNumber(stat, "currentRoundTripTime");
+		transport.availableOutgoingBitrate = getNumber(stat, "availableOutgoingBitrate");
+		transport.bytesSent                = getCounter(stat, "bytesSent");
+		transport.bytesReceived            = getCounter(stat, "bytesReceived");
+	}
+
+	/* Writes a metric family with one sample per outbound RTP stream. */
+	void writeOutboundMetric(
+	  std::ostream& out,
+	  const char* name,
+	  const char* type,
+	  const char* help,
+	  const std::vector<StatsCollector::OutboundRtpStats>& streams,
+	  const std::function<double(const StatsCollector::OutboundRtpStats& stream)>& value,
+	  bool videoOnly = false)
+	{
+		out << "# HELP " << name << " " << help << "\n";
+		out << "# TYPE " << name << " " << type << "\n";
+
+		for (const auto& stream : streams)
+		{
+			if (videoOnly && stream.kind != "video")
+				continue;
+
+			out << name << "{kind=\"" << stream.kind << "\",rid=\"" << stream.rid << "\",ssrc=\""
+			    << stream.ssrc << "\"} " << value(stream) << "\n";
+		}
+	}
+
+	void writeMetric(
+	  std::ostream& out, const char* name, const char* type, const char* help, double value)
+	{
+		out << "# HELP " << name << " " << help << "\n";
+		out << "# TYPE " << name << " " << type << "\n";
+		out << name << " " << value << "\n";
+	}
+} // namespace
+
+void StatsCollector::ParseStats(const json& stats, Snapshot& snapshot)
+{
+	if (!stats.is_array())
+		return;
+
+	std::unordered_map<std::string, const json*> remoteInbound;
+	std::unordered_map<std::string, const json*> candidatePairs;
+	std::string selectedCandidatePairId;
+	size_t firstOutbound = snapshot.outboundRtp.size();
+
+	for (const auto& stat : stats)
+	{
+		std::string type = getString(stat, "type");
+
+		if (type == "outbound-rtp")
+		{
+			OutboundRtpStats stream;
+
+			stream.id = getString(stat, "id");
+
+			// Already parsed from another report, e.g. of its Producer.
+			if (std::any_of(
+			      snapshot.outboundRtp.begin(),
+			      snapshot.outboundRtp.end(),
+			      [&stream](const OutboundRtpStats& parsed) { return parsed.id == stream.id; }))
+			{
+				continue;
+			}
+
+			stream.kind = getString(stat, "kind");
+
+			if (stream.kind.empty())
+				stream.kind = getString(stat, "mediaType");
+
+			stream.rid                     = getString(stat, "rid");
+			stream.ssrc                    = static_cast<uint32_t>(getCounter(stat, "ssrc"));
+			stream.bytesSent               = getCounter(stat, "bytesSent");
+			stream.packetsSent             = getCounter(stat, "packetsSent");
+			stream.retransmittedBytesSent  = getCounter(stat, "retransmittedBytesSent");
+			stream.nackCount               = getCounter(stat, "nackCount");
+			stream.pliCount                = getCounter(stat, "pliCount");
+			stream.framesEncoded           = getCounter(stat, "framesEncoded");
+			stream.totalEncodeTime         = getNumber(stat, "totalEncodeTime");
+			stream.framesPerSecond         = getNumber(stat, "framesPerSecond");
+			stream.frameWidth              = static_cast<uint32_t>(getCounter(stat, "frameWidth"));
+			stream.frameHeight             = static_cast<uint32_t>(getCounter(stat, "frameHeight"));
+			stream.qualityLimitationReason = getString(stat, "qualityLimitationReason");
+
+			snapshot.outboundRtp.push_back(std::move(stream));
+		}
+		else if (type == "remote-inbound-rtp")
+		{
+			remoteInbound[getString(stat, "localId")] = &stat;
+		}
+		else if (type == "candidate-pair")
+		{
+			candidatePairs[getString(stat, "id")] = &stat;
+
+			// Used if no transport stats point to the selected pair.
+			if (
+			  selectedCandidatePairId.empty() && getBool(stat, "nominated") &&
+			  getString(stat, "state") == "succeeded")
+			{
+				selectedCandidatePairId = getString(stat, "id");
+			}
+		}
+		else if (type == "transport")
+		{
+			std::string id = getString(stat, "selectedCandidatePairId");
+
+			if (!id.empty())
+				selectedCandidatePairId = id;
+		}
+	}
+
+	for (size_t i = firstOutbound; i < snapshot.outboundRtp.size(); ++i)
+	{
+		auto& stream = snapshot.outboundRtp[i];
+		auto it      = remoteInbound.find(stream.id);
+
+		if (it == remoteInbound.end())
+			continue;
+
+		stream.roundTripTime = getNumber(*it->second, "roundTripTime");
+		stream.packetsLost   = static_cast<int64_t>(getNumber(*it->second, "packetsLost"));
+		stream.fractionLost  = getNumber(*it->second, "fractionLost");
+	}
+
+	auto it = candidatePairs.find(selectedCandidatePairId);
+
+	if (it != candidatePairs.end())
+		parseCandidatePair(*it->second, snapshot.transport);
+}
+
+StatsCollector::StatsCollector(const Options& options) : options(options)
+{
+	if (this->options.intervalMs == 0)
+		this->options.intervalMs = 1;
+}
+
+StatsCollector::~StatsCollector()
+{
+	this->Stop();
+}
+
+void StatsCollector::Start(
+  mediasoupclient::SendTransport* sendTransport,
+  const DataMessageDispatcher* dataMessageDispatcher)
+{
+	BCST_INFO << "StatsCollector::Start() [interval:" << this->options.intervalMs
+	          << "ms, metrics:http://" << this->options.host << ":" << this->options.port
+	          << "/metrics]";
+
+	this->sendTransport         = sendTransport;
+	this->dataMessageDispatcher = dataMessageDispatcher;
+
+	this->httpServer.reset(new HttpServer([this](const HttpServer::Request& request) {
+		if (request.path != "/metrics")
+			return HttpServer::Response{ 404, "text/plain", "not found\n" };
+
+		if (request.method != "GET")
+			return HttpServer::Response{ 405, "text/plain", "method not allowed\n" };
+
+		return HttpServer::Response{ 200, "text/plain; version=0.0.4", this->ToPrometheus() };
+	}));
+
+	// Stats are still collected if the endpoint can't be served.
+	if (!this->httpServer->Start(this->options.host, this->options.port))
+		this->httpServer.reset();
+
+	this->thread = std::thread(&StatsCollector::Run, this);
+}
+
+void StatsCollector::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->stopping = true;
+	}
+
+	this->cv.notify_all();
+
+	if (this->thread.joinable())
+		this->thread.join();
+
+	if (this->httpServer)
+		this->httpServer->Stop();
+}
+
+StatsCollector::Snapshot StatsCollector::GetSnapshot() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	return this->snapshot;
+}
+
+std::string StatsCollector::ToPrometheus() const
+{
+	Snapshot snapshot   = this->GetSnapshot();
+	const auto& streams = snapshot.outboundRtp;
+	std::ostringstream out;
+
+	// Keep counters exact.
+	out.precision(15);
+
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_bytes_sent_total",
+	  "counter",
+	  "Payload bytes sent.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.bytesSent; });
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_packets_sent_total",
+	  "counter",
+	  "RTP packets sent.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.packetsSent; });
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_retransmitted_bytes_sent_total",
+	  "counter",
+	  "Payload bytes retransmitted.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.retransmittedBytesSent; });
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_bitrate_bps",
+	  "gauge",
+	  "Payload bitrate over the last stats interval.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.bitrate; });
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_nack_count_total",
+	  "counter",
+	  "NACKs received.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.nackCount; });
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_pli_count_total",
+	  "counter",
+	  "PLIs received.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.pliCount; },
+	  true);
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_frames_encoded_total",
+	  "counter",
+	  "Frames encoded.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.framesEncoded; },
+	  true);
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_frames_per_second",
+	  "gauge",
+	  "Encoded frames per second.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.framesPerSecond; },
+	  true);
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_encode_time_ms",
+	  "gauge",
+	  "Average encode time per frame over the last stats interval.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.encodeTimeMs; },
+	  true);
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_frame_width",
+	  "gauge",
+	  "Width of the last encoded frame.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.frameWidth; },
+	  true);
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_outbound_frame_height",
+	  "gauge",
+	  "Height of the last encoded frame.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.frameHeight; },
+	  true);
+
+	out << "# HELP broadcaster_outbound_quality_limitation Current quality limitation reason.\n";
+	out << "# TYPE broadcaster_outbound_quality_limitation gauge\n";
+
+	for (const auto& stream : streams)
+	{
+		if (stream.kind != "video")
+			continue;
+
+		for (const char* reason : { "none", "cpu", "bandwidth", "other" })
+		{
+			out << "broadcaster_outbound_quality_limitation{kind=\"" << stream.kind << "\",rid=\""
+			    << stream.rid << "\",ssrc=\"" << stream.ssrc << "\",reason=\"" << reason << "\"} "
+			    << (stream.qualityLimitationReason == reason ? 1 : 0) << "\n";
+		}
+	}
+
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_remote_round_trip_time_seconds",
+	  "gauge",
+	  "RTT reported by the remote endpoint.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.roundTripTime; });
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_remote_packets_lost",
+	  "gauge",
+	  "Cumulative packets lost reported by the remote endpoint.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.packetsLost; });
+	writeOutboundMetric(
+	  out,
+	  "broadcaster_remote_fraction_lost",
+	  "gauge",
+	  "Fraction of packets lost in the last remote report.",
+	  streams,
+	  [](const OutboundRtpStats& stream) { return stream.fractionLost; });
+
+	writeMetric(
+	  out,
+	  "broadcaster_transport_round_trip_time_seconds",
+	  "gauge",
+	  "Current RTT of the selected candidate pair.",
+	  snapshot.transport.currentRoundTripTime);
+	writeMetric(
+	  out,
+	  "broadcaster_transport_available_outgoing_bitrate_bps",
+	  "gauge",
+	  "Bandwidth estimation of the send transport.",
+	  snapshot.transport.availableOutgoingBitrate);
+	writeMetric(
+	  out,
+	  "broadcaster_transport_bytes_sent_total",
+	  "counter",
+	  "Bytes sent on the selected candidate pair.",
+	  snapshot.transport.bytesSent);
+	writeMetric(
+	  out,
+	  "broadcaster_transport_bytes_received_total",
+	  "counter",
+	  "Bytes received on the selected candidate pair.",
+	  snapshot.transport.bytesReceived);
+
+	// Messages of DataConsumers with no handler are under an empty label.
+	out << "# HELP broadcaster_data_messages_received_total Messages received per DataConsumer "
+	       "label.\n";
+	out << "# TYPE broadcaster_data_messages_received_total counter\n";
+
+	for (const auto& counters : snapshot.dataMessages)
+	{
+		out << "broadcaster_data_messages_received_total{label=\"" << counters.label << "\"} "
+		    << counters.messages << "\n";
+	}
+
+	out << "# HELP broadcaster_data_bytes_received_total Bytes received per DataConsumer label.\n";
+	out << "# TYPE broadcaster_data_bytes_received_total counter\n";
+
+	for (const auto& counters : snapshot.dataMessages)
+	{
+		out << "broadcaster_data_bytes_received_total{label=\"" << counters.label << "\"} "
+		    << counters.bytes << "\n";
+	}
+
+	writeMetric(out, "broadcaster_stats_polls_total", "counter", "Stats polls.", snapshot.polls);
+	writeMetric(
+	  out,
+	  "broadcaster_stats_failed_polls_total",
+	  "counter",
+	  "Stats polls that failed.",
+	  snapshot.failedPolls);
+
+	return out.str();
+}
+
+void StatsCollector::Run()
+{
+	const auto interval = milliseconds(this->options.intervalMs);
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			if (this->cv.wait_for(lock, interval, [this] { return this->stopping; }))
+				break;
+		}
+
+		this->Poll();
+	}
+}
+
+void StatsCollector::Poll()
+{
+	Snapshot current;
+
+	// GetStats() blocks until the signaling thread collected the stats. Those of
+	// the transport include the outbound RTP streams of every Producer.
+	try
+	{
+		ParseStats(this->sendTransport->GetStats(), current);
+	}
+	catch (const std::exception& error)
+	{
+		BCST_ERROR << "unable to get stats: " << error.what();
+
+		// Keep serving the last complete snapshot.
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		++this->snapshot.polls;
+		++this->snapshot.failedPolls;
+
+		return;
+	}
+
+	auto now = steady_clock::now();
+	std::map<std::string, Previous> previous;
+
+	for (auto& stream : current.outboundRtp)
+	{
+		auto it = this->previous.find(stream.id);
+
+		if (it != this->previous.end())
+		{
+			const auto& last = it->second;
+			double elapsed   = duration<double>(now - last.time).count();
+			uint64_t frames  = stream.framesEncoded - last.framesEncoded;
+
+			if (elapsed > 0 && stream.bytesSent >= last.bytesSent)
+				stream.bitrate = (stream.bytesSent - last.bytesSent) * 8 / elapsed;
+
+			if (stream.framesEncoded > last.framesEncoded)
+				stream.encodeTimeMs = (stream.totalEncodeTime - last.totalEncodeTime) * 1000 / frames;
+		}
+
+		previous[stream.id] = { now, stream.bytesSent, stream.framesEncoded, stream.totalEncodeTime };
+	}
+
+	this->previous = std::move(previous);
+
+	if (this->dataMessageDispatcher)
+		current.dataMessages = this->dataMessageDispatcher->GetCounters();
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	current.polls       = this->snapshot.polls + 1;
+	current.failedPolls = this->snapshot.failedPolls;
+	this->snapshot      = std::move(current);
+}
@@ -0,0 +1,597 @@
+#include "StreamRecorder.hpp"
+#include "AsyncLogger.hpp"
+#include "json.hpp"
+#include "rtc_base/ref_counted_object.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+using json = nlohmann::json;
+
+namespace
+{
+	// Queued frames are written at least this often.
+	constexpr auto kFlushInterval = std::chrono::milliseconds(50);
+	constexpr size_t kWriteBufferSize = 1024 * 1024;
+	constexpr size_t kIvfHeaderSize   = 32;
+	constexpr uint32_t kVideoClockRate = 90000;
+	// Also the RTP clock rate of Opus, whatever its input rate.
+	constexpr uint32_t kOpusClockRate = 48000;
+	constexpr uint8_t kOggBeginOfStream = 0x02;
+	constexpr uint8_t kOggEndOfStream   = 0x04;
+
+	void put16(uint8_t* data, uint16_t value)
+	{
+		data[0] = static_cast<uint8_t>(value);
+		data[1] = static_cast<uint8_t>(value >> 8);
+	}
+
+	void put32(uint8_t* data, uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			data[i] = static_cast<uint8_t>(value >> (8 * i));
+		}
+	}
+
+	void put64(uint8_t* data, uint64_t value)
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			data[i] = static_cast<uint8_t>(value >> (8 * i));
+		}
+	}
+
+	// CRC-32 of Ogg pages: polynomial 0x04C11DB7, not reflected.
+	uint32_t oggCrc(uint32_t crc, const uint8_t* data, size_t size)
+	{
+		static const auto* table = []() {
+			auto* entries = new uint32_t[256];
+
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t entry = i << 24;
+
+				for (int bit = 0; bit < 8; ++bit)
+				{
+					entry = (entry & 0x80000000) ? (entry << 1) ^ 0x04C11DB7 : entry << 1;
+				}
+
+				entries[i] = entry;
+			}
+
+			return entries;
+		}();
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			crc = (crc << 8) ^ table[((crc >> 24) ^ data[i]) & 0xFF];
+		}
+
+		return crc;
+	}
+
+	// Samples at 48 kHz in an Opus packet, from its TOC byte (RFC 6716 3.1).
+	uint32_t opusPacketSamples(const uint8_t* data, size_t size)
+	{
+		if (size == 0)
+			return 0;
+
+		// 10, 20, 40 and 60 ms.
+		static const uint32_t silkFrameSamples[4]{ 480, 960, 1920, 2880 };
+		uint8_t config = data[0] >> 3;
+		uint32_t frameSamples;
+
+		// SILK, Hybrid and CELT only modes.
+		if (config < 12)
+			frameSamples = silkFrameSamples[config & 3];
+		else if (config < 16)
+			frameSamples = 480u << (config & 1);
+		else
+			frameSamples = 120u << (config & 3);
+
+		switch (data[0] & 3)
+		{
+			case 0:
+				return frameSamples;
+			case 1:
+			case 2:
+				return frameSamples * 2;
+			default:
+				return size > 1 ? frameSamples * (data[1] & 0x3F) : 0;
+		}
+	}
+
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* data, size_t size) : data(data), size(size)
+		{
+		}
+
+		// Zeros past the end.
+		uint32_t Read(int bits)
+		{
+			uint32_t value = 0;
+
+			for (int i = 0; i < bits; ++i, ++this->position)
+			{
+				size_t byte = this->position / 8;
+				uint32_t bit =
+				  byte < this->size ? (this->data[byte] >> (7 - this->position % 8)) & 1 : 0;
+
+				value = (value << 1) | bit;
+			}
+
+			return value;
+		}
+
+	private:
+		const uint8_t* data;
+		size_t size;
+		size_t position{ 0 };
+	};
+
+	// Frame size from a VP8 or VP9 key frame header. Returns false if unknown.
+	bool parseFrameSize(
+	  const char* fourcc, const uint8_t* data, size_t size, uint16_t& width, uint16_t& height)
+	{
+		if (std::memcmp(fourcc, "VP80", 4) == 0)
+		{
+			// Frame tag (3), start code (3), 14 bit width and height.
+			if (size < 10 || data[3] != 0x9D || data[4] != 0x01 || data[5] != 0x2A)
+				return false;
+
+			width  = static_cast<uint16_t>((data[6] | data[7] << 8) & 0x3FFF);
+			height = static_cast<uint16_t>((data[8] | data[9] << 8) & 0x3FFF);
+
+			return true;
+		}
+
+		if (std::memcmp(fourcc, "VP90", 4) == 0)
+		{
+			// Uncompressed header, VP9 bitstream specification 6.2.
+			BitReader reader(data, size);
+
+			if (reader.Read(2) != 2)
+				return false;
+
+			uint32_t profile = reader.Read(1);
+
+			profile |= reader.Read(1) << 1;
+
+			if (profile == 3)
+				reader.Read(1);
+
+			// show_existing_frame, then frame_type 0 for key frames.
+			if (reader.Read(1) != 0 || reader.Read(1) != 0)
+				return false;
+
+			// show_frame, error_resilient_mode.
+			reader.Read(2);
+
+			if (reader.Read(24) != 0x498342)
+				return false;
+
+			if (profile >= 2)
+				reader.Read(1);
+
+			// Not sRGB.
+			if (reader.Read(3) != 7)
+			{
+				reader.Read(1);
+
+				if (profile == 1 || profile == 3)
+					reader.Read(3);
+			}
+			else if (profile == 1 || profile == 3)
+			{
+				reader.Read(1);
+			}
+
+			width  = static_cast<uint16_t>(reader.Read(16) + 1);
+			height = static_cast<uint16_t>(reader.Read(16) + 1);
+
+			return true;
+		}
+
+		return false;
+	}
+} // namespace
+
+StreamRecorder::Tap::Tap(std::shared_ptr<Queue> queue, uint32_t source, bool audio)
+  : queue(std::move(queue)), source(source), audio(audio)
+{
+}
+
+void StreamRecorder::Tap::Transform(std::unique_ptr<webrtc::TransformableFrameInterface> frame)
+{
+	if (this->queue->accepting.load(std::memory_order_relaxed))
+	{
+		auto data = frame->GetData();
+		bool keyFrame =
+		  !this->audio &&
+		  static_cast<webrtc::TransformableVideoFrameInterface*>(frame.get())->IsKeyFrame();
+
+		bool queued = this->queue->ring.TryPush([this, &frame, &data, keyFrame](Frame& queuedFrame) {
+			queuedFrame.source    = this->source;
+			queuedFrame.ssrc      = frame->GetSsrc();
+			queuedFrame.timestamp = frame->GetTimestamp();
+			queuedFrame.keyFrame  = keyFrame;
+
+			// Within the capacity allocated upfront, unless the frame is larger.
+			queuedFrame.data.assign(data.begin(), data.end());
+		});
+
+		if (!queued)
+			this->queue->dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		auto it = this->sinkCallbacks.find(frame->GetSsrc());
+
+		callback = it != this->sinkCallbacks.end() ? it->second : this->callback;
+	}
+
+	if (callback)
+		callback->OnTransformedFrame(std::move(frame));
+}
+
+void StreamRecorder::Tap::RegisterTransformedFrameCallback(
+  rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->callback = callback;
+}
+
+void StreamRecorder::Tap::RegisterTransformedFrameSinkCallback(
+  rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback, uint32_t ssrc)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->sinkCallbacks[ssrc] = callback;
+}
+
+void StreamRecorder::Tap::UnregisterTransformedFrameCallback()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->callback = nullptr;
+}
+
+void StreamRecorder::Tap::UnregisterTransformedFrameSinkCallback(uint32_t ssrc)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->sinkCallbacks.erase(ssrc);
+}
+
+StreamRecorder::StreamRecorder(const Options& options)
+  : options(options), queue(std::make_shared<Queue>(options.queueSize))
+{
+	// Fills the ring once, so that the frame buffers are allocated upfront.
+	while (this->queue->ring.TryPush(
+	  [this](Frame& frame) { frame.data.reserve(this->options.frameBufferSize); }))
+	{
+	}
+
+	while (this->queue->ring.TryPop([](Frame& /*frame*/) {}))
+	{
+	}
+}
+
+StreamRecorder::~StreamRecorder()
+{
+	this->Stop();
+}
+
+void StreamRecorder::Start()
+{
+	BCST_INFO << "StreamRecorder::Start() [directory:" << this->options.directory << "]";
+
+	this->queue->accepting = true;
+	this->thread           = std::thread(&StreamRecorder::Run, this);
+}
+
+bool StreamRecorder::Record(mediasoupclient::Producer* producer)
+{
+	json rtpParameters = producer->GetRtpParameters();
+	std::string mimeType;
+
+	if (rtpParameters.count("codecs") && !rtpParameters["codecs"].empty())
+		mimeType = rtpParameters["codecs"][0].value("mimeType", std::string());
+
+	std::transform(mimeType.begin(), mimeType.end(), mimeType.begin(), ::tolower);
+
+	Source source;
+
+	source.audio  = producer->GetKind() == "audio";
+	source.prefix = this->options.directory + "/" + producer->GetKind() + "-" + producer->GetId();
+
+	if (mimeType == "video/vp8")
+		std::memcpy(source.fourcc, "VP80", 4);
+	else if (mimeType == "video/vp9")
+		std::memcpy(source.fourcc, "VP90", 4);
+	else if (mimeType == "video/h264")
+		std::memcpy(source.fourcc, "H264", 4);
+	else if (mimeType == "video/av1")
+		std::memcpy(source.fourcc, "AV01", 4);
+	else if (mimeType != "audio/opus")
+	{
+		BCST_WARN << "codec can not be recorded [producerId:" << producer->GetId()
+		          << ", mimeType:" << mimeType << "]";
+
+		return false;
+	}
+
+	if (rtpParameters.count("encodings") && rtpParameters["encodings"].is_array())
+	{
+		for (const auto& encoding : rtpParameters["encodings"])
+		{
+			auto ssrc = encoding.value("ssrc", uint32_t{ 0 });
+			auto rid  = encoding.value("rid", std::string());
+
+			if (ssrc != 0 && !rid.empty())
+				source.rids[ssrc] = rid;
+		}
+	}
+
+	uint32_t index;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		index = static_cast<uint32_t>(this->sources.size());
+
+		this->sources.push_back(source);
+	}
+
+	producer->GetRtpSender()->SetEncoderToPacketizerFrameTransformer(
+	  new rtc::RefCountedObject<Tap>(this->queue, index, source.audio));
+
+	BCST_INFO << "recording Producer [id:" << producer->GetId() << ", mimeType:" << mimeType
+	          << "]";
+
+	return true;
+}
+
+void StreamRecorder::Stop()
+{
+	this->queue->accepting = false;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->stopping = true;
+	}
+
+	this->cv.notify_all();
+
+	if (this->thread.joinable())
+		this->thread.join();
+
+	this->Drain();
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	for (auto& kv : this->streams)
+	{
+		this->Close(kv.second, this->sources[kv.first.first]);
+	}
+
+	this->streams.clear();
+}
+
+void StreamRecorder::Run()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	while (!this->stopping)
+	{
+		this->cv.wait_for(lock, kFlushInterval);
+
+		lock.unlock();
+		this->Drain();
+		lock.lock();
+	}
+}
+
+void StreamRecorder::Drain()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	while (this->queue->ring.TryPop([this](Frame& frame) { this->Write(frame); }))
+	{
+	}
+
+	uint64_t dropped = this->queue->dropped.exchange(0, std::memory_order_relaxed);
+
+	if (dropped)
+		BCST_WARN << dropped << " frames left out of the recording, queue full";
+}
+
+void StreamRecorder::Write(const Frame& frame)
+{
+	const auto& source = this->sources[frame.source];
+	auto& stream       = this->streams[std::make_pair(frame.source, frame.ssrc)];
+
+	if (!stream.file)
+	{
+		if (stream.failed)
+			return;
+
+		auto it     = source.rids.find(frame.ssrc);
+		stream.path = source.prefix;
+
+		if (!source.audio)
+			stream.path += "-" + (it != source.rids.end() ? it->second : std::to_string(frame.ssrc));
+
+		stream.path += source.audio ? ".ogg" : ".ivf";
+
+		if (!this->Open(stream, source))
+		{
+			stream.failed = true;
+
+			return;
+		}
+
+		stream.previousTimestamp = frame.timestamp;
+	}
+
+	stream.timestamp += static_cast<int32_t>(frame.timestamp - stream.previousTimestamp);
+	stream.previousTimestamp = frame.timestamp;
+
+	++stream.frames;
+	stream.bytes += frame.data.size();
+
+	if (source.audio)
+	{
+		// Ends with the packet, in 48 kHz samples.
+		stream.granule =
+		  stream.timestamp + opusPacketSamples(frame.data.data(), frame.data.size());
+
+		this->WriteOggPage(stream, 0, frame.data.data(), frame.data.size());
+
+		return;
+	}
+
+	if (frame.keyFrame)
+	{
+		parseFrameSize(
+		  source.fourcc, frame.data.data(), frame.data.size(), stream.width, stream.height);
+	}
+
+	uint8_t header[12];
+
+	put32(header, static_cast<uint32_t>(frame.data.size()));
+	put64(header + 4, static_cast<uint64_t>(stream.timestamp));
+
+	std::fwrite(header, 1, sizeof(header), stream.file);
+	std::fwrite(frame.data.data(), 1, frame.data.size(), stream.file);
+}
+
+bool StreamRecorder::Open(Stream& stream, const Source& source)
+{
+	stream.file = std::fopen(stream.path.c_str(), "wb");
+
+	if (!stream.file)
+	{
+		BCST_ERROR << "unable to open '" << stream.path << "': " << std::strerror(errno);
+
+		return false;
+	}
+
+	stream.writeBuffer.reset(new char[kWriteBufferSize]);
+	std::setvbuf(stream.file, stream.writeBuffer.get(), _IOFBF, kWriteBufferSize);
+
+	if (source.audio)
+	{
+		// Identification header (RFC 7845 5.1): version 1, 2 channels, no
+		// pre-skip, input rate, no gain, mapping family 0.
+		uint8_t head[19]{ 'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 2 };
+
+		put32(head + 12, kOpusClockRate);
+
+		this->WriteOggPage(stream, kOggBeginOfStream, head, sizeof(head));
+
+		// Comment header: vendor string and no comments.
+		const char* vendor = "mediasoup-broadcaster-demo";
+		std::vector<uint8_t> tags{ 'O', 'p', 'u', 's', 'T', 'a', 'g', 's' };
+
+		tags.resize(tags.size() + 4);
+		put32(tags.data() + 8, static_cast<uint32_t>(std::strlen(vendor)));
+		tags.insert(tags.end(), vendor, vendor + std::strlen(vendor));
+		tags.resize(tags.size() + 4, 0);
+
+		this->WriteOggPage(stream, 0, tags.data(), tags.size());
+	}
+	else
+	{
+		// Rewritten on close, with the frame count and size.
+		uint8_t header[kIvfHeaderSize]{ 'D', 'K', 'I', 'F' };
+
+		put16(header + 6, kIvfHeaderSize);
+		std::memcpy(header + 8, source.fourcc, 4);
+		put32(header + 16, kVideoClockRate);
+		put32(header + 20, 1);
+
+		std::fwrite(header, 1, sizeof(header), stream.file);
+	}
+
+	BCST_INFO << "recording into '" << stream.path << "'";
+
+	return true;
+}
+
+void StreamRecorder::WriteOggPage(Stream& stream, uint8_t flags, const uint8_t* data, size_t size)
+{
+	// A single packet per page, at most 255 lacing values.
+	size_t segments = size / 255 + 1;
+
+	if (segments > 255)
+	{
+		BCST_WARN << "packet too large for an Ogg page, skipped [size:" << size << "]";
+
+		return;
+	}
+
+	uint8_t header[27 + 255]{ 'O', 'g', 'g', 'S', 0, flags };
+
+	put64(header + 6, static_cast<uint64_t>(stream.granule));
+	// Serial number, constant.
+	put32(header + 14, 1);
+	put32(header + 18, stream.pages++);
+	header[26] = static_cast<uint8_t>(segments);
+
+	for (size_t i = 0; i < segments; ++i)
+	{
+		header[27 + i] = static_cast<uint8_t>(i + 1 < segments ? 255 : size % 255);
+	}
+
+	size_t headerSize = 27 + segments;
+	uint32_t crc      = oggCrc(oggCrc(0, header, headerSize), data, size);
+
+	put32(header + 22, crc);
+
+	std::fwrite(header, 1, headerSize, stream.file);
+	std::fwrite(data, 1, size, stream.file);
+}
+
+void StreamRecorder::Close(Stream& stream, const Source& source)
+{
+	if (!stream.file)
+		return;
+
+	if (source.audio)
+	{
+		this->WriteOggPage(stream, kOggEndOfStream, nullptr, 0);
+	}
+	else
+	{
+		uint8_t size[4];
+		uint8_t frames[4];
+
+		put16(size, stream.width);
+		put16(size + 2, stream.height);
+		put32(frames, static_cast<uint32_t>(stream.frames));
+
+		std::fseek(stream.file, 12, SEEK_SET);
+		std::fwrite(size, 1, sizeof(size), stream.file);
+		std::fseek(stream.file, 24, SEEK_SET);
+		std::fwrite(frames, 1, sizeof(frames), stream.file);
+	}
+
+	std::fclose(stream.file);
+
+	stream.file = nullptr;
+
+	BCST_INFO << "recorded '" << stream.path << "' [frames:" << stream.frames
+	          << ", bytes:" << stream.bytes << "]";
+}
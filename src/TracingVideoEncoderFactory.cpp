@@ -0,0 +1,134 @@
+#include "TracingVideoEncoderFactory.hpp"
+#include "FrameTracer.hpp"
+#include <utility>
+
+namespace
+{
+	class TracingVideoEncoder : public webrtc::VideoEncoder, public webrtc::EncodedImageCallback
+	{
+	public:
+		explicit TracingVideoEncoder(std::unique_ptr<webrtc::VideoEncoder> encoder)
+		  : encoder(std::move(encoder))
+		{
+		}
+
+		/* Virtual methods inherited from webrtc::VideoEncoder. */
+	public:
+		void SetFecControllerOverride(webrtc::FecControllerOverride* fecControllerOverride) override
+		{
+			this->encoder->SetFecControllerOverride(fecControllerOverride);
+		}
+
+		int InitEncode(const webrtc::VideoCodec* codecSettings, const Settings& settings) override
+		{
+			return this->encoder->InitEncode(codecSettings, settings);
+		}
+
+		int32_t RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback* callback) override
+		{
+			this->callback = callback;
+
+			return this->encoder->RegisterEncodeCompleteCallback(callback ? this : nullptr);
+		}
+
+		int32_t Release() override
+		{
+			return this->encoder->Release();
+		}
+
+		int32_t Encode(
+		  const webrtc::VideoFrame& frame,
+		  const std::vector<webrtc::VideoFrameType>* frameTypes) override
+		{
+			FrameTracer::Record(FrameTracer::kEncodeStart, frame.render_time_ms());
+
+			return this->encoder->Encode(frame, frameTypes);
+		}
+
+		void SetRates(const RateControlParameters& parameters) override
+		{
+			this->encoder->SetRates(parameters);
+		}
+
+		void OnPacketLossRateUpdate(float packetLossRate) override
+		{
+			this->encoder->OnPacketLossRateUpdate(packetLossRate);
+		}
+
+		void OnRttUpdate(int64_t rttMs) override
+		{
+			this->encoder->OnRttUpdate(rttMs);
+		}
+
+		void OnLossNotification(const LossNotification& lossNotification) override
+		{
+			this->encoder->OnLossNotification(lossNotification);
+		}
+
+		EncoderInfo GetEncoderInfo() const override
+		{
+			return this->encoder->GetEncoderInfo();
+		}
+
+		/* Virtual methods inherited from webrtc::EncodedImageCallback. */
+	public:
+		Result OnEncodedImage(
+		  const webrtc::EncodedImage& encodedImage,
+		  const webrtc::CodecSpecificInfo* codecSpecificInfo,
+		  const webrtc::RTPFragmentationHeader* fragmentation) override
+		{
+			// Simulcast layers are reported as spatial indexes.
+			auto layer = static_cast<uint8_t>(encodedImage.SpatialIndex().value_or(0));
+
+			FrameTracer::Record(FrameTracer::kEncodeEnd, encodedImage.capture_time_ms_, layer);
+
+			auto result = this->callback->OnEncodedImage(encodedImage, codecSpecificInfo, fragmentation);
+
+			FrameTracer::Record(FrameTracer::kPacketized, encodedImage.capture_time_ms_, layer);
+
+			return result;
+		}
+
+		void OnDroppedFrame(DropReason reason) override
+		{
+			this->callback->OnDroppedFrame(reason);
+		}
+
+	private:
+		std::unique_ptr<webrtc::VideoEncoder> encoder;
+		webrtc::EncodedImageCallback* callback{ nullptr };
+	};
+} // namespace
+
+TracingVideoEncoderFactory::TracingVideoEncoderFactory(
+  std::unique_ptr<webrtc::VideoEncoderFactory> factory)
+  : factory(std::move(factory))
+{
+}
+
+std::vector<webrtc::SdpVideoFormat> TracingVideoEncoderFactory::GetSupportedFormats() const
+{
+	return this->factory->GetSupportedFormats();
+}
+
+std::vector<webrtc::SdpVideoFormat> TracingVideoEncoderFactory::GetImplementations() const
+{
+	return this->factory->GetImplementations();
+}
+
+webrtc::VideoEncoderFactory::CodecInfo TracingVideoEncoderFactory::QueryVideoEncoder(
+  const webrtc::SdpVideoFormat& format) const
+{
+	return this->factory->QueryVideoEncoder(format);
+}
+
+std::unique_ptr<webrtc::VideoEncoder> TracingVideoEncoderFactory::CreateVideoEncoder(
+  const webrtc::SdpVideoFormat& format)
+{
+	auto encoder = this->factory->CreateVideoEncoder(format);
+
+	if (!encoder)
+		return nullptr;
+
+	return std::unique_ptr<webrtc::VideoEncoder>(new TracingVideoEncoder(std::move(encoder)));
+}
@@ -0,0 +1,189 @@
+#include "TransportRecovery.hpp"
+#include "AsyncLogger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+TransportRecovery::TransportRecovery(
+  const Options& options, RestartIceHandler restartIce, RecreateHandler recreate)
+  : options(options), restartIce(std::move(restartIce)), recreate(std::move(recreate))
+{
+}
+
+TransportRecovery::~TransportRecovery()
+{
+	this->Stop();
+}
+
+void TransportRecovery::Start()
+{
+	BCST_INFO << "TransportRecovery::Start() [maxIceRestarts:" << this->options.maxIceRestarts
+	          << ", initialBackoff:" << this->options.initialBackoffMs
+	          << "ms, maxBackoff:" << this->options.maxBackoffMs << "ms]";
+
+	this->thread = std::thread(&TransportRecovery::Run, this);
+}
+
+void TransportRecovery::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->stopping = true;
+	}
+
+	this->cv.notify_all();
+
+	if (this->thread.joinable())
+		this->thread.join();
+}
+
+void TransportRecovery::OnConnectionStateChange(
+  const std::string& transportId, const std::string& state)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		// Closed transports are gone for good, e.g. replaced by recreated ones.
+		if (state == "closed")
+			this->states.erase(transportId);
+		else
+			this->states[transportId] = state;
+	}
+
+	this->cv.notify_all();
+}
+
+void TransportRecovery::Run()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	while (true)
+	{
+		this->cv.wait(lock, [this] { return this->stopping || this->IsFailing(); });
+
+		if (this->stopping)
+			break;
+
+		this->Recover(lock);
+	}
+}
+
+void TransportRecovery::Recover(std::unique_lock<std::mutex>& lock)
+{
+	BCST_WARN << "transport connection lost, recovering...";
+
+	bool iceRestartable = true;
+	uint32_t attempt    = 0;
+
+	while (!this->stopping && !this->IsConnected())
+	{
+		auto backoff = std::chrono::milliseconds(this->GetBackoffMs(attempt));
+
+		if (this->cv.wait_for(
+		      lock, backoff, [this] { return this->stopping || this->IsConnected(); }))
+		{
+			break;
+		}
+
+		++attempt;
+
+		if (iceRestartable && attempt <= this->options.maxIceRestarts)
+		{
+			std::vector<std::string> transportIds;
+
+			for (const auto& kv : this->states)
+			{
+				if (kv.second == "disconnected" || kv.second == "failed")
+					transportIds.push_back(kv.first);
+			}
+
+			BCST_INFO << "restarting ICE [attempt:" << attempt << ", transports:" << transportIds.size()
+			          << "]";
+
+			lock.unlock();
+
+			for (const auto& transportId : transportIds)
+			{
+				if (!this->restartIce(transportId))
+					iceRestartable = false;
+			}
+
+			lock.lock();
+
+			// Retrying won't help, go straight to recreating the transports.
+			if (!iceRestartable)
+				continue;
+		}
+		else
+		{
+			BCST_WARN << "recreating transports [attempt:" << attempt << "]";
+
+			// The recreated transports report their own states.
+			this->states.clear();
+
+			lock.unlock();
+
+			bool recreated = this->recreate();
+
+			lock.lock();
+
+			if (!recreated)
+			{
+				BCST_ERROR << "failed to recreate transports";
+
+				continue;
+			}
+		}
+
+		this->cv.wait_for(lock, std::chrono::milliseconds(this->options.connectTimeoutMs), [this] {
+			return this->stopping || this->IsConnected();
+		});
+	}
+
+	if (!this->stopping)
+		BCST_INFO << "transports recovered [attempts:" << attempt << "]";
+}
+
+bool TransportRecovery::IsFailing() const
+{
+	for (const auto& kv : this->states)
+	{
+		if (kv.second == "disconnected" || kv.second == "failed")
+			return true;
+	}
+
+	return false;
+}
+
+bool TransportRecovery::IsConnected() const
+{
+	if (this->states.empty())
+		return false;
+
+	for (const auto& kv : this->states)
+	{
+		if (kv.second != "connected" && kv.second != "completed")
+			return false;
+	}
+
+	return true;
+}
+
+uint32_t TransportRecovery::GetBackoffMs(uint32_t attempt)
+{
+	uint64_t backoffMs = this->options.initialBackoffMs;
+
+	for (uint32_t i = 0; i < attempt && backoffMs < this->options.maxBackoffMs; ++i)
+	{
+		backoffMs *= 2;
+	}
+
+	backoffMs = std::min<uint64_t>(backoffMs, this->options.maxBackoffMs);
+
+	// Equal jitter: half fixed, half random, so that clients that lost the
+	// network together don't hit the server in lockstep.
+	std::uniform_int_distribution<uint64_t> jitter(0, backoffMs / 2);
+
+	return static_cast<uint32_t>(backoffMs - backoffMs / 2 + jitter(this->random));
+}
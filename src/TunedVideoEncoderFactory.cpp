@@ -0,0 +1,176 @@
+#include "TunedVideoEncoderFactory.hpp"
+#include "AsyncLogger.hpp"
+#include <utility>
+
+namespace
+{
+	class TunedVideoEncoder : public webrtc::VideoEncoder
+	{
+	public:
+		TunedVideoEncoder(
+		  const TunedVideoEncoderFactory::Options& options,
+		  std::unique_ptr<webrtc::VideoEncoder> encoder)
+		  : options(options), encoder(std::move(encoder))
+		{
+		}
+
+		/* Virtual methods inherited from webrtc::VideoEncoder. */
+	public:
+		void SetFecControllerOverride(webrtc::FecControllerOverride* fecControllerOverride) override
+		{
+			this->encoder->SetFecControllerOverride(fecControllerOverride);
+		}
+
+		int InitEncode(const webrtc::VideoCodec* codecSettings, const Settings& settings) override
+		{
+			if (!codecSettings)
+				return this->encoder->InitEncode(codecSettings, settings);
+
+			webrtc::VideoCodec tunedCodecSettings = *codecSettings;
+			Settings tunedSettings                = settings;
+
+			// Encoders size their thread pool from the number of cores.
+			if (this->options.threads > 0)
+				tunedSettings.number_of_cores = static_cast<int>(this->options.threads);
+
+			if (this->options.complexity != TunedVideoEncoderFactory::Complexity::kDefault)
+			{
+				auto complexity = static_cast<webrtc::VideoCodecComplexity>(
+				  static_cast<int>(this->options.complexity) - 1);
+
+				if (tunedCodecSettings.codecType == webrtc::kVideoCodecVP8)
+					tunedCodecSettings.VP8()->complexity = complexity;
+				else if (tunedCodecSettings.codecType == webrtc::kVideoCodecVP9)
+					tunedCodecSettings.VP9()->complexity = complexity;
+			}
+
+			switch (this->options.contentType)
+			{
+				case TunedVideoEncoderFactory::ContentType::kRealtime:
+					tunedCodecSettings.mode = webrtc::VideoCodecMode::kRealtimeVideo;
+					break;
+
+				case TunedVideoEncoderFactory::ContentType::kScreenshare:
+					tunedCodecSettings.mode = webrtc::VideoCodecMode::kScreensharing;
+					break;
+
+				default:
+					break;
+			}
+
+			BCST_INFO << "TunedVideoEncoder::InitEncode() [codec:"
+			          << webrtc::CodecTypeToPayloadString(tunedCodecSettings.codecType)
+			          << ", cores:" << tunedSettings.number_of_cores << "]";
+
+			return this->encoder->InitEncode(&tunedCodecSettings, tunedSettings);
+		}
+
+		int32_t RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback* callback) override
+		{
+			return this->encoder->RegisterEncodeCompleteCallback(callback);
+		}
+
+		int32_t Release() override
+		{
+			return this->encoder->Release();
+		}
+
+		int32_t Encode(
+		  const webrtc::VideoFrame& frame,
+		  const std::vector<webrtc::VideoFrameType>* frameTypes) override
+		{
+			return this->encoder->Encode(frame, frameTypes);
+		}
+
+		void SetRates(const RateControlParameters& parameters) override
+		{
+			this->encoder->SetRates(parameters);
+		}
+
+		void OnPacketLossRateUpdate(float packetLossRate) override
+		{
+			this->encoder->OnPacketLossRateUpdate(packetLossRate);
+		}
+
+		void OnRttUpdate(int64_t rttMs) override
+		{
+			this->encoder->OnRttUpdate(rttMs);
+		}
+
+		void OnLossNotification(const LossNotification& lossNotification) override
+		{
+			this->encoder->OnLossNotification(lossNotification);
+		}
+
+		EncoderInfo GetEncoderInfo() const override
+		{
+			return this->encoder->GetEncoderInfo();
+		}
+
+	private:
+		TunedVideoEncoderFactory::Options options;
+		std::unique_ptr<webrtc::VideoEncoder> encoder;
+	};
+} // namespace
+
+bool TunedVideoEncoderFactory::ParseComplexity(const std::string& name, Complexity& complexity)
+{
+	if (name == "normal")
+		complexity = Complexity::kNormal;
+	else if (name == "high")
+		complexity = Complexity::kHigh;
+	else if (name == "higher")
+		complexity = Complexity::kHigher;
+	else if (name == "max")
+		complexity = Complexity::kMax;
+	else
+		return false;
+
+	return true;
+}
+
+bool TunedVideoEncoderFactory::ParseContentType(const std::string& name, ContentType& contentType)
+{
+	if (name == "realtime")
+		contentType = ContentType::kRealtime;
+	else if (name == "screenshare")
+		contentType = ContentType::kScreenshare;
+	else
+		return false;
+
+	return true;
+}
+
+TunedVideoEncoderFactory::TunedVideoEncoderFactory(
+  const Options& options, std::unique_ptr<webrtc::VideoEncoderFactory> factory)
+  : options(options), factory(std::move(factory))
+{
+}
+
+std::vector<webrtc::SdpVideoFormat> TunedVideoEncoderFactory::GetSupportedFormats() const
+{
+	return this->factory->GetSupportedFormats();
+}
+
+std::vector<webrtc::SdpVideoFormat> TunedVideoEncoderFactory::GetImplementations() const
+{
+	return this->factory->GetImplementations();
+}
+
+webrtc::VideoEncoderFactory::CodecInfo TunedVideoEncoderFactory::QueryVideoEncoder(
+  const webrtc::SdpVideoFormat& format) const
+{
+	return this->factory->QueryVideoEncoder(format);
+}
+
+std::unique_ptr<webrtc::VideoEncoder> TunedVideoEncoderFactory::CreateVideoEncoder(
+  const webrtc::SdpVideoFormat& format)
+{
+	auto encoder = this->factory->CreateVideoEncoder(format);
+
+	if (!encoder)
+		return nullptr;
+
+	return std::unique_ptr<webrtc::VideoEncoder>(
+	  new TunedVideoEncoder(this->options, std::move(encoder)));
+}
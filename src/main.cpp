@@ -1,50 +1,238 @@
-﻿#include "Broadcaster.hpp"
+#include "AsyncLogger.hpp"
+#include "BatchingSocketServer.hpp"
+#include "Broadcaster.hpp"
+#include "JoinBenchmark.hpp"
+#include "MediaStreamTrackFactory.hpp"
+#include "MockServer.hpp"
+#include "NullVideoDecoderFactory.hpp"
+#include "RtcEventLogWriter.hpp"
+#include "TunedVideoEncoderFactory.hpp"
+#include "api/video_codecs/builtin_video_decoder_factory.h"
+#include "api/video_codecs/builtin_video_encoder_factory.h"
 #include "mediasoupclient.hpp"
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cpr/cpr.h>
-#include <csignal> // sigsuspend()
+#include <csignal> // sigaction()
+#include <cstdint>
 #include <cstdlib>
-#include <iostream>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unistd.h>
 
 using json = nlohmann::json;
 
+// Parses an unsigned integer environment variable into |value| if present.
+// Returns false if the variable is set but is not a valid number.
+static bool getEnvUnsigned(const char* name, uint64_t& value)
+{
+	const char* env = std::getenv(name);
+
+	if (env == nullptr)
+		return true;
+
+	try
+	{
+		size_t pos = 0;
+		value      = std::stoull(env, &pos);
+
+		if (pos == std::string(env).size())
+			return true;
+	}
+	catch (const std::exception&)
+	{
+	}
+
+	BCST_ERROR << "invalid '" << name << "' environment variable";
+
+	return false;
+}
+
+// Self-pipe: the signal handler only writes the signal number into it, as
+// nothing but async-signal-safe calls may run there, and main() reads it.
+static int signalPipe[2] = { -1, -1 };
+static volatile std::sig_atomic_t signalReceived = 0;
+
 void signalHandler(int signum)
 {
-	std::cout << "[INFO] interrupt signal (" << signum << ") received" << std::endl;
+	// A second signal while shutting down exits right away.
+	if (signalReceived)
+		_exit(128 + signum);
+
+	signalReceived = 1;
+
+	char byte = static_cast<char>(signum);
+	// Nothing to do if it fails, the write end is non-blocking.
+	ssize_t written = ::write(signalPipe[1], &byte, 1);
+	(void)written;
+}
+
+static bool registerSignalHandler()
+{
+	if (::pipe(signalPipe) != 0)
+		return false;
+
+	for (int fd : signalPipe)
+	{
+		::fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+
+	::fcntl(signalPipe[1], F_SETFL, ::fcntl(signalPipe[1], F_GETFL) | O_NONBLOCK);
+
+	struct sigaction action = {};
+
+	action.sa_handler = signalHandler;
+	action.sa_flags   = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+
+	return ::sigaction(SIGINT, &action, nullptr) == 0 && ::sigaction(SIGTERM, &action, nullptr) == 0;
+}
+
+// Blocks until SIGINT or SIGTERM is received and returns its number.
+static int waitForSignal()
+{
+	char byte = 0;
+
+	while (true)
+	{
+		ssize_t n = ::read(signalPipe[0], &byte, 1);
+
+		if (n == 1)
+			return byte;
+
+		if (n < 0 && errno == EINTR)
+			continue;
 
-	std::cout << "[INFO] leaving!" << std::endl;
+		BCST_ERROR << "unable to read the signal pipe";
 
-	std::exit(signum);
+		return 0;
+	}
 }
 
 int main(int /*argc*/, char* /*argv*/[])
 {
-	// Register signal SIGINT and signal handler.
-	signal(SIGINT, signalHandler);
+	// Register SIGINT and SIGTERM signal handler.
+	if (!registerSignalHandler())
+	{
+		BCST_ERROR << "unable to register the signal handler";
+
+		return 1;
+	}
 
 	// Retrieve configuration from environment variables.
-	const char* envServerUrl    = std::getenv("SERVER_URL");
-	const char* envRoomId       = std::getenv("ROOM_ID");
-	const char* envEnableAudio  = std::getenv("ENABLE_AUDIO");
-	const char* envUseSimulcast = std::getenv("USE_SIMULCAST");
-	const char* envWebrtcDebug  = std::getenv("WEBRTC_DEBUG");
-	const char* envVerifySsl    = std::getenv("VERIFY_SSL");
+	const char* envServerUrl     = std::getenv("SERVER_URL");
+	const char* envRoomId        = std::getenv("ROOM_ID");
+	const char* envEnableAudio   = std::getenv("ENABLE_AUDIO");
+	const char* envUseSimulcast  = std::getenv("USE_SIMULCAST");
+	const char* envWebrtcDebug   = std::getenv("WEBRTC_DEBUG");
+	const char* envVerifySsl     = std::getenv("VERIFY_SSL");
+	const char* envDataBenchmark = std::getenv("DATA_BENCHMARK");
+	const char* envLatencyProbe  = std::getenv("LATENCY_PROBE");
+	const char* envProbeExport   = std::getenv("LATENCY_PROBE_EXPORT_FILE");
+	const char* envDataCoalesce  = std::getenv("DATA_SENDER_COALESCE");
+	const char* envFileTransfer  = std::getenv("FILE_TRANSFER_PATH");
+	const char* envFileOutputDir = std::getenv("FILE_TRANSFER_OUTPUT_DIR");
+	const char* envMetricsPort   = std::getenv("METRICS_PORT");
+	const char* envMetricsHost   = std::getenv("METRICS_HOST");
+	const char* envFrameTrace    = std::getenv("FRAME_TRACE");
+	const char* envTraceFile     = std::getenv("FRAME_TRACE_FILE");
+	const char* envLogLevel      = std::getenv("LOG_LEVEL");
+	const char* envLogFormat     = std::getenv("LOG_FORMAT");
+	const char* envLogFile       = std::getenv("LOG_FILE");
+	const char* envMockServer    = std::getenv("MOCK_SERVER");
+	const char* envControlSocket = std::getenv("CONTROL_SOCKET");
+	const char* envVideoCodec    = std::getenv("VIDEO_CODEC");
+	const char* envComplexity    = std::getenv("VIDEO_ENCODER_COMPLEXITY");
+	const char* envContentType   = std::getenv("VIDEO_CONTENT_TYPE");
+	const char* envConsume       = std::getenv("CONSUME");
+	const char* envConsumeDecode = std::getenv("CONSUME_DECODE");
+	const char* envLoopback      = std::getenv("CONSUME_LOOPBACK");
+	const char* envQuality       = std::getenv("CONSUME_QUALITY");
+	const char* envVideoOverlay  = std::getenv("VIDEO_TIMESTAMP_OVERLAY");
+	const char* envAudioChirps   = std::getenv("AUDIO_CHIRPS");
+	const char* envRecordDir     = std::getenv("RECORD_DIR");
+	const char* envEventLogDir   = std::getenv("RTC_EVENT_LOG_DIR");
+	const char* envUdpBatching   = std::getenv("UDP_BATCHING");
+	const char* envUdpOffload    = std::getenv("UDP_SEGMENTATION_OFFLOAD");
+
+	AsyncLogger::Options loggerOptions;
+	uint64_t logRateLimit = loggerOptions.rateLimit;
+
+	if (envLogLevel && !AsyncLogger::ParseLevel(envLogLevel, loggerOptions.level))
+	{
+		BCST_ERROR << "invalid 'LOG_LEVEL' environment variable";
+
+		return 1;
+	}
+
+	if (envLogFormat && !AsyncLogger::ParseFormat(envLogFormat, loggerOptions.format))
+	{
+		BCST_ERROR << "invalid 'LOG_FORMAT' environment variable";
+
+		return 1;
+	}
+
+	if (!getEnvUnsigned("LOG_RATE_LIMIT", logRateLimit))
+		return 1;
+
+	loggerOptions.rateLimit = static_cast<uint32_t>(logRateLimit);
+
+	if (envLogFile)
+		loggerOptions.file = envLogFile;
+
+	AsyncLogger::Start(loggerOptions);
+
+	bool useMockServer = false;
+	if (envMockServer && std::string(envMockServer) == "true")
+		useMockServer = true;
+
+	MockServer::Options mockServerOptions;
+	uint64_t mockServerPort = mockServerOptions.port;
+	uint64_t mockServerRtt  = mockServerOptions.rttMs;
+
+	if (
+	  !getEnvUnsigned("MOCK_SERVER_PORT", mockServerPort) ||
+	  !getEnvUnsigned("MOCK_SERVER_RTT", mockServerRtt))
+	{
+		return 1;
+	}
 
-	if (envServerUrl == nullptr)
+	if (mockServerPort > UINT16_MAX)
 	{
-		std::cerr << "[ERROR] missing 'SERVER_URL' environment variable" << std::endl;
+		BCST_ERROR << "invalid 'MOCK_SERVER_PORT' environment variable";
+
+		return 1;
+	}
+
+	mockServerOptions.port  = static_cast<uint16_t>(mockServerPort);
+	mockServerOptions.rttMs = static_cast<uint32_t>(mockServerRtt);
+
+	// Must outlive the Broadcaster.
+	MockServer mockServer(mockServerOptions);
+
+	if (useMockServer && !mockServer.Start())
+		return 1;
+
+	if (envServerUrl == nullptr && !useMockServer)
+	{
+		BCST_ERROR << "missing 'SERVER_URL' environment variable";
 
 		return 1;
 	}
 
 	if (envRoomId == nullptr)
 	{
-		std::cerr << "[ERROR] missing 'ROOM_ID' environment variable" << std::endl;
+		BCST_ERROR << "missing 'ROOM_ID' environment variable";
 
 		return 1;
 	}
 
-	std::string baseUrl = envServerUrl;
+	std::string baseUrl = useMockServer ? mockServer.GetUrl() : envServerUrl;
 	baseUrl.append("/rooms/").append(envRoomId);
 
 	bool enableAudio = true;
@@ -57,57 +245,468 @@ int main(int /*argc*/, char* /*argv*/[])
 	if (envUseSimulcast && std::string(envUseSimulcast) == "false")
 		useSimulcast = false;
 
+	std::string videoCodec = envVideoCodec ? envVideoCodec : "";
+	bool timestampOverlay  = envVideoOverlay && std::string(envVideoOverlay) == "true";
+	bool audioChirps       = envAudioChirps && std::string(envAudioChirps) == "true";
+
+	// Before any track or transport creates the peerconnection factory.
+	if (audioChirps)
+		enableAudioChirps();
+
+	RtcEventLogWriter::Options eventLogOptions;
+	uint64_t eventLogOutputPeriod = eventLogOptions.outputPeriodMs;
+	uint64_t eventLogMaxFileAge   = eventLogOptions.maxFileSeconds;
+	uint64_t eventLogMaxFiles     = eventLogOptions.maxFiles;
+
+	if (
+	  !getEnvUnsigned("RTC_EVENT_LOG_OUTPUT_PERIOD", eventLogOutputPeriod) ||
+	  !getEnvUnsigned("RTC_EVENT_LOG_MAX_FILE_SIZE", eventLogOptions.maxFileSize) ||
+	  !getEnvUnsigned("RTC_EVENT_LOG_MAX_FILE_AGE", eventLogMaxFileAge) ||
+	  !getEnvUnsigned("RTC_EVENT_LOG_MAX_FILES", eventLogMaxFiles))
+	{
+		return 1;
+	}
+
+	eventLogOptions.outputPeriodMs = static_cast<uint32_t>(eventLogOutputPeriod);
+	eventLogOptions.maxFileSeconds = static_cast<uint32_t>(eventLogMaxFileAge);
+	eventLogOptions.maxFiles       = static_cast<uint32_t>(eventLogMaxFiles);
+
+	BatchingSocketServer::Options udpBatchingOptions;
+	uint64_t udpBatchSize = udpBatchingOptions.batchSize;
+
+	if (!getEnvUnsigned("UDP_BATCH_SIZE", udpBatchSize))
+		return 1;
+
+	if (udpBatchSize > BatchingSocketServer::kMaxBatchSize)
+	{
+		BCST_ERROR << "invalid 'UDP_BATCH_SIZE' environment variable";
+
+		return 1;
+	}
+
+	udpBatchingOptions.batchSize = static_cast<uint32_t>(udpBatchSize);
+
+	if (envUdpOffload && std::string(envUdpOffload) == "true")
+		udpBatchingOptions.segmentationOffload = true;
+
+	if (envUdpBatching && std::string(envUdpBatching) == "true")
+		enableUdpBatching(udpBatchingOptions);
+
+	// Outlives the factory, whose PeerConnections may output until released.
+	std::unique_ptr<RtcEventLogWriter> eventLogWriter;
+
+	if (envEventLogDir)
+	{
+		eventLogOptions.directory = envEventLogDir;
+
+		eventLogWriter.reset(new RtcEventLogWriter(eventLogOptions));
+		eventLogWriter->Start();
+
+		enableRtcEventLog(eventLogWriter.get());
+	}
+
+	TunedVideoEncoderFactory::Options encoderOptions;
+	uint64_t encoderThreads = encoderOptions.threads;
+
+	if (!getEnvUnsigned("VIDEO_ENCODER_THREADS", encoderThreads))
+		return 1;
+
+	encoderOptions.threads = static_cast<uint32_t>(encoderThreads);
+
+	if (
+	  envComplexity &&
+	  !TunedVideoEncoderFactory::ParseComplexity(envComplexity, encoderOptions.complexity))
+	{
+		BCST_ERROR << "invalid 'VIDEO_ENCODER_COMPLEXITY' environment variable";
+
+		return 1;
+	}
+
+	if (
+	  envContentType &&
+	  !TunedVideoEncoderFactory::ParseContentType(envContentType, encoderOptions.contentType))
+	{
+		BCST_ERROR << "invalid 'VIDEO_CONTENT_TYPE' environment variable";
+
+		return 1;
+	}
+
+	// Before any track or transport creates the peerconnection factory.
+	if (
+	  encoderOptions.threads > 0 ||
+	  encoderOptions.complexity != TunedVideoEncoderFactory::Complexity::kDefault ||
+	  encoderOptions.contentType != TunedVideoEncoderFactory::ContentType::kDefault)
+	{
+		setVideoEncoderFactory(std::unique_ptr<webrtc::VideoEncoderFactory>(
+		  new TunedVideoEncoderFactory(encoderOptions, webrtc::CreateBuiltinVideoEncoderFactory())));
+	}
+
 	bool verifySsl = true;
 	if (envVerifySsl && std::string(envVerifySsl) == "false")
 		verifySsl = false;
 
-	// Set RTC logging severity.
-	if (envWebrtcDebug)
+	DataSender::Options dataSenderOptions;
+	uint64_t dataSenderFlushInterval  = dataSenderOptions.flushIntervalMs;
+	uint64_t dataSenderMaxQueuedBytes = dataSenderOptions.maxQueuedBytes;
+
+	if (envDataCoalesce && std::string(envDataCoalesce) == "true")
+		dataSenderOptions.coalesce = true;
+
+	if (
+	  !getEnvUnsigned("DATA_SENDER_FLUSH_INTERVAL", dataSenderFlushInterval) ||
+	  !getEnvUnsigned("DATA_SENDER_MAX_QUEUED_BYTES", dataSenderMaxQueuedBytes))
+	{
+		return 1;
+	}
+
+	dataSenderOptions.flushIntervalMs = static_cast<uint32_t>(dataSenderFlushInterval);
+	dataSenderOptions.maxQueuedBytes  = static_cast<size_t>(dataSenderMaxQueuedBytes);
+
+	bool enableDataBenchmark = false;
+	if (envDataBenchmark && std::string(envDataBenchmark) == "true")
+		enableDataBenchmark = true;
+
+	DataChannelBenchmark::Options dataBenchmarkOptions;
+	uint64_t dataBenchmarkMessageSize    = dataBenchmarkOptions.messageSize;
+	uint64_t dataBenchmarkReportInterval = dataBenchmarkOptions.reportIntervalSeconds;
+
+	if (
+	  !getEnvUnsigned("DATA_BENCHMARK_MESSAGE_SIZE", dataBenchmarkMessageSize) ||
+	  !getEnvUnsigned("DATA_BENCHMARK_HIGH_WATER_MARK", dataBenchmarkOptions.highWaterMark) ||
+	  !getEnvUnsigned("DATA_BENCHMARK_LOW_WATER_MARK", dataBenchmarkOptions.lowWaterMark) ||
+	  !getEnvUnsigned("DATA_BENCHMARK_REPORT_INTERVAL", dataBenchmarkReportInterval))
+	{
+		return 1;
+	}
+
+	dataBenchmarkOptions.messageSize           = static_cast<size_t>(dataBenchmarkMessageSize);
+	dataBenchmarkOptions.reportIntervalSeconds = static_cast<uint32_t>(dataBenchmarkReportInterval);
+
+	bool enableLatencyProbe = false;
+	if (envLatencyProbe && std::string(envLatencyProbe) == "true")
+		enableLatencyProbe = true;
+
+	LatencyProbe::Options latencyProbeOptions;
+	uint64_t latencyProbeInterval       = latencyProbeOptions.intervalMs;
+	uint64_t latencyProbeTimeout        = latencyProbeOptions.timeoutMs;
+	uint64_t latencyProbeExportInterval = latencyProbeOptions.exportIntervalSeconds;
+
+	if (
+	  !getEnvUnsigned("LATENCY_PROBE_INTERVAL", latencyProbeInterval) ||
+	  !getEnvUnsigned("LATENCY_PROBE_TIMEOUT", latencyProbeTimeout) ||
+	  !getEnvUnsigned("LATENCY_PROBE_EXPORT_INTERVAL", latencyProbeExportInterval))
+	{
+		return 1;
+	}
+
+	latencyProbeOptions.intervalMs            = static_cast<uint32_t>(latencyProbeInterval);
+	latencyProbeOptions.timeoutMs             = static_cast<uint32_t>(latencyProbeTimeout);
+	latencyProbeOptions.exportIntervalSeconds = static_cast<uint32_t>(latencyProbeExportInterval);
+
+	if (envProbeExport)
+		latencyProbeOptions.exportFile = envProbeExport;
+
+	// Receiving only requires an output directory.
+	bool enableFileTransfer = envFileTransfer || envFileOutputDir;
+
+	FileTransfer::Options fileTransferOptions;
+	uint64_t fileTransferChunkSize = fileTransferOptions.chunkSize;
+
+	if (
+	  !getEnvUnsigned("FILE_TRANSFER_CHUNK_SIZE", fileTransferChunkSize) ||
+	  !getEnvUnsigned("FILE_TRANSFER_WINDOW_SIZE", fileTransferOptions.windowSize))
+	{
+		return 1;
+	}
+
+	fileTransferOptions.chunkSize = static_cast<size_t>(fileTransferChunkSize);
+
+	if (envFileTransfer)
+		fileTransferOptions.sendPath = envFileTransfer;
+
+	if (envFileOutputDir)
+		fileTransferOptions.outputDir = envFileOutputDir;
+
+	bool enableStats = envMetricsPort != nullptr;
+
+	StatsCollector::Options statsOptions;
+	uint64_t metricsPort   = statsOptions.port;
+	uint64_t statsInterval = statsOptions.intervalMs;
+
+	if (
+	  !getEnvUnsigned("METRICS_PORT", metricsPort) ||
+	  !getEnvUnsigned("STATS_INTERVAL", statsInterval))
+	{
+		return 1;
+	}
+
+	if (metricsPort > UINT16_MAX)
+	{
+		BCST_ERROR << "invalid 'METRICS_PORT' environment variable";
+
+		return 1;
+	}
+
+	statsOptions.port       = static_cast<uint16_t>(metricsPort);
+	statsOptions.intervalMs = static_cast<uint32_t>(statsInterval);
+
+	if (envMetricsHost)
+		statsOptions.host = envMetricsHost;
+
+	bool enableConsumers = envConsume && std::string(envConsume) == "true";
+
+	ConsumerMonitor::Options consumerOptions;
+	uint64_t consumeMaxProducers   = consumerOptions.maxProducers;
+	uint64_t consumeCopies         = consumerOptions.copies;
+	uint64_t consumeReportInterval = consumerOptions.reportIntervalSeconds;
+
+	if (
+	  !getEnvUnsigned("CONSUME_MAX_PRODUCERS", consumeMaxProducers) ||
+	  !getEnvUnsigned("CONSUME_COPIES", consumeCopies) ||
+	  !getEnvUnsigned("CONSUME_REPORT_INTERVAL", consumeReportInterval))
+	{
+		return 1;
+	}
+
+	consumerOptions.maxProducers          = static_cast<uint32_t>(consumeMaxProducers);
+	consumerOptions.copies                = static_cast<uint32_t>(consumeCopies);
+	consumerOptions.reportIntervalSeconds = static_cast<uint32_t>(consumeReportInterval);
+
+	if (envConsumeDecode && std::string(envConsumeDecode) == "false")
+		consumerOptions.decode = false;
+
+	if (envQuality && std::string(envQuality) == "true")
+		consumerOptions.quality = true;
+
+	consumerOptions.chirps = audioChirps;
+
+	// By default whenever we stamp what we send, nobody else does.
+	if (envLoopback)
+		consumerOptions.loopback = std::string(envLoopback) == "true";
+	else
+		consumerOptions.loopback = timestampOverlay || audioChirps;
+
+	// Before any track or transport creates the peerconnection factory.
+	if (enableConsumers && !consumerOptions.decode)
+	{
+		setVideoDecoderFactory(std::unique_ptr<webrtc::VideoDecoderFactory>(
+		  new NullVideoDecoderFactory(webrtc::CreateBuiltinVideoDecoderFactory())));
+	}
+
+	bool enableFrameTrace = false;
+	if (envFrameTrace && std::string(envFrameTrace) == "true")
+		enableFrameTrace = true;
+
+	// Not to add a virtual call per encoded frame otherwise.
+	if (enableFrameTrace)
+		enableEncoderTracing();
+
+	FrameTracer::Options frameTraceOptions;
+	uint64_t frameTraceExportInterval = frameTraceOptions.exportIntervalSeconds;
+
+	if (!getEnvUnsigned("FRAME_TRACE_EXPORT_INTERVAL", frameTraceExportInterval))
+		return 1;
+
+	frameTraceOptions.exportIntervalSeconds = static_cast<uint32_t>(frameTraceExportInterval);
+
+	if (envTraceFile)
+		frameTraceOptions.traceFile = envTraceFile;
+
+	StreamRecorder::Options recordOptions;
+	uint64_t recordQueueSize = recordOptions.queueSize;
+
+	if (!getEnvUnsigned("RECORD_QUEUE_SIZE", recordQueueSize))
+		return 1;
+
+	recordOptions.queueSize = static_cast<uint32_t>(recordQueueSize);
+
+	if (envRecordDir)
+		recordOptions.directory = envRecordDir;
+
+	ControlServer::Options controlOptions;
+
+	if (envControlSocket)
+		controlOptions.path = envControlSocket;
+
+	uint64_t leaveTimeout    = 1000;
+	uint64_t shutdownTimeout = 5000;
+
+	if (
+	  !getEnvUnsigned("LEAVE_TIMEOUT", leaveTimeout) ||
+	  !getEnvUnsigned("SHUTDOWN_TIMEOUT", shutdownTimeout))
 	{
-		if (std::string(envWebrtcDebug) == "info")
-			rtc::LogMessage::LogToDebug(rtc::LoggingSeverity::LS_INFO);
-		else if (std::string(envWebrtcDebug) == "warn")
-			rtc::LogMessage::LogToDebug(rtc::LoggingSeverity::LS_WARNING);
-		else if (std::string(envWebrtcDebug) == "error")
-			rtc::LogMessage::LogToDebug(rtc::LoggingSeverity::LS_ERROR);
+		return 1;
 	}
 
-	auto logLevel = mediasoupclient::Logger::LogLevel::LOG_DEBUG;
-	mediasoupclient::Logger::SetLogLevel(logLevel);
-	mediasoupclient::Logger::SetDefaultHandler();
+	TransportRecovery::Options recoveryOptions;
+	uint64_t recoveryMaxIceRestarts = recoveryOptions.maxIceRestarts;
+	uint64_t recoveryInitialBackoff = recoveryOptions.initialBackoffMs;
+	uint64_t recoveryMaxBackoff     = recoveryOptions.maxBackoffMs;
+	uint64_t recoveryConnectTimeout = recoveryOptions.connectTimeoutMs;
+
+	if (
+	  !getEnvUnsigned("RECOVERY_MAX_ICE_RESTARTS", recoveryMaxIceRestarts) ||
+	  !getEnvUnsigned("RECOVERY_INITIAL_BACKOFF", recoveryInitialBackoff) ||
+	  !getEnvUnsigned("RECOVERY_MAX_BACKOFF", recoveryMaxBackoff) ||
+	  !getEnvUnsigned("RECOVERY_CONNECT_TIMEOUT", recoveryConnectTimeout))
+	{
+		return 1;
+	}
+
+	recoveryOptions.maxIceRestarts   = static_cast<uint32_t>(recoveryMaxIceRestarts);
+	recoveryOptions.initialBackoffMs = static_cast<uint32_t>(recoveryInitialBackoff);
+	recoveryOptions.maxBackoffMs     = static_cast<uint32_t>(recoveryMaxBackoff);
+	recoveryOptions.connectTimeoutMs = static_cast<uint32_t>(recoveryConnectTimeout);
+
+	JoinBenchmark::Options joinBenchmarkOptions;
+	uint64_t joinBenchmarkRuns = 0;
+	// Media never flows with the mock server, don't wait for it by default.
+	uint64_t joinBenchmarkMediaTimeout = useMockServer ? 0 : 5000;
+	uint64_t joinBenchmarkMaxP95       = joinBenchmarkOptions.maxJoinP95Ms;
+
+	if (
+	  !getEnvUnsigned("JOIN_BENCHMARK_RUNS", joinBenchmarkRuns) ||
+	  !getEnvUnsigned("JOIN_BENCHMARK_MEDIA_TIMEOUT", joinBenchmarkMediaTimeout) ||
+	  !getEnvUnsigned("JOIN_BENCHMARK_MAX_P95", joinBenchmarkMaxP95))
+	{
+		return 1;
+	}
+
+	joinBenchmarkOptions.runs           = static_cast<uint32_t>(joinBenchmarkRuns);
+	joinBenchmarkOptions.mediaTimeoutMs = static_cast<uint32_t>(joinBenchmarkMediaTimeout);
+	joinBenchmarkOptions.maxJoinP95Ms   = static_cast<uint32_t>(joinBenchmarkMaxP95);
+
+	// Route RTC logs, if requested, and mediasoupclient logs through the logger.
+	if (envWebrtcDebug)
+		AsyncLogger::RouteWebrtcLogs(envWebrtcDebug);
+
+	AsyncLogger::RouteMediasoupclientLogs();
 
 	// Initilize mediasoupclient.
 	mediasoupclient::Initialize();
 
-	std::cout << "[INFO] welcome to mediasoup broadcaster app!\n" << std::endl;
+	BCST_INFO << "welcome to mediasoup broadcaster app!";
+
+	// Join benchmark mode, exits with the benchmark result.
+	if (joinBenchmarkOptions.runs > 0)
+	{
+		JoinBenchmark joinBenchmark(joinBenchmarkOptions);
+
+		bool passed = joinBenchmark.Run(baseUrl, enableAudio, useSimulcast, verifySsl);
+
+		releasePeerConnectionFactory();
+		mediasoupclient::Cleanup();
+
+		return passed ? 0 : 1;
+	}
 
-	std::cout << "[INFO] verifying that room '" << envRoomId << "' exists..." << std::endl;
+	BCST_INFO << "verifying that room '" << envRoomId << "' exists...";
 	auto r = cpr::GetAsync(cpr::Url{ baseUrl }, cpr::VerifySsl{ verifySsl }).get();
 
 	if (r.status_code != 200)
 	{
-		std::cerr << "[ERROR] unable to retrieve room info"
-		          << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]" << std::endl;
+		BCST_ERROR << "unable to retrieve room info"
+		           << " [status code:" << r.status_code << ", body:\"" << r.text << "\"]";
 
 		return 1;
 	}
 	else
 	{
-		std::cout << "[INFO] found room" << envRoomId << std::endl;
+		BCST_INFO << "found room" << envRoomId;
 	}
 
 	auto response = nlohmann::json::parse(r.text);
 
-	Broadcaster broadcaster;
+	// Bounds the whole shutdown, from the signal to the exit.
+	std::thread shutdownWatchdog;
+	std::mutex shutdownMutex;
+	std::condition_variable shutdownCv;
+	bool shutdownDone = false;
+	bool started      = false;
 
-	broadcaster.Start(baseUrl, enableAudio, useSimulcast, response, verifySsl);
+	{
+		Broadcaster broadcaster;
 
-	std::cout << "[INFO] press Ctrl+C or Cmd+C to leave..." << std::endl;
+		broadcaster.SetDataSenderOptions(dataSenderOptions);
+		broadcaster.SetRecoveryOptions(recoveryOptions);
+		broadcaster.SetLeaveTimeout(static_cast<uint32_t>(leaveTimeout));
+		broadcaster.SetVideoCodec(videoCodec);
+
+		if (timestampOverlay)
+			broadcaster.EnableTimestampOverlay();
+
+		if (enableDataBenchmark)
+			broadcaster.EnableDataBenchmark(dataBenchmarkOptions);
+
+		if (enableLatencyProbe)
+			broadcaster.EnableLatencyProbe(latencyProbeOptions);
+
+		if (enableFileTransfer)
+			broadcaster.EnableFileTransfer(fileTransferOptions);
+
+		if (enableStats)
+			broadcaster.EnableStats(statsOptions);
+
+		if (enableConsumers)
+			broadcaster.EnableConsumers(consumerOptions);
+
+		if (enableFrameTrace)
+			broadcaster.EnableFrameTrace(frameTraceOptions);
+
+		if (!controlOptions.path.empty())
+			broadcaster.EnableControl(controlOptions);
+
+		if (envRecordDir)
+			broadcaster.EnableRecording(recordOptions);
+
+		started = broadcaster.Start(baseUrl, enableAudio, useSimulcast, response, verifySsl);
+
+		if (started)
+		{
+			BCST_INFO << "press Ctrl+C or Cmd+C to leave...";
+
+			int signum = waitForSignal();
+
+			BCST_INFO << "signal (" << signum << ") received, leaving...";
+		}
+		else
+		{
+			BCST_ERROR << "unable to join the room, leaving...";
+		}
+
+		shutdownWatchdog = std::thread([&]() {
+			std::unique_lock<std::mutex> lock(shutdownMutex);
+
+			if (!shutdownCv.wait_for(
+			      lock, std::chrono::milliseconds(shutdownTimeout), [&]() { return shutdownDone; }))
+			{
+				BCST_ERROR << "shutdown timed out, exiting";
+
+				AsyncLogger::Stop();
+				std::_Exit(1);
+			}
+		});
+
+		broadcaster.Stop();
+	}
+
+	// Once the Broadcaster, its tracks and transports are gone.
+	releasePeerConnectionFactory();
+	mediasoupclient::Cleanup();
+
+	if (eventLogWriter)
+		eventLogWriter->Stop();
 
-	while (true)
 	{
-		std::cin.get();
+		std::lock_guard<std::mutex> lock(shutdownMutex);
+
+		shutdownDone = true;
 	}
 
-	return 0;
+	shutdownCv.notify_all();
+	shutdownWatchdog.join();
+
+	BCST_INFO << "leaving!";
+
+	return started ? 0 : 1;
 }
@@ -0,0 +1,152 @@
+#include "api/video/video_frame.h"
+#include "rtc_base/random.h"
+#include "test/frame_utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Random planes compared per run.
+	constexpr int kRounds = 2000;
+
+	using UpdateRect = webrtc::VideoFrame::UpdateRect;
+
+	void fillRandom(webrtc::Random& random, std::vector<uint8_t>& bytes)
+	{
+		for (auto& byte : bytes)
+		{
+			byte = static_cast<uint8_t>(random.Rand<uint32_t>());
+		}
+	}
+
+	// Bounding box of the differing pixels, one pixel at a time.
+	UpdateRect naiveDiffRect(
+	  const uint8_t* data1, const uint8_t* data2, int stride1, int stride2, int width, int height)
+	{
+		int left   = width;
+		int right  = -1;
+		int top    = -1;
+		int bottom = -1;
+
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				if (data1[y * stride1 + x] == data2[y * stride2 + x])
+					continue;
+
+				if (top < 0)
+					top = y;
+
+				bottom = y;
+				left   = std::min(left, x);
+				right  = std::max(right, x);
+			}
+		}
+
+		if (top < 0)
+			return UpdateRect{ 0, 0, 0, 0 };
+
+		return UpdateRect{ left, top, right - left + 1, bottom - top + 1 };
+	}
+
+	bool sameRect(const UpdateRect& a, const UpdateRect& b)
+	{
+		return a.offset_x == b.offset_x && a.offset_y == b.offset_y && a.width == b.width &&
+		       a.height == b.height;
+	}
+
+	std::string toString(const UpdateRect& rect)
+	{
+		return std::to_string(rect.offset_x) + "," + std::to_string(rect.offset_y) + " " +
+		       std::to_string(rect.width) + "x" + std::to_string(rect.height);
+	}
+
+	// Checks a plane of random odd size and strides against a copy of it with
+	// random edits, returns what differs, empty if nothing.
+	std::string checkRandomPlane(webrtc::Random& random)
+	{
+		// A few 64-byte stripes and 16-byte diff blocks wide, plus a partial one.
+		int width   = random.Rand(1, 300);
+		int height  = random.Rand(1, 40);
+		int stride1 = width + random.Rand(0, 37);
+		int stride2 = width + random.Rand(0, 37);
+		std::vector<uint8_t> plane1(stride1 * height);
+		std::vector<uint8_t> plane2(stride2 * height);
+
+		fillRandom(random, plane1);
+		// Same pixels, different padding.
+		fillRandom(random, plane2);
+
+		for (int y = 0; y < height; ++y)
+		{
+			std::memcpy(&plane2[y * stride2], &plane1[y * stride1], width);
+		}
+
+		std::string size = std::to_string(width) + "x" + std::to_string(height) + " strides " +
+		                   std::to_string(stride1) + "," + std::to_string(stride2);
+		uint64_t seed    = random.Rand<uint32_t>();
+		uint64_t hash    = webrtc::test::HashPlane(plane1.data(), stride1, width, height, seed);
+
+		if (hash != webrtc::test::HashPlaneScalarForTesting(
+		              plane1.data(), stride1, width, height, seed))
+			return "HashPlane() differs from the scalar one [" + size + "]";
+
+		if (hash != webrtc::test::HashPlane(plane2.data(), stride2, width, height, seed))
+			return "HashPlane() depends on the stride [" + size + "]";
+
+		int edits = random.Rand(0, 4);
+
+		for (int i = 0; i < edits; ++i)
+		{
+			int x = random.Rand(0, width - 1);
+			int y = random.Rand(0, height - 1);
+
+			plane2[y * stride2 + x] ^= static_cast<uint8_t>(random.Rand(1, 255));
+		}
+
+		UpdateRect expected =
+		  naiveDiffRect(plane1.data(), plane2.data(), stride1, stride2, width, height);
+		UpdateRect simd =
+		  webrtc::test::DiffPlaneRect(plane1.data(), plane2.data(), stride1, stride2, width, height);
+		UpdateRect scalar = webrtc::test::DiffPlaneRectScalarForTesting(
+		  plane1.data(), plane2.data(), stride1, stride2, width, height);
+
+		if (!sameRect(simd, expected))
+			return "DiffPlaneRect() gave " + toString(simd) + " instead of " + toString(expected) +
+			       " [" + size + "]";
+
+		if (!sameRect(scalar, expected))
+			return "scalar DiffPlaneRect() gave " + toString(scalar) + " instead of " +
+			       toString(expected) + " [" + size + "]";
+
+		return "";
+	}
+} // namespace
+
+// Fails if the SIMD HashPlane() and DiffPlaneRect() do not match their scalar
+// versions and a naive diff, on random planes.
+int main()
+{
+	webrtc::Random random(0x5eed);
+
+	for (int i = 0; i < kRounds; ++i)
+	{
+		std::string error = checkRandomPlane(random);
+
+		if (!error.empty())
+		{
+			std::fprintf(stderr, "%s\n", error.c_str());
+
+			return 1;
+		}
+	}
+
+	std::printf("%d random planes checked\n", kRounds);
+
+	return 0;
+}